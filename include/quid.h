@@ -42,11 +42,13 @@
 # define QUID_LIB_API
 #endif
 
+#include <stddef.h>
+#include <stdio.h>
 #include <stdint.h>
 #include <time.h>
 
 #if defined(__cplusplus)
-extern "c" {
+extern "C" {
 #endif
 
 /**
@@ -117,6 +119,66 @@ typedef struct {
     uint8_t   version;                    /* Internal version */
 } cuuid_t;
 
+/**
+ * Packed identifier.
+ * Holds the significant bits of a cuuid_t in 16 bytes. The
+ * layout is chosen such that unsigned comparison of the
+ * members orders identifiers by timestamp first.
+ */
+typedef struct {
+    uint64_t  hi;                         /* Timestamp and structure version */
+    uint64_t  lo;                         /* Clock sequence and node */
+} quid128_t;
+
+/**
+ * Identifiers stored column wise. Every column is aligned
+ * to a cache line, the node column holds six bytes per row.
+ */
+typedef struct {
+    size_t    count;                      /* Number of rows */
+    size_t    capacity;                   /* Allocated rows */
+    uint32_t  *time_low;                  /* Time lower half */
+    uint16_t  *time_mid;                  /* Time middle half */
+    uint16_t  *time_hi_and_version;       /* Time upper half and structure version */
+    uint16_t  *clock_seq;                 /* Clock sequence, high byte first */
+    uint8_t   *node;                      /* Node allocation */
+    void      *alloc;                     /* Backing allocation */
+} quid_soa_t;
+
+/**
+ * Decoded identifier attributes.
+ */
+typedef struct {
+    uint8_t   version;                    /* Internal version, zero if not decodable */
+    uint8_t   flag;                       /* Indicator flags */
+    uint8_t   category;                   /* Identifier classification */
+    char      tag[3];                     /* User defined tag, zero if untagged */
+} quid_attr_t;
+
+/**
+ * Generator context. Holds the random state and node template of
+ * a single producer. Timestamps are reserved from a sequence shared
+ * by all contexts and by quid_create in the process, so identifiers
+ * never repeat across contexts. A context must not be used by more than one thread at a
+ * time.
+ */
+typedef struct {
+    uint64_t  time_last;                  /* Last timestamp handed out */
+    uint64_t  rnd;                        /* Random generator state */
+    uint8_t   version;                    /* Internal version to generate */
+    uint8_t   node[6];                    /* Node template */
+} quid_gen_t;
+
+/**
+ * Attribute keys.
+ */
+enum {
+    QUID_KEY_CATEGORY = 1,
+    QUID_KEY_FLAG = 2,
+    QUID_KEY_TAG = 3,
+    QUID_KEY_TIME_BUCKET = 4,
+};
+
 /**
  * Public API function result code.
  */
@@ -124,6 +186,9 @@ enum {
     QUID_ERROR = 0,
     QUID_OK = 1,
     QUID_INVALID_PARAM = 2,
+    QUID_EXISTS = 3,
+    QUID_NOMEM = 4,
+    QUID_CORRUPT = 5,
 };
 
 /**
@@ -138,8 +203,15 @@ QUID_LIB_API extern cresult      quid_create_rev4(cuuid_t *, uint8_t, uint8_t);
 QUID_LIB_API extern cresult      quid_create_rev7(cuuid_t *, uint8_t, uint8_t, char tag[3]);
 QUID_LIB_API extern cresult      quid_create(cuuid_t *, uint8_t, uint8_t, char tag[3]);
 
+QUID_LIB_API extern cresult      quid_gen_init(quid_gen_t *, uint8_t, uint8_t, uint8_t, const char tag[3]);
+QUID_LIB_API extern cresult      quid_gen_next(quid_gen_t *, cuuid_t *);
+QUID_LIB_API extern cresult      quid_gen_fill(quid_gen_t *, quid128_t *, size_t);
+QUID_LIB_API extern uint64_t     quid_gen_reserve(uint64_t, size_t);
+QUID_LIB_API extern void         quid_encrypt_node(uint64_t, uint8_t, uint8_t, uint8_t node[6]);
+
 QUID_LIB_API extern cresult      quid_validate(cuuid_t *);
 QUID_LIB_API extern cresult      quid_parse(char *, cuuid_t *);
+QUID_LIB_API extern cresult      quid_parse_n(const char *, size_t, cuuid_t *);
 QUID_LIB_API extern cresult      quid_tostring(const cuuid_t *, char str[QUID_FULLLEN + 1]);
 
 QUID_LIB_API extern void         quid_set_rnd_seed(int);
@@ -149,9 +221,184 @@ QUID_LIB_API extern const char  *quid_libversion(void);
 QUID_LIB_API extern cresult      quid_cmp(const cuuid_t *, const cuuid_t *);
 QUID_LIB_API extern struct tm   *quid_timestamp(cuuid_t *);
 QUID_LIB_API extern long         quid_microtime(cuuid_t *);
+QUID_LIB_API extern int64_t      quid_epoch_ns(const cuuid_t *);
+QUID_LIB_API extern cresult      quid_epoch_ns_bulk(const cuuid_t *, size_t, int64_t *);
 QUID_LIB_API extern const char  *quid_tag(cuuid_t *);
 QUID_LIB_API extern uint8_t      quid_category(cuuid_t *);
 QUID_LIB_API extern uint8_t      quid_flag(cuuid_t *);
+QUID_LIB_API extern cresult      quid_decode_bulk(const cuuid_t *, size_t, quid_attr_t *);
+QUID_LIB_API extern cresult      quid_partition_by(const cuuid_t *, size_t, int, int64_t, cuuid_t *, size_t *, size_t);
+
+QUID_LIB_API extern void         quid_pack(const cuuid_t *, quid128_t *);
+QUID_LIB_API extern void         quid_unpack(const quid128_t *, cuuid_t *);
+QUID_LIB_API extern int          quid_order(const cuuid_t *, const cuuid_t *);
+QUID_LIB_API extern int          quid_order128(const quid128_t *, const quid128_t *);
+QUID_LIB_API extern size_t       quid_find(const quid128_t *, size_t, const quid128_t *);
+QUID_LIB_API extern size_t       quid_eq_mask(const quid128_t *, size_t, const quid128_t *, uint64_t *);
+QUID_LIB_API extern cresult      quid_sort(cuuid_t *, size_t);
+QUID_LIB_API extern cresult      quid_sort_mt(cuuid_t *, size_t, unsigned int);
+QUID_LIB_API extern cresult      quid_sort128(quid128_t *, size_t);
+QUID_LIB_API extern cresult      quid_sort128_mt(quid128_t *, size_t, unsigned int);
+QUID_LIB_API extern uint64_t     quid_hash(const cuuid_t *);
+QUID_LIB_API extern uint64_t     quid_hash128(const quid128_t *);
+QUID_LIB_API extern size_t       quid_filter_time(const cuuid_t *, size_t, int64_t, int64_t, uint32_t *);
+QUID_LIB_API extern size_t       quid_filter_time128(const quid128_t *, size_t, int64_t, int64_t, uint32_t *);
+
+QUID_LIB_API extern cresult      quid_soa_init(quid_soa_t *, size_t);
+QUID_LIB_API extern void         quid_soa_free(quid_soa_t *);
+QUID_LIB_API extern cresult      quid_soa_load(quid_soa_t *, const cuuid_t *, size_t);
+QUID_LIB_API extern cresult      quid_soa_store(const quid_soa_t *, cuuid_t *);
+QUID_LIB_API extern cresult      quid_soa_epoch_ns(const quid_soa_t *, int64_t *);
+QUID_LIB_API extern size_t       quid_soa_filter_time(const quid_soa_t *, int64_t, int64_t, uint32_t *);
+QUID_LIB_API extern cresult      quid_soa_hash(const quid_soa_t *, uint64_t *);
+QUID_LIB_API extern cresult      quid_soa_order(const quid_soa_t *, const cuuid_t *, int *);
+QUID_LIB_API extern cresult      quid_soa_decode(const quid_soa_t *, quid_attr_t *);
+
+/**
+ * Hash set and hash map keyed by identifier.
+ */
+typedef struct quid_set quid_set_t;
+typedef struct quid_map quid_map_t;
+
+QUID_LIB_API extern quid_set_t  *quid_set_new(size_t);
+QUID_LIB_API extern void         quid_set_free(quid_set_t *);
+QUID_LIB_API extern void         quid_set_clear(quid_set_t *);
+QUID_LIB_API extern size_t       quid_set_size(const quid_set_t *);
+QUID_LIB_API extern cresult      quid_set_insert(quid_set_t *, const cuuid_t *);
+QUID_LIB_API extern cresult      quid_set_contains(const quid_set_t *, const cuuid_t *);
+QUID_LIB_API extern cresult      quid_set_erase(quid_set_t *, const cuuid_t *);
+
+QUID_LIB_API extern quid_map_t  *quid_map_new(size_t);
+QUID_LIB_API extern void         quid_map_free(quid_map_t *);
+QUID_LIB_API extern void         quid_map_clear(quid_map_t *);
+QUID_LIB_API extern size_t       quid_map_size(const quid_map_t *);
+QUID_LIB_API extern cresult      quid_map_put(quid_map_t *, const cuuid_t *, void *);
+QUID_LIB_API extern cresult      quid_map_get(const quid_map_t *, const cuuid_t *, void **);
+QUID_LIB_API extern cresult      quid_map_erase(quid_map_t *, const cuuid_t *);
+
+/**
+ * Concurrent hash map keyed by identifier.
+ */
+typedef struct quid_cmap quid_cmap_t;
+
+QUID_LIB_API extern quid_cmap_t *quid_cmap_new(size_t, unsigned int);
+QUID_LIB_API extern void         quid_cmap_free(quid_cmap_t *);
+QUID_LIB_API extern size_t       quid_cmap_size(quid_cmap_t *);
+QUID_LIB_API extern cresult      quid_cmap_put(quid_cmap_t *, const cuuid_t *, void *);
+QUID_LIB_API extern cresult      quid_cmap_get(quid_cmap_t *, const cuuid_t *, void **);
+QUID_LIB_API extern cresult      quid_cmap_erase(quid_cmap_t *, const cuuid_t *);
+
+/**
+ * Read only index over a sorted array of identifiers.
+ */
+typedef struct quid_index quid_index_t;
+
+QUID_LIB_API extern quid_index_t *quid_index_build(const cuuid_t *, size_t);
+QUID_LIB_API extern void         quid_index_free(quid_index_t *);
+QUID_LIB_API extern cresult      quid_index_range(const quid_index_t *, int64_t, int64_t, size_t *, size_t *);
+QUID_LIB_API extern cresult      quid_index_find(const quid_index_t *, const cuuid_t *, size_t *);
+
+/**
+ * Approximate membership filters.
+ */
+typedef struct quid_bloom quid_bloom_t;
+typedef struct quid_xorf quid_xorf_t;
+
+QUID_LIB_API extern quid_bloom_t *quid_bloom_new(size_t, unsigned int);
+QUID_LIB_API extern quid_bloom_t *quid_bloom_view(const void *, size_t);
+QUID_LIB_API extern void         quid_bloom_free(quid_bloom_t *);
+QUID_LIB_API extern cresult      quid_bloom_add(quid_bloom_t *, const cuuid_t *);
+QUID_LIB_API extern cresult      quid_bloom_add_bulk(quid_bloom_t *, const cuuid_t *, size_t);
+QUID_LIB_API extern cresult      quid_bloom_contains(const quid_bloom_t *, const cuuid_t *);
+QUID_LIB_API extern size_t       quid_bloom_query_bulk(const quid_bloom_t *, const cuuid_t *, size_t, uint32_t *);
+QUID_LIB_API extern const void  *quid_bloom_data(const quid_bloom_t *, size_t *);
+
+QUID_LIB_API extern quid_xorf_t *quid_xorf_build(const cuuid_t *, size_t);
+QUID_LIB_API extern quid_xorf_t *quid_xorf_view(const void *, size_t);
+QUID_LIB_API extern void         quid_xorf_free(quid_xorf_t *);
+QUID_LIB_API extern cresult      quid_xorf_contains(const quid_xorf_t *, const cuuid_t *);
+QUID_LIB_API extern size_t       quid_xorf_query_bulk(const quid_xorf_t *, const cuuid_t *, size_t, uint32_t *);
+QUID_LIB_API extern const void  *quid_xorf_data(const quid_xorf_t *, size_t *);
+
+/**
+ * Succinct sorted set of identifiers.
+ */
+typedef struct quid_efset quid_efset_t;
+
+typedef struct {
+    const quid_efset_t  *set;             /* Iterated set */
+    size_t              pos;              /* Position of next identifier */
+    uint64_t            bit;              /* Encoded position of next identifier */
+} quid_efset_iter_t;
+
+QUID_LIB_API extern quid_efset_t *quid_efset_build(const cuuid_t *, size_t);
+QUID_LIB_API extern void         quid_efset_free(quid_efset_t *);
+QUID_LIB_API extern size_t       quid_efset_size(const quid_efset_t *);
+QUID_LIB_API extern size_t       quid_efset_bytes(const quid_efset_t *);
+QUID_LIB_API extern size_t       quid_efset_rank(const quid_efset_t *, const cuuid_t *);
+QUID_LIB_API extern cresult      quid_efset_contains(const quid_efset_t *, const cuuid_t *);
+QUID_LIB_API extern cresult      quid_efset_select(const quid_efset_t *, size_t, cuuid_t *);
+QUID_LIB_API extern cresult      quid_efset_range(const quid_efset_t *, int64_t, int64_t, size_t *, size_t *);
+QUID_LIB_API extern void         quid_efset_iter(const quid_efset_t *, size_t, quid_efset_iter_t *);
+QUID_LIB_API extern cresult      quid_efset_next(quid_efset_iter_t *, cuuid_t *);
+
+/**
+ * Deduplication cache over a sliding time window.
+ */
+typedef struct quid_dedup quid_dedup_t;
+
+QUID_LIB_API extern quid_dedup_t *quid_dedup_new(int64_t, unsigned, size_t);
+QUID_LIB_API extern void         quid_dedup_free(quid_dedup_t *);
+QUID_LIB_API extern void         quid_dedup_clear(quid_dedup_t *);
+QUID_LIB_API extern size_t       quid_dedup_size(const quid_dedup_t *);
+QUID_LIB_API extern cresult      quid_dedup_check(quid_dedup_t *, const cuuid_t *);
+QUID_LIB_API extern cresult      quid_dedup_check_at(quid_dedup_t *, const cuuid_t *, int64_t);
+
+/**
+ * Inverted index by flag, category and tag.
+ */
+typedef struct quid_attrindex quid_attrindex_t;
+
+typedef struct {
+    int       key;                        /* Attribute key */
+    uint8_t   value;                      /* Category or flag bits */
+    char      tag[3];                     /* Tag, zero for untagged */
+} quid_term_t;
+
+QUID_LIB_API extern quid_attrindex_t *quid_attrindex_build(const cuuid_t *, size_t);
+QUID_LIB_API extern quid_attrindex_t *quid_attrindex_view(const void *, size_t);
+QUID_LIB_API extern void         quid_attrindex_free(quid_attrindex_t *);
+QUID_LIB_API extern size_t       quid_attrindex_size(const quid_attrindex_t *);
+QUID_LIB_API extern const void  *quid_attrindex_data(const quid_attrindex_t *, size_t *);
+QUID_LIB_API extern size_t       quid_attrindex_query(const quid_attrindex_t *, const quid_term_t *, size_t, uint32_t *);
+
+/**
+ * Columnar identifier stream.
+ */
+typedef struct quid_writer quid_writer_t;
+typedef struct quid_reader quid_reader_t;
+
+QUID_LIB_API extern quid_writer_t *quid_writer_open(FILE *);
+QUID_LIB_API extern cresult      quid_writer_put(quid_writer_t *, const cuuid_t *, size_t);
+QUID_LIB_API extern cresult      quid_writer_close(quid_writer_t *);
+QUID_LIB_API extern quid_reader_t *quid_reader_open(FILE *);
+QUID_LIB_API extern void         quid_reader_close(quid_reader_t *);
+QUID_LIB_API extern void         quid_reader_range(quid_reader_t *, int64_t, int64_t);
+QUID_LIB_API extern size_t       quid_reader_read(quid_reader_t *, cuuid_t *, size_t);
+QUID_LIB_API extern cresult      quid_reader_status(const quid_reader_t *);
+
+/**
+ * Append only identifier log on memory mapped segment files.
+ */
+typedef struct quid_log quid_log_t;
+typedef int (*quid_log_cb_t)(const quid128_t *, size_t, void *);
+
+QUID_LIB_API extern quid_log_t   *quid_log_open(const char *, size_t, int64_t);
+QUID_LIB_API extern void         quid_log_close(quid_log_t *);
+QUID_LIB_API extern size_t       quid_log_size(const quid_log_t *);
+QUID_LIB_API extern cresult      quid_log_append(quid_log_t *, const cuuid_t *, size_t);
+QUID_LIB_API extern cresult      quid_log_sync(quid_log_t *);
+QUID_LIB_API extern size_t       quid_log_scan(const quid_log_t *, int64_t, int64_t, quid_log_cb_t, void *);
 
 #if defined(__cplusplus)
 }
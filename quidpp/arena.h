@@ -0,0 +1,175 @@
+/*
+* Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*   * Redistributions of source code must retain the above copyright notice,
+*     this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above copyright
+*     notice, this list of conditions and the following disclaimer in the
+*     documentation and/or other materials provided with the distribution.
+*   * Neither the name of Redis nor the names of its contributors may be used
+*     to endorse or promote products derived from this software without
+*     specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __QUIDPP_ARENA_H__
+#define __QUIDPP_ARENA_H__
+
+#ifdef _WIN32
+# pragma once
+#endif
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "quidpp.h"
+
+namespace quidpp
+{
+namespace pmr
+{
+
+using QuidVector = std::pmr::vector<Quid>;
+using AttrVector = std::pmr::vector<quid_attr_t>;
+using String = std::pmr::string;
+using StringViewVector = std::pmr::vector<std::string_view>;
+
+/**
+* Format an identifier into a string allocated from a memory resource.
+*/
+inline String ToString(const Quid& q, std::pmr::memory_resource* resource, bool useCompactFormat = false)
+{
+    Quid::String str = q.ToArray();
+
+    if (useCompactFormat) {
+        return String(str.data() + 1, QUID_FULLLEN - 2, resource);
+    }
+
+    return String(str.data(), QUID_FULLLEN, resource);
+}
+
+/**
+* Request scoped arena. Every container and string handed out is
+* allocated from a monotonic buffer, starting in an inline block and
+* continuing in blocks from the upstream resource. Individual frees
+* are no-ops, all memory is returned at once by Release() or when
+* the arena is destroyed. Containers obtained from the arena must not
+* outlive it.
+*/
+template <size_t InlineSize = 4096>
+class BasicArena
+{
+    alignas(std::max_align_t) std::byte initial[InlineSize];
+    std::pmr::monotonic_buffer_resource resource;
+
+public:
+    explicit BasicArena(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept
+        : resource{ initial, InlineSize, upstream }
+    {
+    }
+
+    BasicArena(const BasicArena&) = delete;
+    BasicArena& operator=(const BasicArena&) = delete;
+
+    std::pmr::memory_resource* Resource() noexcept { return &resource; }
+
+    /**
+    * Free everything allocated from the arena.
+    */
+    void Release() noexcept { resource.release(); }
+
+    QuidVector MakeVector(size_t capacity = 0)
+    {
+        QuidVector v{ &resource };
+        v.reserve(capacity);
+        return v;
+    }
+
+    /**
+    * Create n identifiers with the given generator.
+    */
+    template <typename GeneratorType>
+    QuidVector Generate(GeneratorType& gen, size_t n)
+    {
+        QuidVector v(n, &resource);
+        gen.GenerateInto(v.data(), n);
+        return v;
+    }
+
+    String ToString(const Quid& q, bool useCompactFormat = false)
+    {
+        return pmr::ToString(q, &resource, useCompactFormat);
+    }
+
+    /**
+    * Format an identifier into arena memory. The view is valid until
+    * the arena is released.
+    */
+    std::string_view Format(const Quid& q)
+    {
+        char* str = static_cast<char*>(resource.allocate(QUID_FULLLEN + 1, 1));
+        detail::FormatKey(q.Key(), str);
+        return std::string_view{ str, QUID_FULLLEN };
+    }
+
+    /**
+    * Format a batch of identifiers into one contiguous block of
+    * arena memory, one view per identifier.
+    */
+    StringViewVector Format(const Quid* first, size_t n)
+    {
+        StringViewVector views{ &resource };
+        char* str = static_cast<char*>(resource.allocate(n * (QUID_FULLLEN + 1), 1));
+
+        views.reserve(n);
+        for (size_t i = 0; i < n; ++i, str += QUID_FULLLEN + 1) {
+            detail::FormatKey(first[i].Key(), str);
+            views.emplace_back(str, QUID_FULLLEN);
+        }
+
+        return views;
+    }
+
+    /**
+    * Decode the attributes of a batch of identifiers with a single
+    * call to quid_decode_bulk. The unpacked scratch space is taken
+    * from the arena as well.
+    */
+    AttrVector Decode(const Quid* first, size_t n)
+    {
+        std::pmr::vector<cuuid_t> scratch(n, &resource);
+        AttrVector attr(n, &resource);
+
+        for (size_t i = 0; i < n; ++i) {
+            quid_unpack(&first[i].Key(), &scratch[i]);
+        }
+        quid_decode_bulk(scratch.data(), n, attr.data());
+
+        return attr;
+    }
+};
+
+using Arena = BasicArena<>;
+
+}
+}
+
+#endif // __QUIDPP_ARENA_H__
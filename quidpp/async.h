@@ -0,0 +1,453 @@
+/*
+* Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*   * Redistributions of source code must retain the above copyright notice,
+*     this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above copyright
+*     notice, this list of conditions and the following disclaimer in the
+*     documentation and/or other materials provided with the distribution.
+*   * Neither the name of Redis nor the names of its contributors may be used
+*     to endorse or promote products derived from this software without
+*     specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __QUIDPP_ASYNC_H__
+#define __QUIDPP_ASYNC_H__
+
+#ifdef _WIN32
+# pragma once
+#endif
+
+#include "quidpp.h"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace quidpp
+{
+
+/**
+* Minimal synchronous coroutine generator. The body runs only when
+* the consumer advances, yielded values must be default constructible.
+*/
+template <typename T>
+class CoGenerator
+{
+public:
+    struct promise_type
+    {
+        T value{};
+        std::exception_ptr exception;
+
+        CoGenerator get_return_object() noexcept
+        {
+            return CoGenerator{ std::coroutine_handle<promise_type>::from_promise(*this) };
+        }
+
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        std::suspend_always final_suspend() const noexcept { return {}; }
+
+        std::suspend_always yield_value(T v) noexcept
+        {
+            value = std::move(v);
+            return {};
+        }
+
+        void return_void() const noexcept {}
+        void unhandled_exception() noexcept { exception = std::current_exception(); }
+    };
+
+    struct Sentinel {};
+
+    class Iterator
+    {
+        std::coroutine_handle<promise_type> handle;
+
+    public:
+        using iterator_concept = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        Iterator() = default;
+
+        explicit Iterator(std::coroutine_handle<promise_type> handle) noexcept
+            : handle{ handle }
+        {
+        }
+
+        const T& operator*() const noexcept { return handle.promise().value; }
+
+        Iterator& operator++()
+        {
+            handle.resume();
+            if (handle.promise().exception) {
+                std::rethrow_exception(handle.promise().exception);
+            }
+            return *this;
+        }
+
+        void operator++(int) { ++*this; }
+
+        friend bool operator==(const Iterator& it, Sentinel) noexcept { return it.handle.done(); }
+    };
+
+    explicit CoGenerator(std::coroutine_handle<promise_type> handle) noexcept
+        : handle{ handle }
+    {
+    }
+
+    CoGenerator(CoGenerator&& other) noexcept
+        : handle{ std::exchange(other.handle, nullptr) }
+    {
+    }
+
+    CoGenerator& operator=(CoGenerator&& other) noexcept
+    {
+        std::swap(handle, other.handle);
+        return *this;
+    }
+
+    ~CoGenerator()
+    {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    Iterator begin()
+    {
+        Iterator it{ handle };
+        return ++it;
+    }
+
+    Sentinel end() const noexcept { return {}; }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+/**
+* Endless sequence of identifier batches from a generator. Each
+* batch is valid until the sequence is advanced.
+*/
+inline CoGenerator<std::span<const Quid>> MintBatches(Generator& gen, size_t batchSize)
+{
+    std::vector<Quid> batch(batchSize);
+
+    for (;;) {
+        gen.GenerateInto(batch.data(), batch.size());
+        co_yield std::span<const Quid>{ batch };
+    }
+}
+
+/**
+* Identifiers parsed from a byte stream, in batches of at most
+* batchSize. Tokens are separated as in ParseAll and may span reads.
+* Rejected tokens are counted in stats when provided.
+*/
+inline CoGenerator<std::span<const Quid>> ParseBatches(std::istream& in, size_t batchSize, ParseStats* stats = nullptr)
+{
+    static constexpr size_t ChunkSize = 4096;
+    std::vector<Quid> batch;
+    std::string buffer;
+    size_t start = 0;
+
+    batch.reserve(batchSize);
+    for (bool eof = false; !eof;) {
+        buffer.erase(0, start);
+
+        size_t size = buffer.size();
+        buffer.resize(size + ChunkSize);
+        in.read(&buffer[size], ChunkSize);
+        buffer.resize(size + static_cast<size_t>(in.gcount()));
+        eof = !in;
+
+        /* Keep a trailing partial token for the next read */
+        start = buffer.size();
+        if (!eof) {
+            while (start > 0 && !detail::IsSeparator(buffer[start - 1])) {
+                --start;
+            }
+        }
+
+        QuidView view{ std::string_view{ buffer }.substr(0, start) };
+        for (auto it = view.begin(); it != view.end(); ++it) {
+            auto result = *it;
+            if (result) {
+                batch.push_back(*result);
+                if (stats) { stats->parsed++; }
+            } else if (stats) {
+                stats->failed++;
+            }
+
+            if (batch.size() == batchSize) {
+                co_yield std::span<const Quid>{ batch };
+                batch.clear();
+            }
+        }
+    }
+
+    if (!batch.empty()) {
+        co_yield std::span<const Quid>{ batch };
+    }
+}
+
+/**
+* Asynchronous stream of identifier batches. A background thread
+* refills up to depth batches ahead of the consumer and then waits,
+* so a slow consumer holds back the producer. Waiting on the clock
+* when the tick budget runs out, or on the input, happens on that
+* thread and never in the awaiting coroutine.
+*
+* There is a single consumer. A suspended consumer is resumed on the
+* producer thread unless a resumer is given, an event loop passes a
+* resumer which posts the handle to its own executor. The stream
+* must not be destroyed while a consumer is suspended on it, but may
+* be destroyed by a consumer running on the producer thread. An
+* exception thrown by the source ends the stream and is rethrown to
+* the consumer once the batches before it are taken.
+*/
+class AsyncStream
+{
+public:
+    using Batch = std::vector<Quid>;
+
+    /* Fills a batch, returns zero when the source is exhausted */
+    using Source = std::function<size_t(Batch&)>;
+    using Resumer = std::function<void(std::coroutine_handle<>)>;
+
+private:
+    /* Shared with the producer thread, which may outlive the stream */
+    struct State
+    {
+        Source source;
+        Resumer resumer;
+        size_t batchSize;
+        size_t depth;
+
+        std::mutex lock;
+        std::condition_variable space;
+        std::deque<Batch> ready;
+        std::coroutine_handle<> waiter;
+        std::exception_ptr error;
+        bool finished = false;
+        bool stop = false;
+    };
+
+    std::shared_ptr<State> state;
+    std::thread worker;
+
+    static void Run(std::shared_ptr<State> state)
+    {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> guard{ state->lock };
+                state->space.wait(guard, [&state] { return state->stop || state->ready.size() < state->depth; });
+                if (state->stop) {
+                    return;
+                }
+            }
+
+            Batch batch;
+            std::exception_ptr error;
+            bool done;
+
+            try {
+                batch.reserve(state->batchSize);
+                done = state->source(batch) == 0;
+            } catch (...) {
+                error = std::current_exception();
+                done = true;
+            }
+
+            std::coroutine_handle<> resume;
+            {
+                std::lock_guard<std::mutex> guard{ state->lock };
+                if (done) {
+                    state->finished = true;
+                    state->error = error;
+                } else {
+                    state->ready.push_back(std::move(batch));
+                }
+                resume = std::exchange(state->waiter, nullptr);
+            }
+
+            /* The consumer may destroy the stream before this returns */
+            if (resume) {
+                state->resumer ? state->resumer(resume) : resume.resume();
+            }
+            if (done) {
+                return;
+            }
+        }
+    }
+
+public:
+    class Awaiter
+    {
+        State* state;
+
+    public:
+        explicit Awaiter(State* state) noexcept
+            : state{ state }
+        {
+        }
+
+        bool await_ready()
+        {
+            std::lock_guard<std::mutex> guard{ state->lock };
+            return !state->ready.empty() || state->finished;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            std::lock_guard<std::mutex> guard{ state->lock };
+            if (!state->ready.empty() || state->finished) {
+                return false;
+            }
+
+            state->waiter = handle;
+            return true;
+        }
+
+        /* Next batch, empty once the source is exhausted */
+        Batch await_resume()
+        {
+            Batch batch;
+            {
+                std::lock_guard<std::mutex> guard{ state->lock };
+                if (state->ready.empty()) {
+                    if (state->error) {
+                        std::rethrow_exception(state->error);
+                    }
+                    return batch;
+                }
+
+                batch = std::move(state->ready.front());
+                state->ready.pop_front();
+            }
+
+            state->space.notify_one();
+            return batch;
+        }
+    };
+
+    AsyncStream(Source source, size_t batchSize, size_t depth = 2, Resumer resumer = nullptr)
+        : state{ std::make_shared<State>() }
+    {
+        state->source = std::move(source);
+        state->resumer = std::move(resumer);
+        state->batchSize = batchSize;
+        state->depth = depth ? depth : 1;
+
+        worker = std::thread{ Run, state };
+    }
+
+    AsyncStream(const AsyncStream&) = delete;
+    AsyncStream& operator=(const AsyncStream&) = delete;
+
+    ~AsyncStream()
+    {
+        {
+            std::lock_guard<std::mutex> guard{ state->lock };
+            state->stop = true;
+        }
+
+        state->space.notify_one();
+
+        /* Destroyed by a consumer resumed on the producer thread */
+        if (worker.get_id() == std::this_thread::get_id()) {
+            worker.detach();
+        } else {
+            worker.join();
+        }
+    }
+
+    /**
+    * Stream of newly minted identifiers.
+    */
+    static std::unique_ptr<AsyncStream> Mint(size_t batchSize, size_t depth = 2, Resumer resumer = nullptr,
+        uint8_t flag = IDF_NULL, uint8_t category = CLS_CMON)
+    {
+        auto gen = std::make_shared<Generator>(flag, category);
+
+        return std::make_unique<AsyncStream>([gen, batchSize](Batch& batch) {
+            batch.resize(batchSize);
+            gen->GenerateInto(batch.data(), batch.size());
+            return batch.size();
+        }, batchSize, depth, std::move(resumer));
+    }
+
+    /**
+    * Stream of identifiers parsed from a byte stream, which must
+    * outlive the stream. Malformed tokens are skipped.
+    */
+    static std::unique_ptr<AsyncStream> Parse(std::istream& in, size_t batchSize, size_t depth = 2, Resumer resumer = nullptr)
+    {
+        struct State
+        {
+            CoGenerator<std::span<const Quid>> batches;
+            CoGenerator<std::span<const Quid>>::Iterator it;
+            bool started = false;
+        };
+
+        auto state = std::make_shared<State>(State{ ParseBatches(in, batchSize), {}, false });
+
+        return std::make_unique<AsyncStream>([state](Batch& batch) -> size_t {
+            if (!state->started) {
+                state->it = state->batches.begin();
+                state->started = true;
+            } else {
+                ++state->it;
+            }
+            if (state->it == state->batches.end()) {
+                return 0;
+            }
+
+            batch.assign((*state->it).begin(), (*state->it).end());
+            return batch.size();
+        }, batchSize, depth, std::move(resumer));
+    }
+
+    /**
+    * Await the next batch.
+    *
+    *   auto batch = co_await stream->Next();
+    */
+    Awaiter Next() noexcept { return Awaiter{ state.get() }; }
+};
+
+}
+
+#endif
+
+#endif // __QUIDPP_ASYNC_H__
@@ -0,0 +1,328 @@
+/*
+* Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*   * Redistributions of source code must retain the above copyright notice,
+*     this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above copyright
+*     notice, this list of conditions and the following disclaimer in the
+*     documentation and/or other materials provided with the distribution.
+*   * Neither the name of Redis nor the names of its contributors may be used
+*     to endorse or promote products derived from this software without
+*     specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __QUIDPP_FLAT_H__
+#define __QUIDPP_FLAT_H__
+
+#ifdef _WIN32
+# pragma once
+#endif
+
+#include <algorithm>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "quidpp.h"
+
+namespace quidpp
+{
+
+/**
+* Open addressing hash set of identifiers. Slots are stored inline
+* with linear probing, the nil identifier marks an empty slot and is
+* tracked separately. Erasure shifts the following run back, so no
+* tombstones are left behind. Not thread safe.
+*/
+class FlatHashSet
+{
+    std::vector<Quid> slots;
+    size_t count = 0;
+    bool hasNil = false;
+
+    size_t Mask() const noexcept { return slots.size() - 1; }
+
+    size_t Probe(const Quid& q) const noexcept
+    {
+        size_t i = static_cast<size_t>(q.Hash()) & Mask();
+        while (!slots[i].IsNil() && slots[i] != q) {
+            i = (i + 1) & Mask();
+        }
+        return i;
+    }
+
+    void Grow(size_t capacity)
+    {
+        std::vector<Quid> old(capacity);
+        old.swap(slots);
+
+        for (const Quid& q : old) {
+            if (!q.IsNil()) {
+                slots[Probe(q)] = q;
+            }
+        }
+    }
+
+public:
+    explicit FlatHashSet(size_t hint = 0)
+    {
+        Reserve(hint);
+    }
+
+    /**
+    * Make room for at least n identifiers without rehashing.
+    */
+    void Reserve(size_t n)
+    {
+        size_t capacity = 16;
+        while (capacity - capacity / 4 < n) {
+            capacity *= 2;
+        }
+        if (capacity > slots.size()) {
+            Grow(capacity);
+        }
+    }
+
+    size_t Size() const noexcept { return count; }
+    bool Empty() const noexcept { return count == 0; }
+
+    void Clear() noexcept
+    {
+        std::fill(slots.begin(), slots.end(), Quid{});
+        count = 0;
+        hasNil = false;
+    }
+
+    /**
+    * Insert an identifier.
+    *
+    * @return  True if the identifier was not in the set
+    */
+    bool Insert(const Quid& q)
+    {
+        if (q.IsNil()) {
+            if (hasNil) {
+                return false;
+            }
+            hasNil = true;
+            count++;
+            return true;
+        }
+
+        if (count + 1 > slots.size() - slots.size() / 4) {
+            Grow(slots.size() * 2);
+        }
+
+        size_t i = Probe(q);
+        if (!slots[i].IsNil()) {
+            return false;
+        }
+
+        slots[i] = q;
+        count++;
+        return true;
+    }
+
+    bool Contains(const Quid& q) const noexcept
+    {
+        if (q.IsNil()) {
+            return hasNil;
+        }
+        return !slots[Probe(q)].IsNil();
+    }
+
+    /**
+    * Lookup by string, the string is parsed in place. A malformed
+    * string is never found.
+    */
+    bool Contains(std::string_view str) const noexcept
+    {
+        auto q = Quid::FromString(str);
+        return q && Contains(*q);
+    }
+
+    /**
+    * Remove an identifier.
+    *
+    * @return  True if the identifier was in the set
+    */
+    bool Erase(const Quid& q) noexcept
+    {
+        if (q.IsNil()) {
+            if (!hasNil) {
+                return false;
+            }
+            hasNil = false;
+            count--;
+            return true;
+        }
+
+        size_t i = Probe(q);
+        if (slots[i].IsNil()) {
+            return false;
+        }
+
+        /* Shift back entries whose home slot precedes the hole */
+        size_t j = i;
+        for (;;) {
+            j = (j + 1) & Mask();
+            if (slots[j].IsNil()) {
+                break;
+            }
+
+            size_t home = static_cast<size_t>(slots[j].Hash()) & Mask();
+            if (((j - home) & Mask()) >= ((j - i) & Mask())) {
+                slots[i] = slots[j];
+                i = j;
+            }
+        }
+
+        slots[i] = Quid{};
+        count--;
+        return true;
+    }
+};
+
+/**
+* Sorted map keyed on identifiers. Keys and values live in separate
+* contiguous arrays, which makes lookups a binary search over keys
+* only and keeps iteration in timestamp order. Inserts are linear,
+* the map suits data that is built once and read often.
+*/
+template <typename T>
+class FlatMap
+{
+    std::vector<Quid> keys;
+    std::vector<T> values;
+
+    size_t LowerBound(const Quid& key) const noexcept
+    {
+        return static_cast<size_t>(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+    }
+
+    size_t IndexOf(const Quid& key) const noexcept
+    {
+        size_t i = LowerBound(key);
+        if (i == keys.size() || keys[i] != key) {
+            return keys.size();
+        }
+        return i;
+    }
+
+    /* A malformed string is never found */
+    size_t IndexOf(std::string_view str) const noexcept
+    {
+        auto key = Quid::FromString(str);
+        return key ? IndexOf(*key) : keys.size();
+    }
+
+public:
+    FlatMap() = default;
+
+    void Reserve(size_t n)
+    {
+        keys.reserve(n);
+        values.reserve(n);
+    }
+
+    size_t Size() const noexcept { return keys.size(); }
+    bool Empty() const noexcept { return keys.empty(); }
+
+    void Clear() noexcept
+    {
+        keys.clear();
+        values.clear();
+    }
+
+    const std::vector<Quid>& Keys() const noexcept { return keys; }
+    const std::vector<T>& Values() const noexcept { return values; }
+
+    /**
+    * Insert a value, existing keys are left untouched.
+    *
+    * @return  True if the key was not in the map
+    */
+    bool Insert(const Quid& key, T value)
+    {
+        size_t i = LowerBound(key);
+        if (i < keys.size() && keys[i] == key) {
+            return false;
+        }
+
+        keys.insert(keys.begin() + static_cast<std::ptrdiff_t>(i), key);
+        values.insert(values.begin() + static_cast<std::ptrdiff_t>(i), std::move(value));
+        return true;
+    }
+
+    /**
+    * Find the value of a key. A string is parsed in place, a
+    * malformed string is never found.
+    *
+    * @return  Pointer to the value or nullptr if not found
+    */
+    T* Find(const Quid& key) noexcept
+    {
+        size_t i = IndexOf(key);
+        return i == keys.size() ? nullptr : &values[i];
+    }
+
+    T* Find(std::string_view str) noexcept
+    {
+        size_t i = IndexOf(str);
+        return i == keys.size() ? nullptr : &values[i];
+    }
+
+    const T* Find(const Quid& key) const noexcept
+    {
+        size_t i = IndexOf(key);
+        return i == keys.size() ? nullptr : &values[i];
+    }
+
+    const T* Find(std::string_view str) const noexcept
+    {
+        size_t i = IndexOf(str);
+        return i == keys.size() ? nullptr : &values[i];
+    }
+
+    bool Contains(const Quid& key) const noexcept
+    {
+        return IndexOf(key) != keys.size();
+    }
+
+    bool Contains(std::string_view str) const noexcept
+    {
+        return IndexOf(str) != keys.size();
+    }
+
+    bool Erase(const Quid& key) noexcept
+    {
+        size_t i = IndexOf(key);
+        if (i == keys.size()) {
+            return false;
+        }
+
+        keys.erase(keys.begin() + static_cast<std::ptrdiff_t>(i));
+        values.erase(values.begin() + static_cast<std::ptrdiff_t>(i));
+        return true;
+    }
+};
+
+}
+
+#endif // __QUIDPP_FLAT_H__
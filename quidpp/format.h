@@ -0,0 +1,214 @@
+/*
+* Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+*   * Redistributions of source code must retain the above copyright notice,
+*     this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above copyright
+*     notice, this list of conditions and the following disclaimer in the
+*     documentation and/or other materials provided with the distribution.
+*   * Neither the name of Redis nor the names of its contributors may be used
+*     to endorse or promote products derived from this software without
+*     specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __QUIDPP_FORMAT_H__
+#define __QUIDPP_FORMAT_H__
+
+#ifdef _WIN32
+# pragma once
+#endif
+
+#include <algorithm>
+#include <cstddef>
+
+#include "quidpp.h"
+
+#if defined(__cpp_lib_format)
+# include <format>
+#endif
+#if __has_include(<fmt/format.h>)
+# include <fmt/format.h>
+# define QUIDPP_HAS_FMT 1
+#endif
+
+namespace quidpp
+{
+namespace detail
+{
+
+/**
+* Presentation of an identifier in format strings:
+*
+*   {}  {:b}  braced, the default
+*   {:c}      compact, without braces
+*   {:s}      base32, 26 characters ordering like the packed identifier
+*
+* The uppercase variants B, C and S print uppercase digits.
+*/
+struct FormatSpec
+{
+    char type = 'b';
+    bool upper = false;
+};
+
+/* Crockford base32, ascending in ASCII so the encoding sorts like the key */
+constexpr char Base32Digits[] = "0123456789abcdefghjkmnpqrstvwxyz";
+
+constexpr size_t Base32Length = 26;
+
+template <typename It>
+constexpr It ParseSpec(It it, It end, FormatSpec& spec) noexcept
+{
+    if (it == end || *it == '}') {
+        return it;
+    }
+
+    switch (*it) {
+        case 'b': case 'c': case 's':
+            spec.type = *it;
+            break;
+        case 'B': case 'C': case 'S':
+            spec.type = static_cast<char>(*it - 'A' + 'a');
+            spec.upper = true;
+            break;
+        default:
+            return it;
+    }
+
+    return ++it;
+}
+
+/**
+* Format an identifier according to the specification, returns
+* the number of characters written. The buffer must hold at least
+* QUID_FULLLEN + 1 characters.
+*/
+constexpr size_t FormatWith(const quid128_t& key, const FormatSpec& spec, char* str) noexcept
+{
+    size_t len = 0;
+
+    if (spec.type == 's') {
+        /* 130 bit number of which the upper two bits are zero */
+        for (size_t i = 0; i < Base32Length; ++i) {
+            size_t shift = 125 - 5 * i;
+            uint64_t v = shift >= 64 ? key.hi >> (shift - 64)
+                : shift + 5 <= 64 ? key.lo >> shift
+                : (key.lo >> shift) | (key.hi << (64 - shift));
+            str[i] = Base32Digits[v & 0x1f];
+        }
+        len = Base32Length;
+    } else if (spec.type == 'c') {
+        char full[QUID_FULLLEN + 1] = {};
+        FormatKey(key, full);
+        for (size_t i = 0; i < QUID_FULLLEN - 2; ++i) {
+            str[i] = full[i + 1];
+        }
+        len = QUID_FULLLEN - 2;
+    } else {
+        FormatKey(key, str);
+        len = QUID_FULLLEN;
+    }
+
+    if (spec.upper) {
+        for (size_t i = 0; i < len; ++i) {
+            if (str[i] >= 'a' && str[i] <= 'z') {
+                str[i] = static_cast<char>(str[i] - 'a' + 'A');
+            }
+        }
+    }
+
+    str[len] = '\0';
+    return len;
+}
+
+}
+
+/**
+* Write an identifier to an output iterator without an intermediate
+* string, see detail::FormatSpec for the presentation types.
+*/
+template <typename OutputIt>
+OutputIt FormatTo(OutputIt out, const Quid& q, char type = 'b')
+{
+    detail::FormatSpec spec;
+    char str[QUID_FULLLEN + 1];
+
+    detail::ParseSpec(&type, &type + 1, spec);
+    size_t len = detail::FormatWith(q.Key(), spec, str);
+    return std::copy(str, str + len, out);
+}
+
+}
+
+#if defined(__cpp_lib_format)
+namespace std
+{
+
+template <>
+struct formatter<quidpp::Quid, char>
+{
+    quidpp::detail::FormatSpec spec;
+
+    constexpr format_parse_context::iterator parse(format_parse_context& ctx)
+    {
+        auto it = quidpp::detail::ParseSpec(ctx.begin(), ctx.end(), spec);
+        if (it != ctx.end() && *it != '}') {
+            throw format_error("invalid quid format specifier");
+        }
+        return it;
+    }
+
+    template <typename FormatContext>
+    typename FormatContext::iterator format(const quidpp::Quid& q, FormatContext& ctx) const
+    {
+        char str[QUID_FULLLEN + 1];
+        size_t len = quidpp::detail::FormatWith(q.Key(), spec, str);
+        return std::copy(str, str + len, ctx.out());
+    }
+};
+
+}
+#endif
+
+#if defined(QUIDPP_HAS_FMT)
+template <>
+struct fmt::formatter<quidpp::Quid>
+{
+    quidpp::detail::FormatSpec spec;
+
+    constexpr format_parse_context::iterator parse(format_parse_context& ctx)
+    {
+        auto it = quidpp::detail::ParseSpec(ctx.begin(), ctx.end(), spec);
+        if (it != ctx.end() && *it != '}') {
+            throw format_error("invalid quid format specifier");
+        }
+        return it;
+    }
+
+    template <typename FormatContext>
+    auto format(const quidpp::Quid& q, FormatContext& ctx) const -> decltype(ctx.out())
+    {
+        char str[QUID_FULLLEN + 1];
+        size_t len = quidpp::detail::FormatWith(q.Key(), spec, str);
+        return std::copy(str, str + len, ctx.out());
+    }
+};
+#endif
+
+#endif // __QUIDPP_FORMAT_H__
@@ -34,125 +34,484 @@
 # pragma once
 #endif
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
 #include <string>
-#include <memory.h>
-#include <cassert>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if __has_include(<version>)
+# include <version>
+#endif
+#if defined(__cpp_lib_expected)
+# include <expected>
+#endif
+#if defined(__cpp_lib_span)
+# include <span>
+#endif
+#if defined(__cpp_lib_three_way_comparison)
+# include <compare>
+#endif
+#if defined(__cpp_lib_ranges)
+# include <ranges>
+#endif
 
 #include <quid.h>
 
 namespace quidpp
 {
 
-class InvalidQuidException {/*TODO set what()*/ };
+class InvalidQuidException : public std::invalid_argument
+{
+public:
+    InvalidQuidException()
+        : std::invalid_argument{ "invalid quid" }
+    {
+    }
+};
 
-class Quid
+/**
+* Reason a string was rejected by the parser.
+*/
+enum class ParseError
 {
-    quid_t quid;
+    Empty,      /* No input */
+    Malformed,  /* Not a valid quid */
+};
+
+#if defined(__cpp_lib_expected)
+template <typename T, typename E>
+using Expected = std::expected<T, E>;
+
+template <typename E>
+using Unexpected = std::unexpected<E>;
+#else
+template <typename E>
+class Unexpected
+{
+    E err;
 
-    inline void GenerateNewLocalGuid()
+public:
+    constexpr explicit Unexpected(E err) noexcept
+        : err{ err }
     {
-        quid_create(&this->quid);
     }
 
-    void CopyToLocalGuid(const Quid& other)
+    constexpr const E& error() const noexcept { return err; }
+};
+
+/**
+* Minimal stand-in for std::expected on older standards. Only
+* the subset used by this header is provided, the value type
+* must be default constructible.
+*/
+template <typename T, typename E>
+class Expected
+{
+    T val{};
+    E err{};
+    bool ok;
+
+public:
+    constexpr Expected(const T& val) noexcept
+        : val{ val }, ok{ true }
     {
-        assert(memcpy(this->quid, quid, sizeof(quid_t)));
     }
 
-    void StringToQuid(const char *strquid)
+    constexpr Expected(const Unexpected<E>& unex) noexcept
+        : err{ unex.error() }, ok{ false }
     {
-        char rs = strquid_format(strquid);
-        if (!rs) {
-            throw InvalidQuidException();
+    }
+
+    constexpr bool has_value() const noexcept { return ok; }
+    constexpr explicit operator bool() const noexcept { return ok; }
+
+    constexpr const T& operator*() const noexcept { return val; }
+    constexpr const T* operator->() const noexcept { return &val; }
+    constexpr const E& error() const noexcept { return err; }
+
+    const T& value() const
+    {
+        if (!ok) {
+            throw InvalidQuidException{};
         }
+        return val;
+    }
+};
+#endif
+
+namespace detail
+{
+
+/* Timestamp magic and structure versions, see quid.c */
+constexpr uint16_t Magic = 0x80;
+constexpr uint16_t VersionRev4 = 0xa000;
+constexpr uint16_t VersionRev7 = 0xb000;
+
+constexpr char HexDigits[] = "0123456789abcdef";
+
+constexpr int HexValue(char c) noexcept
+{
+    return c >= '0' && c <= '9' ? c - '0'
+        : c >= 'a' && c <= 'f' ? c - 'a' + 10
+        : c >= 'A' && c <= 'F' ? c - 'A' + 10
+        : -1;
+}
 
-        strtoquid(strquid, &this->quid);
+/**
+* Constant expression equivalent of quid_parse_n followed by
+* quid_pack. Slower than the library parser, intended for values
+* known at compile time.
+*/
+constexpr bool ParseKey(std::string_view str, quid128_t& key) noexcept
+{
+    uint64_t digits[2] = { 0, 0 };
+    size_t n = 0;
+
+    for (char c : str) {
+        int v = HexValue(c);
+        if (v >= 0) {
+            if (n == QUID_LEN) {
+                return false;
+            }
+            digits[n / 16] = digits[n / 16] << 4 | static_cast<uint64_t>(v);
+            n++;
+        } else if (c != '-' && c != '{' && c != '}' && c != ' ') {
+            return false;
+        }
+    }
+
+    if (n != QUID_LEN) {
+        return false;
     }
 
+    uint64_t time_low = digits[0] >> 32;
+    uint64_t time_mid = (digits[0] >> 16) & 0xffff;
+    uint16_t time_hi_and_version = static_cast<uint16_t>(digits[0]);
+
+    /* Same rules as quid_validate */
+    if (time_low == 0) {
+        return false;
+    }
+    if ((time_hi_and_version & VersionRev7) != VersionRev7
+        && (time_hi_and_version & VersionRev4) != VersionRev4) {
+        return false;
+    }
+
+    key.hi = time_low << 4
+        | time_mid << 36
+        | static_cast<uint64_t>((time_hi_and_version ^ Magic) & 0x0fff) << 52
+        | static_cast<uint64_t>(time_hi_and_version >> 12);
+    key.lo = digits[1];
+    return true;
+}
+
+constexpr char* FormatHex(char* str, uint64_t value, int width) noexcept
+{
+    for (int i = width - 1; i >= 0; --i) {
+        *str++ = HexDigits[(value >> (i * 4)) & 0xf];
+    }
+    return str;
+}
+
+/**
+* Constant expression equivalent of quid_unpack followed by
+* quid_tostring. Writes QUID_FULLLEN characters and a terminator.
+*/
+constexpr void FormatKey(const quid128_t& key, char* str) noexcept
+{
+    uint64_t time_hi_and_version = (((key.hi >> 52) & 0x0fff) ^ Magic) | (key.hi & 0xf) << 12;
+
+    *str++ = '{';
+    str = FormatHex(str, (key.hi >> 4) & 0xffffffff, 8);
+    *str++ = '-';
+    str = FormatHex(str, (key.hi >> 36) & 0xffff, 4);
+    *str++ = '-';
+    str = FormatHex(str, time_hi_and_version, 4);
+    *str++ = '-';
+    str = FormatHex(str, key.lo >> 48, 4);
+    *str++ = '-';
+    str = FormatHex(str, key.lo & 0xffffffffffff, 12);
+    *str++ = '}';
+    *str = '\0';
+}
+
+/* Finalization mix, same as the library mix64 */
+constexpr uint64_t Mix64(uint64_t x) noexcept
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/* Packed key of a string, the nil key if the string is malformed */
+constexpr quid128_t KeyOf(std::string_view str) noexcept
+{
+    quid128_t key{ 0, 0 };
+    if (!ParseKey(str, key)) {
+        key = quid128_t{ 0, 0 };
+    }
+    return key;
+}
+
+constexpr bool KeyLess(const quid128_t& a, const quid128_t& b) noexcept
+{
+    return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+
+}
+
+/**
+* Identifier as a plain 16 byte value. The object holds the packed
+* representation only, copying is a memcpy and a default constructed
+* object is the nil identifier. New identifiers are only created
+* through an explicit call to Generate().
+*/
+class Quid
+{
+    quid128_t key;
+
 public:
+    /* Buffer large enough for the braced string representation */
+    using String = std::array<char, QUID_FULLLEN + 1>;
+
     /**
-    * Default constrcutor generates a new Quid object.
+    * Default constructor yields the nil identifier.
     */
-    Quid()
+    constexpr Quid() noexcept
+        : key{ 0, 0 }
+    {
+    }
+
+    constexpr explicit Quid(const quid128_t& key) noexcept
+        : key{ key }
+    {
+    }
+
+    explicit Quid(const cuuid_t& cuuid) noexcept
+        : key{ 0, 0 }
     {
-        GenerateNewLocalGuid();
+        quid_pack(&cuuid, &this->key);
     }
 
     /**
-    * Copy constructor will copy the provided object to the
-    * internal Quid structure.
+    * Constructor accepting a string as input. The string is supposed to
+    * be a valid quid in any of the formats accepted by quid_parse. If
+    * the conversion fails, an exception is thrown.
     *
-    * @param   other  Quid object
+    * @param   str  Quid as string
+    * @throws       InvalidQuidException
     */
-    Quid(const Quid& other)
+    explicit Quid(std::string_view str)
+        : key{ 0, 0 }
     {
-        CopyToLocalGuid(other);
+        if (!Parse(str, *this)) {
+            throw InvalidQuidException{};
+        }
     }
 
     /**
-    * Move constructor will consume the provided object and copy it
-    * to the internal Quid structure. This operation is destructive
-    * and the provided object cannot be used afterwards.
+    * Parse a string into an identifier without throwing. Uses the
+    * bounded parser, the input is neither copied nor modified.
     *
-    * @param   other  Quid object
+    * @param   str  Quid as string
+    * @return       Identifier or the reason of rejection
     */
-    Quid(Quid&& other)
+    static Expected<Quid, ParseError> TryParse(std::string_view str) noexcept
     {
-        CopyToLocalGuid(other);
+        cuuid_t cuuid;
+
+        if (str.empty()) {
+            return Unexpected<ParseError>{ ParseError::Empty };
+        }
+        if (quid_parse_n(str.data(), str.size(), &cuuid) != QUID_OK) {
+            return Unexpected<ParseError>{ ParseError::Malformed };
+        }
+
+        return Quid{ cuuid };
     }
 
     /**
-    * Constructor accepting a string as input. The string is supposted to
-    * be a new Quid object. The constructor will try to convert the provided
-    * string as Quid object. If the conversion fails, an exception is thrown.
+    * Parse a string in a constant expression. Accepts the same
+    * input as TryParse, but runs at compile time when possible.
     *
-    * @param   cquid  Quid as std::string
-    * @throws         InvalidQuidException
+    * @param   str  Quid as string
+    * @return       Identifier or the reason of rejection
     */
-    Quid(const std::string& cquid)
-        : Quid(cquid.c_str())
+    static constexpr Expected<Quid, ParseError> FromString(std::string_view str) noexcept
     {
+        quid128_t key{ 0, 0 };
+
+        if (str.empty()) {
+            return Unexpected<ParseError>{ ParseError::Empty };
+        }
+        if (!detail::ParseKey(str, key)) {
+            return Unexpected<ParseError>{ ParseError::Malformed };
+        }
+
+        return Quid{ key };
     }
 
-    explicit Quid(const char *strquid)
+    /**
+    * Parse a string into an identifier without throwing.
+    *
+    * @param   str  Quid as string
+    * @param   out  Resulting identifier, untouched on failure
+    * @return       True if the string was a valid quid
+    */
+    static bool Parse(std::string_view str, Quid& out) noexcept
     {
-        StringToQuid(strquid);
+        auto result = TryParse(str);
+        if (!result) {
+            return false;
+        }
+
+        out = *result;
+        return true;
     }
 
-    size_t UnpackedSize = UNPACKED_LENGTH;
+    /**
+    * Generate a new identifier.
+    *
+    * @param   flag      Identifier flags
+    * @param   category  Identifier category
+    * @return            New Quid object
+    * @throws            std::runtime_error
+    */
+    static Quid Generate(uint8_t flag = IDF_NULL, uint8_t category = CLS_CMON)
+    {
+        cuuid_t cuuid;
 
-    inline void Uniform(char node[4]) const noexcept
+        std::memset(&cuuid, 0, sizeof(cuuid_t));
+        cuuid.version = QUID_REV7;
+        if (quid_create(&cuuid, flag, category, nullptr) != QUID_OK) {
+            throw std::runtime_error{ "quid generation failed" };
+        }
+
+        return Quid{ cuuid };
+    }
+
+    static Quid NewGuid()
+    {
+        return Generate();
+    }
+
+    constexpr const quid128_t& Key() const noexcept { return key; }
+    constexpr uint64_t High() const noexcept { return key.hi; }
+    constexpr uint64_t Low() const noexcept { return key.lo; }
+
+    /**
+    * Timestamp in 100 nanosecond intervals, as stored in the identifier.
+    */
+    constexpr uint64_t Ticks() const noexcept { return key.hi >> 4; }
+
+    /**
+    * Internal version derived from the structure version, zero for
+    * identifiers which are neither revision 4 nor revision 7.
+    */
+    constexpr uint8_t Version() const noexcept
+    {
+        return (key.hi & 0xb) == 0xb ? QUID_REV7
+            : (key.hi & 0xa) == 0xa ? QUID_REV4
+            : 0;
+    }
+
+    constexpr bool IsNil() const noexcept { return (key.hi | key.lo) == 0; }
+
+    cuuid_t ToCuuid() const noexcept
+    {
+        cuuid_t cuuid;
+        quid_unpack(&this->key, &cuuid);
+        return cuuid;
+    }
+
+    /**
+    * Decode the flag, category and tag. For revision 7 this decrypts
+    * the node, prefer quid_decode_bulk on large batches.
+    */
+    quid_attr_t Attributes() const noexcept
+    {
+        quid_attr_t attr;
+        cuuid_t cuuid = ToCuuid();
+        quid_decode_bulk(&cuuid, 1, &attr);
+        return attr;
+    }
+
+    /**
+    * Write the braced string representation into a caller provided
+    * buffer, including the terminating null character.
+    */
+    constexpr void ToChars(char (&str)[QUID_FULLLEN + 1]) const noexcept
     {
-        assert(memcpy(node, this->quid.node, sizeof(node)));
+        detail::FormatKey(key, str);
     }
 
-    std::string Uniform() const
+    constexpr String ToArray() const noexcept
     {
-        char u[4];
-        this->Uniform(u);
-        return std::string(u, 4);
+        String str{};
+        detail::FormatKey(key, str.data());
+        return str;
     }
 
-    std::string ToString(bool useCompactFormat = false) const noexcept
+    std::string ToString(bool useCompactFormat = false) const
     {
-        char s[40];
-        quidtostr(s, &this->quid);
+        String str = ToArray();
 
-        if (useCompactFormat) { return this->Crop(s); }
+        if (useCompactFormat) {
+            return std::string(str.data() + 1, QUID_FULLLEN - 2);
+        }
 
-        return std::string(s);
+        return std::string(str.data(), QUID_FULLLEN);
     }
 
-    bool operator==(const Quid& other) const noexcept
+    constexpr bool operator==(const Quid& other) const noexcept
     {
-        return quidcmp(&this->quid, &other.quid) == 1;
+        return key.hi == other.key.hi && key.lo == other.key.lo;
     }
 
-    bool operator!=(const Quid& other) const noexcept
+    constexpr bool operator!=(const Quid& other) const noexcept
     {
-        return quidcmp(&this->quid, &other.quid) == 0;
+        return !(*this == other);
     }
 
+    /**
+    * Hash over all bits, equal to quid_hash128 but inlined.
+    */
+    constexpr uint64_t Hash() const noexcept
+    {
+        return detail::Mix64(key.hi ^ detail::Mix64(key.lo ^ 0x9e3779b97f4a7c15ULL));
+    }
+
+    /*
+    * Identifiers order by timestamp first, like quid_order128.
+    */
+#if defined(__cpp_lib_three_way_comparison)
+    constexpr std::strong_ordering operator<=>(const Quid& other) const noexcept
+    {
+        if (auto cmp = key.hi <=> other.key.hi; cmp != 0) {
+            return cmp;
+        }
+        return key.lo <=> other.key.lo;
+    }
+#else
+    constexpr bool operator<(const Quid& other) const noexcept { return detail::KeyLess(key, other.key); }
+    constexpr bool operator>(const Quid& other) const noexcept { return other < *this; }
+    constexpr bool operator<=(const Quid& other) const noexcept { return !(other < *this); }
+    constexpr bool operator>=(const Quid& other) const noexcept { return !(*this < other); }
+#endif
+
     /**
     * Write Quid object to output stream.
     *
@@ -162,23 +521,672 @@ public:
     */
     friend std::ostream& operator<<(std::ostream& os, const Quid& qt)
     {
-        os << qt.ToString();
-        return os;
+        String str = qt.ToArray();
+        return os.write(str.data(), QUID_FULLLEN);
+    }
+};
+
+static_assert(std::is_standard_layout<Quid>::value, "Quid must be layout compatible with quid128_t");
+
+/**
+* Transparent hash, equality and ordering. Containers keyed on Quid
+* can be searched with a std::string_view without formatting or
+* allocating, the string is parsed in place. A malformed string never
+* matches any identifier: it compares unequal to all of them and
+* orders after all of them, so neither hashed nor ordered containers
+* find it.
+*/
+struct QuidHash
+{
+    using is_transparent = void;
+
+    constexpr size_t operator()(const Quid& q) const noexcept
+    {
+        return static_cast<size_t>(q.Hash());
+    }
+
+    constexpr size_t operator()(std::string_view str) const noexcept
+    {
+        return static_cast<size_t>(Quid{ detail::KeyOf(str) }.Hash());
+    }
+};
+
+struct QuidEqual
+{
+    using is_transparent = void;
+
+    constexpr bool operator()(const Quid& a, const Quid& b) const noexcept { return a == b; }
+    constexpr bool operator()(const Quid& a, std::string_view b) const noexcept { return (*this)(b, a); }
+    constexpr bool operator()(std::string_view a, const Quid& b) const noexcept
+    {
+        quid128_t key{ 0, 0 };
+        return detail::ParseKey(a, key) && Quid{ key } == b;
+    }
+};
+
+struct QuidLess
+{
+    using is_transparent = void;
+
+    constexpr bool operator()(const Quid& a, const Quid& b) const noexcept
+    {
+        return detail::KeyLess(a.Key(), b.Key());
+    }
+
+    constexpr bool operator()(const Quid& a, std::string_view b) const noexcept
+    {
+        auto key = Quid::FromString(b);
+        return !key || a < *key;
+    }
+
+    constexpr bool operator()(std::string_view a, const Quid& b) const noexcept
+    {
+        auto key = Quid::FromString(a);
+        return key && *key < b;
+    }
+};
+
+class GeneratorRange;
+
+/**
+* Identifier generator over a quid_gen_t context. The context keeps
+* its own random state, timestamps are reserved in runs from the
+* sequence shared by all contexts. A generator is not thread safe,
+* use ThisThread() for a generator private to the calling thread.
+* Copying is disabled since two copies would share a random state.
+*/
+class Generator
+{
+    quid_gen_t ctx;
+
+public:
+    /**
+    * Create a generator with fixed attributes.
+    *
+    * @param   flag      Identifier flags
+    * @param   category  Identifier category
+    * @param   tag       Optional three character tag
+    * @param   version   Internal version, QUID_REV4 or QUID_REV7
+    */
+    explicit Generator(uint8_t flag = IDF_NULL, uint8_t category = CLS_CMON,
+        const char* tag = nullptr, uint8_t version = QUID_REV7) noexcept
+    {
+        quid_gen_init(&this->ctx, version, flag, category, tag);
+    }
+
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+
+    /**
+    * Generator with default attributes owned by the calling thread.
+    */
+    static Generator& ThisThread() noexcept
+    {
+        thread_local Generator gen;
+        return gen;
+    }
+
+    Quid Generate() noexcept
+    {
+        quid128_t key;
+        quid_gen_fill(&this->ctx, &key, 1);
+        return Quid{ key };
+    }
+
+    /**
+    * Fill an array with new identifiers in a single library call.
+    */
+    void GenerateInto(Quid* first, size_t n) noexcept
+    {
+        quid_gen_fill(&this->ctx, reinterpret_cast<quid128_t*>(first), n);
+    }
+
+#if defined(__cpp_lib_span)
+    void GenerateInto(std::span<Quid> out) noexcept
+    {
+        GenerateInto(out.data(), out.size());
+    }
+#endif
+
+    /**
+    * Lazy range of count new identifiers. Identifiers are generated
+    * in small batches as the range is iterated.
+    */
+    GeneratorRange Range(size_t count) noexcept;
+};
+
+/**
+* Input range over identifiers produced by a Generator. The range
+* refers to the generator, which must outlive it.
+*/
+class GeneratorRange
+{
+    static constexpr size_t BatchSize = 64;
+
+    Generator* gen;
+    size_t remaining;
+    size_t pos;
+    size_t fill;
+    std::array<Quid, BatchSize> batch;
+
+    void Refill() noexcept
+    {
+        fill = std::min(remaining, BatchSize);
+        gen->GenerateInto(batch.data(), fill);
+        remaining -= fill;
+        pos = 0;
     }
 
 public:
-    static std::string Crop(const std::string& cquid)
+    struct Sentinel {};
+
+    class Iterator
     {
-        if (cquid.size() == (UNPACKED_LENGTH + 2) && cquid[0] == '{' && cquid[UNPACKED_LENGTH + 1] == '}') {
-            return cquid.substr(1, UNPACKED_LENGTH);
+        GeneratorRange* range = nullptr;
+
+        bool AtEnd() const noexcept { return range->pos == range->fill; }
+
+    public:
+        using iterator_concept = std::input_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Quid;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Quid*;
+        using reference = const Quid&;
+
+        Iterator() = default;
+
+        explicit Iterator(GeneratorRange* range) noexcept
+            : range{ range }
+        {
         }
 
-        return "";
+        reference operator*() const noexcept { return range->batch[range->pos]; }
+        pointer operator->() const noexcept { return &range->batch[range->pos]; }
+
+        Iterator& operator++() noexcept
+        {
+            if (++range->pos == range->fill && range->remaining) {
+                range->Refill();
+            }
+            return *this;
+        }
+
+        void operator++(int) noexcept { ++*this; }
+
+        friend bool operator==(const Iterator& it, Sentinel) noexcept
+        {
+            return it.AtEnd();
+        }
+
+        friend bool operator!=(const Iterator& it, Sentinel s) noexcept { return !(it == s); }
+        friend bool operator==(Sentinel s, const Iterator& it) noexcept { return it == s; }
+        friend bool operator!=(Sentinel s, const Iterator& it) noexcept { return !(it == s); }
+    };
+
+    GeneratorRange(Generator& gen, size_t count) noexcept
+        : gen{ &gen }, remaining{ count }, pos{ 0 }, fill{ 0 }
+    {
     }
 
-    static Quid NewGuid()
+    Iterator begin() noexcept
+    {
+        if (pos == fill && remaining) {
+            Refill();
+        }
+        return Iterator{ this };
+    }
+
+    Sentinel end() const noexcept { return Sentinel{}; }
+};
+
+inline GeneratorRange Generator::Range(size_t count) noexcept
+{
+    return GeneratorRange{ *this, count };
+}
+
+/**
+* Clock policy reading the system clock in 100 nanosecond
+* intervals since the Unix epoch, the resolution of the library.
+*/
+struct SystemClock
+{
+    uint64_t operator()() const noexcept
+    {
+        using Ticks = std::chrono::duration<int64_t, std::ratio<1, 10000000>>;
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        return static_cast<uint64_t>(std::chrono::duration_cast<Ticks>(now).count());
+    }
+};
+
+/**
+* Random policy, SplitMix64. Not suitable for secrets, only used
+* to spread the clock sequence and node.
+*/
+class SplitMix64
+{
+    uint64_t state;
+
+public:
+    constexpr explicit SplitMix64(uint64_t seed) noexcept
+        : state{ seed }
+    {
+    }
+
+    constexpr uint64_t operator()() noexcept
+    {
+        uint64_t x = (state += 0x9e3779b97f4a7c15ULL);
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+};
+
+namespace detail
+{
+
+/**
+* Timestamp sequence shared by every generator reading the same clock
+* policy. Runs of timestamps are reserved with a compare-and-swap so
+* that no two generators hand out the same timestamp.
+*/
+template <typename ClockPolicy>
+struct TimeSequence
+{
+    /* Identifiers per clock interval before waiting on the clock, see quid.c */
+    static constexpr uint64_t IdsPerTick = 1024;
+
+    static inline std::atomic<uint64_t> last{ 0 };
+
+    /* First timestamp of the run, zero when the clock must be read again */
+    static uint64_t Reserve(uint64_t now, uint64_t count) noexcept
+    {
+        uint64_t prev = last.load(std::memory_order_relaxed);
+        uint64_t next;
+
+        do {
+            next = std::max(prev + 1, now);
+            if (next + count - 1 > now + IdsPerTick) {
+                return 0;
+            }
+        } while (!last.compare_exchange_weak(prev, next + count - 1, std::memory_order_relaxed));
+
+        return next;
+    }
+};
+
+/* The system clock shares the sequence of the C generator contexts */
+template <>
+struct TimeSequence<SystemClock>
+{
+    static constexpr uint64_t IdsPerTick = TimeSequence<void>::IdsPerTick;
+
+    static uint64_t Reserve(uint64_t now, uint64_t count) noexcept
+    {
+        return quid_gen_reserve(now, static_cast<size_t>(count));
+    }
+};
+
+} // namespace detail
+
+/**
+* Identifier generator with the revision, clock and random source
+* fixed at compile time. Produces the same identifiers as quid_gen_t,
+* but formats straight into the packed representation and inlines
+* everything except the node encryption of revision 7. The flag,
+* category and tag are folded into the node template on construction.
+*
+* A ClockPolicy is callable and returns the current time in 100
+* nanosecond intervals. A RngPolicy is constructible from a 64 bit
+* seed and callable, returning 64 random bits.
+*
+* Generators with the same ClockPolicy reserve their timestamps from
+* one process wide sequence, so identifiers drawn from that sequence
+* never repeat. Generators on the SystemClock share the sequence with
+* quid_gen_t and Quid::Generate(). Generators on different clock
+* policies have separate sequences and may produce the same identifier.
+*/
+template <uint8_t Revision, typename ClockPolicy = SystemClock, typename RngPolicy = SplitMix64>
+class BasicGenerator
+{
+    static_assert(Revision == QUID_REV4 || Revision == QUID_REV7,
+        "only revision 4 and revision 7 identifiers can be generated");
+
+    using Sequence = detail::TimeSequence<ClockPolicy>;
+
+    static constexpr uint64_t VersionNibble = (Revision == QUID_REV7 ? detail::VersionRev7 : detail::VersionRev4) >> 12;
+
+    ClockPolicy clock;
+    RngPolicy rng;
+    uint8_t node[6];
+
+    void Setup(uint8_t flag, uint8_t category, const char* tag) noexcept
+    {
+        node[1] = flag;
+        node[2] = category;
+
+        if constexpr (Revision == QUID_REV7) {
+            node[0] = QUID_REV7;
+            if (tag && tag[0] != 0 && tag[1] != 0 && tag[2] != 0) {
+                std::memcpy(&node[3], tag, 3);
+            } else {
+                node[3] = 0x12;
+                node[4] = 0x82;
+                node[5] = 0x7b;
+            }
+        } else {
+            uint64_t seed = rng();
+            node[0] = 0;
+            node[3] = static_cast<uint8_t>(seed);
+            node[4] = static_cast<uint8_t>(seed >> 8);
+            node[5] = 0;
+        }
+    }
+
+    uint64_t NextTime(uint64_t& now, uint64_t count = 1) noexcept
+    {
+        uint64_t next;
+
+        while (!(next = Sequence::Reserve(now, count))) {
+            now = clock();
+        }
+        return next;
+    }
+
+    quid128_t Format(uint64_t timestamp) noexcept
+    {
+        uint64_t rnd = rng();
+        uint8_t block[6];
+        uint8_t clock_seq_hi;
+        uint8_t clock_seq_low = static_cast<uint8_t>(rnd);
+
+        std::memcpy(block, node, sizeof(block));
+        if constexpr (Revision == QUID_REV7) {
+            clock_seq_hi = static_cast<uint8_t>(((rnd & 0x4e00) >> 8) | detail::Magic);
+            quid_encrypt_node(timestamp & 0xffffffff, clock_seq_hi, clock_seq_low, block);
+        } else {
+            clock_seq_hi = static_cast<uint8_t>(((rnd & 0x3f00) >> 8) | detail::Magic);
+            block[0] = static_cast<uint8_t>(rnd >> 16);
+            block[5] = static_cast<uint8_t>(rnd >> 24);
+        }
+
+        quid128_t key;
+        key.hi = (timestamp & 0x0fffffffffffffffULL) << 4 | VersionNibble;
+        key.lo = static_cast<uint64_t>(clock_seq_hi) << 56 | static_cast<uint64_t>(clock_seq_low) << 48;
+        for (int i = 0; i < 6; ++i) {
+            key.lo |= static_cast<uint64_t>(block[i]) << (40 - i * 8);
+        }
+        return key;
+    }
+
+public:
+    explicit BasicGenerator(uint8_t flag = IDF_NULL, uint8_t category = CLS_CMON,
+        const char* tag = nullptr, ClockPolicy clock = ClockPolicy{})
+        : clock{ clock }
+        , rng{ clock() ^ static_cast<uint64_t>(reinterpret_cast<uintptr_t>(this)) }
+    {
+        Setup(flag, category, tag);
+    }
+
+    BasicGenerator(uint8_t flag, uint8_t category, const char* tag, ClockPolicy clock, RngPolicy rng)
+        : clock{ clock }
+        , rng{ rng }
+    {
+        Setup(flag, category, tag);
+    }
+
+    BasicGenerator(const BasicGenerator&) = delete;
+    BasicGenerator& operator=(const BasicGenerator&) = delete;
+
+    Quid Generate() noexcept
+    {
+        uint64_t now = clock();
+        return Quid{ Format(NextTime(now)) };
+    }
+
+    void GenerateInto(Quid* first, size_t n) noexcept
+    {
+        uint64_t now = clock();
+        for (size_t i = 0; i < n;) {
+            uint64_t run = std::min<uint64_t>(n - i, Sequence::IdsPerTick);
+            uint64_t timestamp = NextTime(now, run);
+
+            for (uint64_t j = 0; j < run; ++j, ++i) {
+                first[i] = Quid{ Format(timestamp + j) };
+            }
+        }
+    }
+
+#if defined(__cpp_lib_span)
+    void GenerateInto(std::span<Quid> out) noexcept
+    {
+        GenerateInto(out.data(), out.size());
+    }
+#endif
+};
+
+#if defined(__cpp_consteval)
+inline namespace literals
+{
+
+/**
+* Identifier literal, validated during compilation. A malformed
+* literal is a compile error, not a runtime exception.
+*
+*   constexpr Quid root = "{00000001-0000-b000-0000-000000000000}"_quid;
+*/
+consteval Quid operator""_quid(const char* str, size_t len)
+{
+    quid128_t key{ 0, 0 };
+
+    if (!detail::ParseKey(std::string_view{ str, len }, key)) {
+        throw InvalidQuidException{};
+    }
+
+    return Quid{ key };
+}
+
+}
+#endif
+
+/**
+* Position and reason of a rejected token in ParseAll().
+*/
+struct ParseFailure
+{
+    size_t offset;
+    size_t length;
+    ParseError error;
+};
+
+struct ParseStats
+{
+    size_t parsed;
+    size_t failed;
+};
+
+namespace detail
+{
+
+constexpr bool IsSeparator(char c) noexcept
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',' || c == ';';
+}
+
+/* Output iterator dropping everything written to it */
+struct DiscardIterator
+{
+    using iterator_category = std::output_iterator_tag;
+    using value_type = void;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = void;
+
+    template <typename T>
+    DiscardIterator& operator=(const T&) noexcept { return *this; }
+    DiscardIterator& operator*() noexcept { return *this; }
+    DiscardIterator& operator++() noexcept { return *this; }
+    DiscardIterator& operator++(int) noexcept { return *this; }
+};
+
+}
+
+/**
+* Lazy view over the identifiers in a delimited text buffer. Tokens
+* are separated by whitespace, commas or semicolons. Advancing only
+* scans for the next token, a token is decoded when the iterator is
+* dereferenced, yielding the identifier or the reason it was
+* rejected. The buffer is neither copied nor modified and must
+* outlive the view.
+*/
+class QuidView
+#if defined(__cpp_lib_ranges)
+    : public std::ranges::view_interface<QuidView>
+#endif
+{
+    std::string_view buffer;
+
+public:
+    class Iterator
+    {
+        std::string_view buffer;
+        size_t first = 0;
+        size_t last = 0;
+
+        void Seek(size_t pos) noexcept
+        {
+            while (pos < buffer.size() && detail::IsSeparator(buffer[pos])) {
+                ++pos;
+            }
+            first = pos;
+            while (pos < buffer.size() && !detail::IsSeparator(buffer[pos])) {
+                ++pos;
+            }
+            last = pos;
+        }
+
+    public:
+        using iterator_concept = std::forward_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Expected<Quid, ParseError>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        Iterator() = default;
+
+        Iterator(std::string_view buffer, size_t pos) noexcept
+            : buffer{ buffer }
+        {
+            Seek(pos);
+        }
+
+        value_type operator*() const noexcept { return Quid::TryParse(Token()); }
+
+        /* Current token and its position in the buffer */
+        std::string_view Token() const noexcept { return buffer.substr(first, last - first); }
+        size_t Offset() const noexcept { return first; }
+
+        Iterator& operator++() noexcept
+        {
+            Seek(last);
+            return *this;
+        }
+
+        Iterator operator++(int) noexcept
+        {
+            Iterator it = *this;
+            Seek(last);
+            return it;
+        }
+
+        friend bool operator==(const Iterator& a, const Iterator& b) noexcept { return a.first == b.first; }
+        friend bool operator!=(const Iterator& a, const Iterator& b) noexcept { return a.first != b.first; }
+    };
+
+    QuidView() = default;
+
+    explicit QuidView(std::string_view buffer) noexcept
+        : buffer{ buffer }
+    {
+    }
+
+    Iterator begin() const noexcept { return Iterator{ buffer, 0 }; }
+    Iterator end() const noexcept { return Iterator{ buffer, buffer.size() }; }
+};
+
+/**
+* Iterate the identifiers of a buffer lazily, see QuidView.
+*
+*   for (auto id : ParseView(text)) { if (id) ... }
+*/
+inline QuidView ParseView(std::string_view buffer) noexcept
+{
+    return QuidView{ buffer };
+}
+
+/**
+* Parse every identifier in a buffer. Tokens are separated by
+* whitespace, commas or semicolons. Valid identifiers are written
+* to the output iterator, rejected tokens to the error iterator.
+* No exception is raised for malformed input.
+*
+* @param   buffer  Input buffer
+* @param   out     Output iterator accepting Quid
+* @param   errors  Output iterator accepting ParseFailure
+* @return          Number of parsed and rejected tokens
+*/
+template <typename OutputIt, typename ErrorIt>
+ParseStats ParseAll(std::string_view buffer, OutputIt out, ErrorIt errors)
+{
+    ParseStats stats{ 0, 0 };
+    QuidView view{ buffer };
+
+    for (auto it = view.begin(); it != view.end(); ++it) {
+        auto result = *it;
+        if (result) {
+            *out++ = *result;
+            stats.parsed++;
+        } else {
+            *errors++ = ParseFailure{ it.Offset(), it.Token().size(), result.error() };
+            stats.failed++;
+        }
+    }
+
+    return stats;
+}
+
+template <typename OutputIt>
+ParseStats ParseAll(std::string_view buffer, OutputIt out)
+{
+    return ParseAll(buffer, out, detail::DiscardIterator{});
+}
+
+static_assert(std::is_trivially_copyable<Quid>::value, "Quid must be trivially copyable");
+static_assert(sizeof(Quid) == sizeof(quid128_t), "Quid must not carry additional state");
+
+}
+
+#if defined(__cpp_lib_ranges)
+namespace std::ranges
+{
+
+/* Iterators refer to the buffer, not to the view */
+template <>
+inline constexpr bool enable_borrowed_range<quidpp::QuidView> = true;
+
+}
+#endif
+
+namespace std
+{
+
+template <>
+struct hash<quidpp::Quid>
+{
+    size_t operator()(const quidpp::Quid& q) const noexcept
     {
-        return std::move(Quid{});
+        return static_cast<size_t>(q.Hash());
     }
 };
 
@@ -0,0 +1,654 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Inverted index over identifier attributes. Flag, category and tag
+ * are decoded once for all rows, then every distinct category, flag
+ * bit and tag gets a posting list of row numbers. Posting lists are
+ * compressed bitmaps: rows are split in chunks of 65536 and each chunk
+ * is stored as a sorted array of 16 bit offsets, or as a plain bitmap
+ * once that is smaller. The index lives in a single flat buffer which
+ * can be written to disk as is and mapped back in as a read only view.
+ * The buffer uses the native byte order.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <quid.h>
+
+#include "bits.h"
+
+#define ATTR_MAGIC      0x52544151      /* "QATR" */
+#define ATTR_FORMAT     1               /* Flat buffer format version */
+#define ATTR_HEADER     64              /* Header size, padded to a cache line */
+#define ATTR_ALIGN      64              /* Buffer alignment */
+
+#define CHUNK_BITS      16              /* Row bits addressed by a container */
+#define CHUNK_WORDS     1024            /* 64 bit words in a bitmap container */
+#define ARRAY_MAX       4096            /* Largest array container */
+
+enum {
+    CONTAINER_ARRAY = 1,
+    CONTAINER_BITMAP = 2,
+};
+
+typedef struct {
+    uint32_t    magic;
+    uint32_t    format;
+    uint64_t    count;                  /* Number of rows */
+    uint64_t    nlists;                 /* Number of posting lists */
+    uint64_t    data;                   /* Offset of container section */
+    uint64_t    length;                 /* Size of flat buffer */
+} attr_header_t;
+
+typedef struct {
+    uint32_t    field;                  /* Attribute key */
+    uint32_t    value;                  /* Category, flag bit or tag */
+    uint32_t    count;                  /* Rows in list */
+    uint32_t    ncontainers;            /* Containers in list */
+    uint64_t    offset;                 /* Container table, relative to data */
+} attr_list_t;
+
+typedef struct {
+    uint16_t    chunk;                  /* Upper bits of row numbers */
+    uint16_t    type;                   /* Array or bitmap */
+    uint32_t    count;                  /* Rows in container */
+    uint64_t    offset;                 /* Payload, relative to data */
+} attr_container_t;
+
+struct quid_attrindex {
+    attr_header_t   *header;            /* Start of the flat buffer */
+    attr_list_t     *lists;             /* Posting list directory */
+    uint8_t         *data;              /* Container section */
+    void            *alloc;             /* Owned allocation, NULL for views */
+};
+
+typedef struct {
+    uint32_t    field;
+    uint32_t    value;
+    uint32_t    count;
+    uint32_t    *rows;                  /* Sorted row numbers */
+} posting_t;
+
+typedef struct {
+    uint8_t     *data;
+    size_t      length;
+    size_t      capacity;
+} buffer_t;
+
+/* Reserve aligned space at the end of the buffer, returns offset or SIZE_MAX */
+static size_t buffer_push(buffer_t *buffer, size_t length) {
+    size_t offset = (buffer->length + 7) & ~(size_t)7;
+
+    if (offset + length > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        uint8_t *data;
+
+        while (offset + length > capacity) {
+            capacity *= 2;
+        }
+
+        data = realloc(buffer->data, capacity);
+        if (!data) {
+            return SIZE_MAX;
+        }
+        memset(data + buffer->capacity, 0, capacity - buffer->capacity);
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+
+    buffer->length = offset + length;
+    return offset;
+}
+
+/* Encode sorted rows as containers, returns offset of container table */
+static size_t encode_list(buffer_t *buffer, const uint32_t *rows, uint32_t count, uint32_t *ncontainers) {
+    size_t table, n = 0;
+
+    /* Count chunks to size the container table */
+    for (uint32_t i = 0; i < count; ++i) {
+        n += !i || (rows[i] >> CHUNK_BITS) != (rows[i - 1] >> CHUNK_BITS);
+    }
+
+    table = buffer_push(buffer, n * sizeof(attr_container_t));
+    if (table == SIZE_MAX) {
+        return SIZE_MAX;
+    }
+
+    *ncontainers = (uint32_t)n;
+    n = 0;
+    for (uint32_t i = 0; i < count;) {
+        uint32_t chunk = rows[i] >> CHUNK_BITS;
+        uint32_t end = i;
+        attr_container_t container;
+        size_t payload;
+
+        while (end < count && (rows[end] >> CHUNK_BITS) == chunk) {
+            end++;
+        }
+
+        container.chunk = (uint16_t)chunk;
+        container.count = end - i;
+        if (container.count > ARRAY_MAX) {
+            uint64_t *words;
+
+            container.type = CONTAINER_BITMAP;
+            payload = buffer_push(buffer, CHUNK_WORDS * sizeof(uint64_t));
+            if (payload == SIZE_MAX) {
+                return SIZE_MAX;
+            }
+
+            words = (uint64_t *)(buffer->data + payload);
+            for (uint32_t j = i; j < end; ++j) {
+                uint16_t bit = (uint16_t)rows[j];
+                words[bit >> 6] |= 1ULL << (bit & 63);
+            }
+        } else {
+            uint16_t *array;
+
+            container.type = CONTAINER_ARRAY;
+            payload = buffer_push(buffer, container.count * sizeof(uint16_t));
+            if (payload == SIZE_MAX) {
+                return SIZE_MAX;
+            }
+
+            array = (uint16_t *)(buffer->data + payload);
+            for (uint32_t j = i; j < end; ++j) {
+                array[j - i] = (uint16_t)rows[j];
+            }
+        }
+
+        container.offset = payload;
+        memcpy(buffer->data + table + n * sizeof(attr_container_t), &container, sizeof(attr_container_t));
+        n++;
+        i = end;
+    }
+
+    return table;
+}
+
+static inline uint32_t tag_value(const char tag[3]) {
+    return (uint32_t)(uint8_t)tag[0] << 16 | (uint32_t)(uint8_t)tag[1] << 8 | (uint8_t)tag[2];
+}
+
+static int compare_pair(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Build attribute index over identifiers. Row numbers are positions
+ * in the array.
+ *
+ * @param   cuuid  Array of quid structures
+ * @param   n      Number of elements in the array, at most UINT32_MAX
+ * @return         New index or NULL on faillure
+ */
+QUID_LIB_API quid_attrindex_t *quid_attrindex_build(const cuuid_t *cuuid, size_t n) {
+    quid_attrindex_t *index = NULL;
+    quid_attr_t *attr = NULL;
+    posting_t postings[256 + 8];
+    uint32_t *rows = NULL;
+    uint64_t *pairs = NULL;
+    uint32_t categories[256] = {0};
+    uint32_t flags[8] = {0};
+    size_t nlists = 0, ntags = 0, directory, length;
+    attr_list_t *lists = NULL;
+    buffer_t buffer = {0};
+    attr_header_t *header;
+    uint8_t *base;
+
+    if ((!cuuid && n) || n > UINT32_MAX) { return NULL; }
+
+    attr = malloc((n ? n : 1) * sizeof(quid_attr_t));
+    rows = malloc((n ? n : 1) * 9 * sizeof(uint32_t));
+    pairs = malloc((n ? n : 1) * sizeof(uint64_t));
+    if (!attr || !rows || !pairs) {
+        goto done;
+    }
+
+    quid_decode_bulk(cuuid, n, attr);
+
+    /* Histogram of categories and flag bits */
+    for (size_t i = 0; i < n; ++i) {
+        if (!attr[i].version) {
+            continue;
+        }
+        categories[attr[i].category]++;
+        for (int b = 0; b < 8; ++b) {
+            flags[b] += (attr[i].flag >> b) & 1;
+        }
+    }
+
+    /* Carve row arrays from the scratch space, one row can be in nine lists */
+    uint32_t *next = rows;
+    for (int c = 0; c < 256; ++c) {
+        if (categories[c]) {
+            postings[nlists++] = (posting_t){ QUID_KEY_CATEGORY, (uint32_t)c, 0, next };
+            next += categories[c];
+        }
+    }
+    for (int b = 0; b < 8; ++b) {
+        if (flags[b]) {
+            postings[nlists++] = (posting_t){ QUID_KEY_FLAG, 1U << b, 0, next };
+            next += flags[b];
+        }
+    }
+
+    /* Rows are visited in order, lists come out sorted */
+    for (size_t i = 0; i < n; ++i) {
+        if (!attr[i].version) {
+            continue;
+        }
+        for (size_t l = 0; l < nlists; ++l) {
+            posting_t *posting = &postings[l];
+            int match = (posting->field == QUID_KEY_CATEGORY)
+                ? attr[i].category == posting->value
+                : (attr[i].flag & posting->value) != 0;
+            if (match) {
+                posting->rows[posting->count++] = (uint32_t)i;
+            }
+        }
+        pairs[ntags++] = (uint64_t)tag_value(attr[i].tag) << 32 | (uint64_t)i;
+    }
+
+    if (ntags) {
+        qsort(pairs, ntags, sizeof(uint64_t), compare_pair);
+    }
+
+    /* Count distinct tags */
+    size_t ndistinct = 0;
+    for (size_t i = 0; i < ntags; ++i) {
+        ndistinct += !i || (pairs[i] >> 32) != (pairs[i - 1] >> 32);
+    }
+
+    lists = calloc(nlists + ndistinct + 1, sizeof(attr_list_t));
+    if (!lists) {
+        goto done;
+    }
+
+    for (size_t l = 0; l < nlists; ++l) {
+        lists[l].field = postings[l].field;
+        lists[l].value = postings[l].value;
+        lists[l].count = postings[l].count;
+        lists[l].offset = encode_list(&buffer, postings[l].rows, postings[l].count, &lists[l].ncontainers);
+        if (lists[l].offset == SIZE_MAX) {
+            goto done;
+        }
+    }
+
+    for (size_t i = 0; i < ntags;) {
+        uint32_t value = (uint32_t)(pairs[i] >> 32);
+        size_t end = i;
+
+        while (end < ntags && (uint32_t)(pairs[end] >> 32) == value) {
+            rows[end - i] = (uint32_t)pairs[end];
+            end++;
+        }
+
+        lists[nlists].field = QUID_KEY_TAG;
+        lists[nlists].value = value;
+        lists[nlists].count = (uint32_t)(end - i);
+        lists[nlists].offset = encode_list(&buffer, rows, (uint32_t)(end - i), &lists[nlists].ncontainers);
+        if (lists[nlists].offset == SIZE_MAX) {
+            goto done;
+        }
+        nlists++;
+        i = end;
+    }
+
+    /* Assemble flat buffer */
+    directory = (nlists * sizeof(attr_list_t) + ATTR_ALIGN - 1) & ~(size_t)(ATTR_ALIGN - 1);
+    length = ATTR_HEADER + directory + buffer.length;
+
+    index = malloc(sizeof(quid_attrindex_t));
+    if (!index) {
+        goto done;
+    }
+
+    index->alloc = calloc(1, length + ATTR_ALIGN);
+    if (!index->alloc) {
+        free(index);
+        index = NULL;
+        goto done;
+    }
+
+    base = (uint8_t *)(((uintptr_t)index->alloc + ATTR_ALIGN - 1) & ~(uintptr_t)(ATTR_ALIGN - 1));
+    header = (attr_header_t *)base;
+    header->magic = ATTR_MAGIC;
+    header->format = ATTR_FORMAT;
+    header->count = n;
+    header->nlists = nlists;
+    header->data = ATTR_HEADER + directory;
+    header->length = length;
+
+    if (nlists) {
+        memcpy(base + ATTR_HEADER, lists, nlists * sizeof(attr_list_t));
+    }
+    if (buffer.length) {
+        memcpy(base + header->data, buffer.data, buffer.length);
+    }
+
+    index->header = header;
+    index->lists = (attr_list_t *)(base + ATTR_HEADER);
+    index->data = base + header->data;
+
+done:
+    free(attr);
+    free(rows);
+    free(pairs);
+    free(lists);
+    free(buffer.data);
+    return index;
+}
+
+/**
+ * Open attribute index on flat buffer, for instance a mapped file.
+ * The buffer must outlive the view and be 8 byte aligned.
+ *
+ * @param   buffer  Flat buffer as returned by quid_attrindex_data
+ * @param   length  Size of the buffer
+ * @return          New view or NULL if the buffer is invalid
+ */
+QUID_LIB_API quid_attrindex_t *quid_attrindex_view(const void *buffer, size_t length) {
+    const attr_header_t *header = (const attr_header_t *)buffer;
+    const attr_list_t *lists;
+    quid_attrindex_t *index;
+    size_t data_length;
+
+    if (!buffer || length < ATTR_HEADER || ((uintptr_t)buffer % sizeof(uint64_t))) {
+        return NULL;
+    }
+
+    if (header->magic != ATTR_MAGIC || header->format != ATTR_FORMAT
+        || header->length > length || header->data < ATTR_HEADER || header->data > header->length
+        || header->data % sizeof(uint64_t)
+        || header->nlists > (header->data - ATTR_HEADER) / sizeof(attr_list_t)) {
+        return NULL;
+    }
+
+    /* Posting lists must stay within the buffer */
+    lists = (const attr_list_t *)((const uint8_t *)buffer + ATTR_HEADER);
+    data_length = (size_t)(header->length - header->data);
+    for (uint64_t l = 0; l < header->nlists; ++l) {
+        const attr_container_t *table;
+
+        if (lists[l].offset % sizeof(uint64_t) || lists[l].offset > data_length
+            || lists[l].ncontainers > (data_length - lists[l].offset) / sizeof(attr_container_t)) {
+            return NULL;
+        }
+
+        table = (const attr_container_t *)((const uint8_t *)buffer + header->data + lists[l].offset);
+
+        for (uint32_t c = 0; c < lists[l].ncontainers; ++c) {
+            size_t payload = (table[c].type == CONTAINER_BITMAP)
+                ? CHUNK_WORDS * sizeof(uint64_t)
+                : table[c].count * sizeof(uint16_t);
+
+            if ((table[c].type != CONTAINER_BITMAP && (table[c].type != CONTAINER_ARRAY || table[c].count > ARRAY_MAX))
+                || table[c].offset % sizeof(uint64_t) || table[c].offset > data_length
+                || payload > data_length - table[c].offset) {
+                return NULL;
+            }
+        }
+    }
+
+    index = malloc(sizeof(quid_attrindex_t));
+    if (!index) {
+        return NULL;
+    }
+
+    index->header = (attr_header_t *)buffer;
+    index->lists = (attr_list_t *)((uint8_t *)buffer + ATTR_HEADER);
+    index->data = (uint8_t *)buffer + header->data;
+    index->alloc = NULL;
+
+    return index;
+}
+
+/* Release index or view */
+QUID_LIB_API void quid_attrindex_free(quid_attrindex_t *index) {
+    if (!index) { return; }
+
+    free(index->alloc);
+    free(index);
+}
+
+/* Number of rows in index */
+QUID_LIB_API size_t quid_attrindex_size(const quid_attrindex_t *index) {
+    assert(index);
+    return (size_t)index->header->count;
+}
+
+/**
+ * Retrieve flat buffer of index. The buffer can be stored and
+ * opened with quid_attrindex_view later on.
+ *
+ * @param   index   Attribute index
+ * @param   length  Output size of the buffer
+ * @return          Flat buffer
+ */
+QUID_LIB_API const void *quid_attrindex_data(const quid_attrindex_t *index, size_t *length) {
+    assert(index);
+
+    if (length) {
+        *length = (size_t)index->header->length;
+    }
+
+    return index->header;
+}
+
+/* Find posting list in directory */
+static const attr_list_t *find_list(const quid_attrindex_t *index, uint32_t field, uint32_t value) {
+    size_t lo = 0, hi = (size_t)index->header->nlists;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const attr_list_t *list = &index->lists[mid];
+
+        if (list->field < field || (list->field == field && list->value < value)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo < index->header->nlists && index->lists[lo].field == field && index->lists[lo].value == value) {
+        return &index->lists[lo];
+    }
+
+    return NULL;
+}
+
+static inline const attr_container_t *list_containers(const quid_attrindex_t *index, const attr_list_t *list) {
+    return (const attr_container_t *)(index->data + list->offset);
+}
+
+/* Find container of chunk in list */
+static const attr_container_t *find_container(const quid_attrindex_t *index, const attr_list_t *list, uint16_t chunk) {
+    const attr_container_t *table = list_containers(index, list);
+    size_t lo = 0, hi = list->ncontainers;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (table[mid].chunk < chunk) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return (lo < list->ncontainers && table[lo].chunk == chunk) ? &table[lo] : NULL;
+}
+
+/* Expand container into bitmap */
+static void load_container(const quid_attrindex_t *index, const attr_container_t *container, uint64_t *words) {
+    if (container->type == CONTAINER_BITMAP) {
+        memcpy(words, index->data + container->offset, CHUNK_WORDS * sizeof(uint64_t));
+        return;
+    }
+
+    const uint16_t *array = (const uint16_t *)(index->data + container->offset);
+    memset(words, 0, CHUNK_WORDS * sizeof(uint64_t));
+    for (uint32_t i = 0; i < container->count; ++i) {
+        words[array[i] >> 6] |= 1ULL << (array[i] & 63);
+    }
+}
+
+/* Intersect bitmap with container */
+static void and_container(const quid_attrindex_t *index, const attr_container_t *container, uint64_t *words, uint64_t *scratch) {
+    if (container->type == CONTAINER_BITMAP) {
+        const uint64_t *other = (const uint64_t *)(index->data + container->offset);
+        for (int i = 0; i < CHUNK_WORDS; ++i) {
+            words[i] &= other[i];
+        }
+        return;
+    }
+
+    load_container(index, container, scratch);
+    for (int i = 0; i < CHUNK_WORDS; ++i) {
+        words[i] &= scratch[i];
+    }
+}
+
+static int compare_list(const void *a, const void *b) {
+    const attr_list_t *x = *(const attr_list_t *const *)a;
+    const attr_list_t *y = *(const attr_list_t *const *)b;
+
+    return (x->count > y->count) - (x->count < y->count);
+}
+
+/**
+ * Find rows matching all terms. A flag term matches rows with all of
+ * its flag bits set, a zero tag matches untagged rows.
+ *
+ * @param   index   Attribute index
+ * @param   terms   Array of terms
+ * @param   nterms  Number of terms, no terms matches all rows
+ * @param   rows    Output row numbers in ascending order, must hold
+ *                  quid_attrindex_size elements
+ * @return          Number of matching rows
+ */
+QUID_LIB_API size_t quid_attrindex_query(const quid_attrindex_t *index, const quid_term_t *terms, size_t nterms, uint32_t *rows) {
+    const attr_list_t **lists;
+    uint64_t words[CHUNK_WORDS], scratch[CHUNK_WORDS];
+    size_t nlists = 0, count = 0;
+
+    if (!index || (!terms && nterms) || !rows) { return 0; }
+
+    /* A flag term resolves to a list per bit */
+    lists = malloc((nterms ? nterms : 1) * 8 * sizeof(attr_list_t *));
+    if (!lists) {
+        return 0;
+    }
+
+    /* Resolve terms to posting lists */
+    for (size_t t = 0; t < nterms; ++t) {
+        switch (terms[t].key) {
+            case QUID_KEY_CATEGORY:
+            case QUID_KEY_TAG: {
+                uint32_t value = (terms[t].key == QUID_KEY_TAG) ? tag_value(terms[t].tag) : terms[t].value;
+                const attr_list_t *list = find_list(index, (uint32_t)terms[t].key, value);
+                if (!list) {
+                    goto done;
+                }
+                lists[nlists++] = list;
+                break;
+            }
+            case QUID_KEY_FLAG:
+                for (int b = 0; b < 8; ++b) {
+                    const attr_list_t *list;
+                    if (!(terms[t].value & (1U << b))) {
+                        continue;
+                    }
+                    list = find_list(index, QUID_KEY_FLAG, 1U << b);
+                    if (!list) {
+                        goto done;
+                    }
+                    lists[nlists++] = list;
+                }
+                break;
+            default:
+                goto done;
+        }
+    }
+
+    if (!nlists) {
+        for (uint64_t i = 0; i < index->header->count; ++i) {
+            rows[count++] = (uint32_t)i;
+        }
+        goto done;
+    }
+
+    /* Drive the intersection from the shortest list */
+    qsort(lists, nlists, sizeof(attr_list_t *), compare_list);
+
+    const attr_container_t *table = list_containers(index, lists[0]);
+    for (uint32_t c = 0; c < lists[0]->ncontainers; ++c) {
+        uint32_t base = (uint32_t)table[c].chunk << CHUNK_BITS;
+        size_t l;
+
+        if (nlists == 1 && table[c].type == CONTAINER_ARRAY) {
+            const uint16_t *array = (const uint16_t *)(index->data + table[c].offset);
+            for (uint32_t i = 0; i < table[c].count; ++i) {
+                rows[count++] = base | array[i];
+            }
+            continue;
+        }
+
+        load_container(index, &table[c], words);
+        for (l = 1; l < nlists; ++l) {
+            const attr_container_t *other = find_container(index, lists[l], table[c].chunk);
+            if (!other) {
+                break;
+            }
+            and_container(index, other, words, scratch);
+        }
+
+        if (l < nlists) {
+            continue;
+        }
+
+        for (int i = 0; i < CHUNK_WORDS; ++i) {
+            uint64_t w = words[i];
+            while (w) {
+                rows[count++] = base | (uint32_t)(i << 6) | (uint32_t)bit_ctz64(w);
+                w &= w - 1;
+            }
+        }
+    }
+
+done:
+    free(lists);
+    return count;
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __QBITS__
+#define __QBITS__
+
+#ifdef _WIN32
+# pragma once
+#endif
+
+#include <stdint.h>
+
+#define QUIDMAGIC       0x80            /* QUID Timestamp magic */
+#define NS_PER_TICK     100             /* Nanoseconds per timestamp tick */
+#define TIMESTAMP_MAX   (1ULL << 60)    /* Timestamps span 60 bits */
+
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+# include <emmintrin.h>
+# define HAS_SSE2 1
+#endif
+
+/* Count trailing zero bits, input must be non-zero */
+static inline int bit_ctz32(uint32_t x) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return (int)i;
+#else
+    return __builtin_ctz(x);
+#endif
+}
+
+/* Count trailing zero bits, input must be non-zero */
+static inline int bit_ctz64(uint64_t x) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward64(&i, x);
+    return (int)i;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+/* Count set bits */
+static inline int bit_popcount64(uint64_t x) {
+#ifdef _MSC_VER
+    return (int)__popcnt64(x);
+#else
+    return __builtin_popcountll(x);
+#endif
+}
+
+/* Position of the r-th set bit, counting from zero */
+static inline int bit_select64(uint64_t x, int r) {
+    while (r--) {
+        x &= x - 1;
+    }
+    return bit_ctz64(x);
+}
+
+/* Hint the processor to fetch the cache line holding address */
+#if defined(__GNUC__)
+# define bit_prefetch(p) __builtin_prefetch(p)
+#elif defined(HAS_SSE2)
+# define bit_prefetch(p) _mm_prefetch((const char *)(p), _MM_HINT_T0)
+#else
+# define bit_prefetch(p) ((void)(p))
+#endif
+
+/*
+ * Smallest timestamp tick not earlier than time in nanoseconds. Any
+ * int64_t time is well below TIMESTAMP_MAX ticks, so no clamp is needed.
+ */
+static inline uint64_t ns_to_ticks(int64_t ns) {
+    return (ns <= 0) ? 0 : ((uint64_t)ns + NS_PER_TICK - 1) / NS_PER_TICK;
+}
+
+/* Finalization mix, avalanches all bits of the input */
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/* Map 32 bit value uniformly onto range [0, n) without division */
+static inline uint32_t bit_reduce32(uint32_t x, uint32_t n) {
+    return (uint32_t)(((uint64_t)x * n) >> 32);
+}
+
+#endif // __QBITS__
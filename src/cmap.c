@@ -0,0 +1,502 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Concurrent hash map keyed by identifier. The map is split in shards
+ * selected by the upper bits of the identifier hash. Writers serialize
+ * per shard on a mutex, readers never take the mutex. Each shard is
+ * guarded by a sequence lock: readers probe optimistically and retry if
+ * a writer modified the same shard in the meantime, so a reader waits
+ * for the write section of its shard to finish. Reads are not wait free.
+ *
+ * Deleted slots are dropped by rehashing the table in place inside the
+ * write section. Tables replaced by a larger one are retired, not
+ * released, until the map is destroyed so that readers never touch
+ * released memory. Capacity doubles on every resize, so the retired
+ * tables of a shard never take more memory than the current table.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <assert.h>
+
+#include <quid.h>
+
+#include "thread.h"
+
+#define SLOT_EMPTY      0               /* Slot never used */
+#define SLOT_FULL       1               /* Slot holds entry */
+#define SLOT_DELETED    2               /* Slot held entry, probe on */
+#define MIN_CAPACITY    16              /* Smallest table per shard */
+#define MAX_SHARD_BITS  12              /* At most 4096 shards */
+#define CACHE_LINE      64              /* Keep shards apart */
+#define SPIN_YIELD      64              /* Yield after spinning on writer */
+
+/**
+ * Slot members are atomic since readers race with writers, relaxed
+ * access is sufficient as the sequence lock orders the accesses.
+ */
+typedef struct {
+    _Atomic uint64_t    hi;
+    _Atomic uint64_t    lo;
+    _Atomic(void *)     value;
+} cslot_t;
+
+typedef struct ctable {
+    size_t          capacity;           /* Number of slots, power of two */
+    struct ctable   *retired;           /* Replaced tables */
+    atomic_uchar    *state;             /* State per slot */
+    cslot_t         *slots;             /* Entries */
+} ctable_t;
+
+typedef struct {
+    atomic_uint         seq;            /* Odd while writer is active */
+    _Atomic(ctable_t *) table;          /* Current table */
+    qmutex_t            lock;           /* Writer lock */
+    size_t              size;           /* Live entries */
+    size_t              used;           /* Full and deleted slots */
+    char                pad[CACHE_LINE];
+} shard_t;
+
+struct quid_cmap {
+    shard_t         *shards;
+    unsigned int    shard_bits;
+};
+
+static ctable_t *ctable_new(size_t capacity) {
+    ctable_t *t = malloc(sizeof(ctable_t));
+    if (!t) {
+        return NULL;
+    }
+
+    t->capacity = capacity;
+    t->retired = NULL;
+    t->state = calloc(capacity, sizeof(atomic_uchar));
+    t->slots = calloc(capacity, sizeof(cslot_t));
+    if (!t->state || !t->slots) {
+        free(t->state);
+        free(t->slots);
+        free(t);
+        return NULL;
+    }
+
+    return t;
+}
+
+/* Release table and all tables it replaced */
+static void ctable_free(ctable_t *t) {
+    while (t) {
+        ctable_t *retired = t->retired;
+        free(t->state);
+        free(t->slots);
+        free(t);
+        t = retired;
+    }
+}
+
+/**
+ * Find slot of key. May run concurrently with a writer, in which case
+ * the result is discarded by the caller. The probe is bounded by the
+ * capacity so a torn table cannot trap the reader.
+ *
+ * @param   deleted  First deleted slot on the probe sequence, may be NULL
+ * @return           Slot index or capacity if the key is not present
+ */
+static size_t ctable_find(ctable_t *t, const quid128_t *key, uint64_t hash, size_t *deleted) {
+    size_t mask = t->capacity - 1;
+    size_t slot = (size_t)hash & mask;
+
+    if (deleted) {
+        *deleted = t->capacity;
+    }
+
+    for (size_t n = 0; n < t->capacity; ++n, slot = (slot + 1) & mask) {
+        unsigned char state = atomic_load_explicit(&t->state[slot], memory_order_relaxed);
+        if (state == SLOT_EMPTY) {
+            break;
+        }
+
+        if (state == SLOT_DELETED) {
+            if (deleted && *deleted == t->capacity) {
+                *deleted = slot;
+            }
+            continue;
+        }
+
+        if (atomic_load_explicit(&t->slots[slot].hi, memory_order_relaxed) == key->hi
+            && atomic_load_explicit(&t->slots[slot].lo, memory_order_relaxed) == key->lo) {
+            return slot;
+        }
+    }
+
+    return t->capacity;
+}
+
+/* Claim free slot for key, table must have room */
+static size_t ctable_claim(ctable_t *t, uint64_t hash) {
+    size_t mask = t->capacity - 1;
+    size_t slot = (size_t)hash & mask;
+
+    while (atomic_load_explicit(&t->state[slot], memory_order_relaxed) == SLOT_FULL) {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+static inline void ctable_store(ctable_t *t, size_t slot, const quid128_t *key, void *value) {
+    atomic_store_explicit(&t->slots[slot].hi, key->hi, memory_order_relaxed);
+    atomic_store_explicit(&t->slots[slot].lo, key->lo, memory_order_relaxed);
+    atomic_store_explicit(&t->slots[slot].value, value, memory_order_relaxed);
+    atomic_store_explicit(&t->state[slot], SLOT_FULL, memory_order_relaxed);
+}
+
+/**
+ * Drop deleted slots without allocating. Live entries are marked
+ * deleted and then moved to the first free slot of their probe
+ * sequence, swapping with entries which still have to be moved.
+ * Entries put in place only pass over slots that stay full, so no
+ * probe sequence is cut short. Readers racing with the rehash see a
+ * torn table and retry on the sequence lock.
+ */
+static void ctable_rehash(ctable_t *t) {
+    for (size_t i = 0; i < t->capacity; ++i) {
+        unsigned char state = atomic_load_explicit(&t->state[i], memory_order_relaxed);
+        atomic_store_explicit(&t->state[i], state == SLOT_FULL ? SLOT_DELETED : SLOT_EMPTY, memory_order_relaxed);
+    }
+
+    for (size_t i = 0; i < t->capacity; ++i) {
+        while (atomic_load_explicit(&t->state[i], memory_order_relaxed) == SLOT_DELETED) {
+            quid128_t key;
+            key.hi = atomic_load_explicit(&t->slots[i].hi, memory_order_relaxed);
+            key.lo = atomic_load_explicit(&t->slots[i].lo, memory_order_relaxed);
+            void *value = atomic_load_explicit(&t->slots[i].value, memory_order_relaxed);
+
+            size_t target = ctable_claim(t, quid_hash128(&key));
+            if (target == i) {
+                atomic_store_explicit(&t->state[i], SLOT_FULL, memory_order_relaxed);
+                break;
+            }
+
+            if (atomic_load_explicit(&t->state[target], memory_order_relaxed) == SLOT_EMPTY) {
+                ctable_store(t, target, &key, value);
+                atomic_store_explicit(&t->state[i], SLOT_EMPTY, memory_order_relaxed);
+                break;
+            }
+
+            /* Target waits to be moved as well, swap and move that entry next */
+            quid128_t other;
+            other.hi = atomic_load_explicit(&t->slots[target].hi, memory_order_relaxed);
+            other.lo = atomic_load_explicit(&t->slots[target].lo, memory_order_relaxed);
+            void *other_value = atomic_load_explicit(&t->slots[target].value, memory_order_relaxed);
+
+            ctable_store(t, target, &key, value);
+            atomic_store_explicit(&t->slots[i].hi, other.hi, memory_order_relaxed);
+            atomic_store_explicit(&t->slots[i].lo, other.lo, memory_order_relaxed);
+            atomic_store_explicit(&t->slots[i].value, other_value, memory_order_relaxed);
+        }
+    }
+}
+
+/* Keep load including deleted slots under 3/4 */
+static inline size_t ctable_max_load(size_t capacity) {
+    return capacity - capacity / 4;
+}
+
+/* Enter shard write section, caller holds the shard lock */
+static inline void shard_write_begin(shard_t *shard) {
+    unsigned int seq = atomic_load_explicit(&shard->seq, memory_order_relaxed);
+    atomic_store_explicit(&shard->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void shard_write_end(shard_t *shard) {
+    unsigned int seq = atomic_load_explicit(&shard->seq, memory_order_relaxed);
+    atomic_store_explicit(&shard->seq, seq + 1, memory_order_release);
+}
+
+/**
+ * Make room in the shard table. When most used slots are deleted the
+ * table is rehashed in place, otherwise it is replaced by one of twice
+ * the capacity. The new table is populated before it is published, the
+ * old table is retired. Must run inside the shard write section.
+ */
+static int shard_grow(shard_t *shard) {
+    ctable_t *t = atomic_load_explicit(&shard->table, memory_order_relaxed);
+
+    if (shard->size < ctable_max_load(t->capacity) / 2) {
+        ctable_rehash(t);
+        shard->used = shard->size;
+        return 1;
+    }
+
+    ctable_t *n = ctable_new(t->capacity << 1);
+    if (!n) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < t->capacity; ++i) {
+        if (atomic_load_explicit(&t->state[i], memory_order_relaxed) != SLOT_FULL) {
+            continue;
+        }
+
+        quid128_t key;
+        key.hi = atomic_load_explicit(&t->slots[i].hi, memory_order_relaxed);
+        key.lo = atomic_load_explicit(&t->slots[i].lo, memory_order_relaxed);
+        ctable_store(n, ctable_claim(n, quid_hash128(&key)), &key,
+                     atomic_load_explicit(&t->slots[i].value, memory_order_relaxed));
+    }
+
+    n->retired = t;
+    shard->used = shard->size;
+    atomic_store_explicit(&shard->table, n, memory_order_release);
+    return 1;
+}
+
+static inline shard_t *cmap_shard(quid_cmap_t *map, uint64_t hash) {
+    return &map->shards[map->shard_bits ? hash >> (64 - map->shard_bits) : 0];
+}
+
+/**
+ * Create new concurrent map. The number of shards is rounded up to
+ * a power of two, more shards reduce writer contention.
+ *
+ * @param   hint    Expected number of elements
+ * @param   shards  Number of shards
+ * @return          New map or NULL on faillure
+ */
+QUID_LIB_API quid_cmap_t *quid_cmap_new(size_t hint, unsigned int shards) {
+    quid_cmap_t *map = malloc(sizeof(quid_cmap_t));
+    unsigned int nshards;
+    size_t capacity = MIN_CAPACITY;
+
+    if (!map) {
+        return NULL;
+    }
+
+    map->shard_bits = 0;
+    while ((1u << map->shard_bits) < shards && map->shard_bits < MAX_SHARD_BITS) {
+        map->shard_bits++;
+    }
+    nshards = 1u << map->shard_bits;
+
+    while (ctable_max_load(capacity) < hint / nshards + 1) {
+        capacity <<= 1;
+    }
+
+    map->shards = calloc(nshards, sizeof(shard_t));
+    if (!map->shards) {
+        free(map);
+        return NULL;
+    }
+
+    for (unsigned int i = 0; i < nshards; ++i) {
+        shard_t *shard = &map->shards[i];
+        ctable_t *t = ctable_new(capacity);
+
+        if (!t || qmutex_init(&shard->lock) != 0) {
+            ctable_free(t);
+            while (i--) {
+                ctable_free(atomic_load(&map->shards[i].table));
+                qmutex_destroy(&map->shards[i].lock);
+            }
+            free(map->shards);
+            free(map);
+            return NULL;
+        }
+
+        atomic_init(&shard->seq, 0);
+        atomic_init(&shard->table, t);
+    }
+
+    return map;
+}
+
+/* Release map, no other thread may access the map */
+QUID_LIB_API void quid_cmap_free(quid_cmap_t *map) {
+    if (!map) { return; }
+
+    for (unsigned int i = 0; i < (1u << map->shard_bits); ++i) {
+        ctable_free(atomic_load(&map->shards[i].table));
+        qmutex_destroy(&map->shards[i].lock);
+    }
+
+    free(map->shards);
+    free(map);
+}
+
+/**
+ * Number of elements. Takes the lock of every shard in turn, so the
+ * call waits for active writers and is only exact when none run.
+ */
+QUID_LIB_API size_t quid_cmap_size(quid_cmap_t *map) {
+    size_t size = 0;
+
+    assert(map);
+    for (unsigned int i = 0; i < (1u << map->shard_bits); ++i) {
+        qmutex_lock(&map->shards[i].lock);
+        size += map->shards[i].size;
+        qmutex_unlock(&map->shards[i].lock);
+    }
+
+    return size;
+}
+
+/**
+ * Insert or replace value for identifier.
+ *
+ * @param   map    Map to insert into
+ * @param   cuuid  Identifier as key
+ * @param   value  Value to store, owned by the caller
+ * @return         QUID_OK if inserted, QUID_EXISTS if the value was replaced
+ */
+QUID_LIB_API cresult quid_cmap_put(quid_cmap_t *map, const cuuid_t *cuuid, void *value) {
+    quid128_t key;
+    uint64_t hash;
+    size_t slot, deleted;
+    cresult rs = QUID_OK;
+
+    if (!map || !cuuid) { return QUID_INVALID_PARAM; }
+
+    quid_pack(cuuid, &key);
+    hash = quid_hash128(&key);
+
+    shard_t *shard = cmap_shard(map, hash);
+    qmutex_lock(&shard->lock);
+
+    ctable_t *t = atomic_load_explicit(&shard->table, memory_order_relaxed);
+    slot = ctable_find(t, &key, hash, &deleted);
+
+    shard_write_begin(shard);
+    if (slot != t->capacity) {
+        atomic_store_explicit(&t->slots[slot].value, value, memory_order_relaxed);
+        rs = QUID_EXISTS;
+    } else if (deleted != t->capacity) {
+        ctable_store(t, deleted, &key, value);
+        shard->size++;
+    } else if (shard->used + 1 > ctable_max_load(t->capacity) && !shard_grow(shard)) {
+        rs = QUID_ERROR;
+    } else {
+        t = atomic_load_explicit(&shard->table, memory_order_relaxed);
+        ctable_store(t, ctable_claim(t, hash), &key, value);
+        shard->size++;
+        shard->used++;
+    }
+    shard_write_end(shard);
+
+    qmutex_unlock(&shard->lock);
+    return rs;
+}
+
+/**
+ * Retrieve value for identifier. Never takes a lock and never waits
+ * on other readers. While a writer is active on the shard the reader
+ * spins, and the lookup is repeated if a writer modified the shard
+ * meanwhile.
+ *
+ * @param   map    Map to search
+ * @param   cuuid  Identifier as key
+ * @param   value  Output value, untouched if not found
+ * @return         QUID_OK if found, QUID_ERROR otherwise
+ */
+QUID_LIB_API cresult quid_cmap_get(quid_cmap_t *map, const cuuid_t *cuuid, void **value) {
+    quid128_t key;
+    uint64_t hash;
+    unsigned int spin = 0;
+
+    if (!map || !cuuid) { return QUID_INVALID_PARAM; }
+
+    quid_pack(cuuid, &key);
+    hash = quid_hash128(&key);
+
+    shard_t *shard = cmap_shard(map, hash);
+    for (;;) {
+        unsigned int seq = atomic_load_explicit(&shard->seq, memory_order_acquire);
+        if (seq & 1) {
+            if (++spin % SPIN_YIELD == 0) {
+                qthread_yield();
+            }
+            continue;
+        }
+
+        ctable_t *t = atomic_load_explicit(&shard->table, memory_order_acquire);
+        size_t slot = ctable_find(t, &key, hash, NULL);
+        void *found = (slot != t->capacity) ? atomic_load_explicit(&t->slots[slot].value, memory_order_relaxed) : NULL;
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&shard->seq, memory_order_relaxed) != seq) {
+            continue;
+        }
+
+        if (slot == t->capacity) {
+            return QUID_ERROR;
+        }
+
+        if (value) {
+            *value = found;
+        }
+        return QUID_OK;
+    }
+}
+
+/**
+ * Remove identifier from map.
+ *
+ * @param   map    Map to remove from
+ * @param   cuuid  Identifier as key
+ * @return         QUID_OK if removed, QUID_ERROR if not found
+ */
+QUID_LIB_API cresult quid_cmap_erase(quid_cmap_t *map, const cuuid_t *cuuid) {
+    quid128_t key;
+    uint64_t hash;
+
+    if (!map || !cuuid) { return QUID_INVALID_PARAM; }
+
+    quid_pack(cuuid, &key);
+    hash = quid_hash128(&key);
+
+    shard_t *shard = cmap_shard(map, hash);
+    qmutex_lock(&shard->lock);
+
+    ctable_t *t = atomic_load_explicit(&shard->table, memory_order_relaxed);
+    size_t slot = ctable_find(t, &key, hash, NULL);
+    if (slot == t->capacity) {
+        qmutex_unlock(&shard->lock);
+        return QUID_ERROR;
+    }
+
+    shard_write_begin(shard);
+    atomic_store_explicit(&t->state[slot], SLOT_DELETED, memory_order_relaxed);
+    shard->size--;
+    shard_write_end(shard);
+
+    qmutex_unlock(&shard->lock);
+    return QUID_OK;
+}
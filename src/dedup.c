@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Deduplication cache over a sliding time window. Identifiers carry
+ * their creation time, each one is placed in the ring bucket covering
+ * that time. The window is driven by the clock, not by the identifiers,
+ * so a single identifier dated in the future cannot push it forward.
+ * As time moves on whole buckets fall out of the window and are cleared
+ * on reuse, no per entry expiry is kept. Buckets keep their capacity,
+ * a warm cache does not allocate.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include <assert.h>
+
+#include <quid.h>
+
+#include "bits.h"
+
+#define EPOCH_NONE      UINT64_MAX      /* Bucket holds no identifiers */
+#define FUTURE_BUCKETS  1               /* Buckets accepted ahead of the clock */
+
+typedef struct {
+    uint64_t    epoch;                  /* Time slice held by bucket */
+    quid_set_t  *set;                   /* Identifiers in time slice */
+} bucket_t;
+
+struct quid_dedup {
+    uint64_t    width;                  /* Bucket width in ticks */
+    uint64_t    head;                   /* Time slice of the clock */
+    unsigned    window;                 /* Buckets behind the head */
+    unsigned    nbuckets;               /* Number of ring buckets */
+    bucket_t    *buckets;
+};
+
+/**
+ * Create deduplication cache. One spare bucket is allocated on top of
+ * the requested number so the window is always fully covered, and one
+ * more for identifiers up to a bucket width ahead of the clock.
+ *
+ * @param   window   Window length in nanoseconds
+ * @param   buckets  Number of buckets the window is divided in, 0 for default
+ * @param   hint     Expected number of identifiers within window
+ * @return           New cache or NULL on faillure
+ */
+QUID_LIB_API quid_dedup_t *quid_dedup_new(int64_t window, unsigned buckets, size_t hint) {
+    quid_dedup_t *dedup;
+    uint64_t ticks;
+
+    if (window <= 0) {
+        return NULL;
+    }
+
+    if (!buckets) {
+        buckets = 16;
+    }
+
+    ticks = ns_to_ticks(window);
+    dedup = calloc(1, sizeof(quid_dedup_t));
+    if (!dedup) {
+        return NULL;
+    }
+
+    dedup->width = (ticks + buckets - 1) / buckets;
+    dedup->head = EPOCH_NONE;
+    dedup->window = buckets;
+    dedup->nbuckets = buckets + 1 + FUTURE_BUCKETS;
+    dedup->buckets = calloc(dedup->nbuckets, sizeof(bucket_t));
+    if (!dedup->buckets) {
+        free(dedup);
+        return NULL;
+    }
+
+    for (unsigned i = 0; i < dedup->nbuckets; ++i) {
+        dedup->buckets[i].epoch = EPOCH_NONE;
+        dedup->buckets[i].set = quid_set_new(hint / buckets);
+        if (!dedup->buckets[i].set) {
+            quid_dedup_free(dedup);
+            return NULL;
+        }
+    }
+
+    return dedup;
+}
+
+/* Release cache */
+QUID_LIB_API void quid_dedup_free(quid_dedup_t *dedup) {
+    if (!dedup) { return; }
+
+    for (unsigned i = 0; i < dedup->nbuckets; ++i) {
+        quid_set_free(dedup->buckets[i].set);
+    }
+
+    free(dedup->buckets);
+    free(dedup);
+}
+
+/* Forget all identifiers */
+QUID_LIB_API void quid_dedup_clear(quid_dedup_t *dedup) {
+    assert(dedup);
+
+    for (unsigned i = 0; i < dedup->nbuckets; ++i) {
+        dedup->buckets[i].epoch = EPOCH_NONE;
+        quid_set_clear(dedup->buckets[i].set);
+    }
+
+    dedup->head = EPOCH_NONE;
+}
+
+/* Number of identifiers within window */
+QUID_LIB_API size_t quid_dedup_size(const quid_dedup_t *dedup) {
+    size_t size = 0;
+
+    assert(dedup);
+
+    for (unsigned i = 0; i < dedup->nbuckets; ++i) {
+        const bucket_t *bucket = &dedup->buckets[i];
+        if (bucket->epoch != EPOCH_NONE && bucket->epoch + dedup->window >= dedup->head) {
+            size += quid_set_size(bucket->set);
+        }
+    }
+
+    return size;
+}
+
+/**
+ * Record identifier and report if it was seen before, with the window
+ * ending at the given time. The window never moves back, an earlier
+ * time than before is treated as the latest time given.
+ *
+ * @param   dedup  Deduplication cache
+ * @param   cuuid  Identifier to check
+ * @param   now    Current time in nanoseconds since epoch
+ * @return         QUID_OK if new, QUID_EXISTS if replayed, QUID_ERROR if
+ *                 outside the window, QUID_NOMEM if the bucket cannot grow
+ */
+QUID_LIB_API cresult quid_dedup_check_at(quid_dedup_t *dedup, const cuuid_t *cuuid, int64_t now) {
+    quid128_t key;
+    bucket_t *bucket;
+    uint64_t epoch, head;
+    cresult rs;
+
+    if (!dedup || !cuuid || now < 0) { return QUID_INVALID_PARAM; }
+
+    head = (uint64_t)now / NS_PER_TICK / dedup->width;
+    if (dedup->head == EPOCH_NONE || head > dedup->head) {
+        dedup->head = head;
+    }
+
+    quid_pack(cuuid, &key);
+    epoch = (key.hi >> 4) / dedup->width;
+
+    /* Expired, or dated too far ahead of the clock */
+    if (epoch + dedup->window < dedup->head || epoch > dedup->head + FUTURE_BUCKETS) {
+        return QUID_ERROR;
+    }
+
+    /* Bucket still holds an expired time slice */
+    bucket = &dedup->buckets[epoch % dedup->nbuckets];
+    if (bucket->epoch != epoch) {
+        quid_set_clear(bucket->set);
+        bucket->epoch = epoch;
+    }
+
+    rs = quid_set_insert(bucket->set, cuuid);
+    return (rs == QUID_ERROR) ? QUID_NOMEM : rs;
+}
+
+/**
+ * Record identifier and report if it was seen before, with the window
+ * ending at the current system time.
+ *
+ * @param   dedup  Deduplication cache
+ * @param   cuuid  Identifier to check
+ * @return         See quid_dedup_check_at
+ */
+QUID_LIB_API cresult quid_dedup_check(quid_dedup_t *dedup, const cuuid_t *cuuid) {
+    struct timespec ts;
+
+    if (!timespec_get(&ts, TIME_UTC)) {
+        return QUID_ERROR;
+    }
+
+    return quid_dedup_check_at(dedup, cuuid, (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
@@ -0,0 +1,448 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Succinct sorted set of identifiers. The upper word of the packed
+ * key is time ordered and therefore clustered, it is stored with the
+ * Elias-Fano encoding relative to the smallest key: the lower bits of
+ * every value are packed at fixed width, the upper bits are unary coded
+ * in a bit vector. The lower word is random and kept as is. Sampled
+ * positions of every 256th one and zero in the bit vector provide
+ * select in constant time, all queries work on the encoded form.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <quid.h>
+
+#include "bits.h"
+
+#define EF_SAMPLE       256             /* Bits between select samples */
+
+struct quid_efset {
+    size_t      count;                  /* Number of keys */
+    uint64_t    base;                   /* Smallest upper word */
+    unsigned    width;                  /* Width of lower bits */
+    uint64_t    nbuckets;               /* Number of upper bit buckets */
+    uint64_t    *upper;                 /* Unary coded upper bits */
+    uint64_t    nbits;                  /* Length of upper bit vector */
+    uint64_t    *lower;                 /* Packed lower bits */
+    uint64_t    *low;                   /* Lower words of keys */
+    uint64_t    *ones;                  /* Position of every EF_SAMPLE-th one */
+    uint64_t    *zeros;                 /* Position of every EF_SAMPLE-th zero */
+};
+
+static inline uint64_t bits_get(const uint64_t *words, uint64_t pos, unsigned width) {
+    uint64_t idx = pos >> 6;
+    unsigned shift = (unsigned)(pos & 63);
+    uint64_t value;
+
+    if (!width) {
+        return 0;
+    }
+
+    value = words[idx] >> shift;
+    if (shift + width > 64) {
+        value |= words[idx + 1] << (64 - shift);
+    }
+
+    return (width == 64) ? value : value & ((1ULL << width) - 1);
+}
+
+static inline void bits_set(uint64_t *words, uint64_t pos, unsigned width, uint64_t value) {
+    uint64_t idx = pos >> 6;
+    unsigned shift = (unsigned)(pos & 63);
+
+    if (!width) {
+        return;
+    }
+
+    words[idx] |= value << shift;
+    if (shift + width > 64) {
+        words[idx + 1] |= value >> (64 - shift);
+    }
+}
+
+/* Position of the i-th one in the upper bit vector */
+static uint64_t ef_select1(const quid_efset_t *set, uint64_t i) {
+    uint64_t pos = set->ones[i / EF_SAMPLE];
+    uint64_t rank = i - (i / EF_SAMPLE) * EF_SAMPLE;
+    uint64_t idx = pos >> 6;
+    uint64_t word = set->upper[idx] & (~0ULL << (pos & 63));
+
+    for (;;) {
+        uint64_t c = (uint64_t)bit_popcount64(word);
+        if (rank < c) {
+            return (idx << 6) + (uint64_t)bit_select64(word, (int)rank);
+        }
+        rank -= c;
+        word = set->upper[++idx];
+    }
+}
+
+/* Position of the i-th zero in the upper bit vector */
+static uint64_t ef_select0(const quid_efset_t *set, uint64_t i) {
+    uint64_t pos = set->zeros[i / EF_SAMPLE];
+    uint64_t rank = i - (i / EF_SAMPLE) * EF_SAMPLE;
+    uint64_t idx = pos >> 6;
+    uint64_t word = ~set->upper[idx] & (~0ULL << (pos & 63));
+
+    for (;;) {
+        uint64_t c = (uint64_t)bit_popcount64(word);
+        if (rank < c) {
+            return (idx << 6) + (uint64_t)bit_select64(word, (int)rank);
+        }
+        rank -= c;
+        word = ~set->upper[++idx];
+    }
+}
+
+/* Number of keys with an upper bucket below bucket */
+static inline size_t ef_bucket_start(const quid_efset_t *set, uint64_t bucket) {
+    if (!bucket) {
+        return 0;
+    }
+    if (bucket >= set->nbuckets) {
+        return set->count;
+    }
+
+    return (size_t)(ef_select0(set, bucket - 1) - (bucket - 1));
+}
+
+/* Decode key at position, bit is the position of its one */
+static inline void ef_decode(const quid_efset_t *set, size_t i, uint64_t bit, quid128_t *key) {
+    uint64_t bucket = bit - i;
+    key->hi = set->base + ((bucket << set->width) | bits_get(set->lower, (uint64_t)i * set->width, set->width));
+    key->lo = set->low[i];
+}
+
+/* Number of keys less than key */
+static size_t ef_rank(const quid_efset_t *set, const quid128_t *key) {
+    uint64_t rel, bucket, lower;
+    size_t lo, hi;
+
+    if (!set->count || key->hi < set->base) {
+        return 0;
+    }
+
+    rel = key->hi - set->base;
+    bucket = set->width < 64 ? rel >> set->width : 0;
+    if (bucket >= set->nbuckets) {
+        return set->count;
+    }
+
+    lower = rel & (set->width < 64 ? (1ULL << set->width) - 1 : ~0ULL);
+    lo = ef_bucket_start(set, bucket);
+    hi = ef_bucket_start(set, bucket + 1);
+
+    /* Keys within a bucket share the upper bits, compare the rest */
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        uint64_t v = bits_get(set->lower, (uint64_t)mid * set->width, set->width);
+
+        if (v < lower || (v == lower && set->low[mid] < key->lo)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/**
+ * Build succinct set from identifiers. The input does not need
+ * to be sorted, duplicates are removed.
+ *
+ * @param   cuuid  Array of quid structures
+ * @param   n      Number of elements in the array
+ * @return         New set or NULL on faillure
+ */
+QUID_LIB_API quid_efset_t *quid_efset_build(const cuuid_t *cuuid, size_t n) {
+    quid_efset_t *set;
+    quid128_t *keys;
+    size_t m = 0;
+    uint64_t range, quotient;
+
+    if (!cuuid && n) { return NULL; }
+
+    keys = malloc((n ? n : 1) * sizeof(quid128_t));
+    set = calloc(1, sizeof(quid_efset_t));
+    if (!keys || !set) {
+        free(keys);
+        free(set);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        quid_pack(&cuuid[i], &keys[i]);
+    }
+
+    if (quid_sort128(keys, n) != QUID_OK) {
+        goto fail;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        if (!m || keys[i].hi != keys[m - 1].hi || keys[i].lo != keys[m - 1].lo) {
+            keys[m++] = keys[i];
+        }
+    }
+
+    /* Choose lower width such that the bucket count is about the key count */
+    set->count = m;
+    set->base = m ? keys[0].hi : 0;
+    range = m ? keys[m - 1].hi - set->base : 0;
+    quotient = m ? range / m : 0;
+    while (quotient >> (set->width + 1)) {
+        set->width++;
+    }
+
+    set->nbuckets = (set->width < 64 ? range >> set->width : 0) + 1;
+    set->nbits = m + set->nbuckets;
+
+    /* One spare word allows reading past the last used word */
+    set->upper = calloc((size_t)(set->nbits / 64 + 2), sizeof(uint64_t));
+    set->lower = calloc((size_t)(((uint64_t)m * set->width) / 64 + 2), sizeof(uint64_t));
+    set->low = malloc((m ? m : 1) * sizeof(uint64_t));
+    set->ones = malloc((size_t)(m / EF_SAMPLE + 1) * sizeof(uint64_t));
+    set->zeros = malloc((size_t)(set->nbuckets / EF_SAMPLE + 1) * sizeof(uint64_t));
+    if (!set->upper || !set->lower || !set->low || !set->ones || !set->zeros) {
+        goto fail;
+    }
+
+    for (size_t i = 0; i < m; ++i) {
+        uint64_t rel = keys[i].hi - set->base;
+        uint64_t bucket = set->width < 64 ? rel >> set->width : 0;
+        uint64_t bit = bucket + i;
+
+        set->upper[bit >> 6] |= 1ULL << (bit & 63);
+        bits_set(set->lower, (uint64_t)i * set->width, set->width, rel & (set->width < 64 ? (1ULL << set->width) - 1 : ~0ULL));
+        set->low[i] = keys[i].lo;
+    }
+
+    /* Sample select positions */
+    uint64_t nones = 0, nzeros = 0;
+    for (uint64_t bit = 0; bit < set->nbits; ++bit) {
+        if (set->upper[bit >> 6] & (1ULL << (bit & 63))) {
+            if (nones % EF_SAMPLE == 0) {
+                set->ones[nones / EF_SAMPLE] = bit;
+            }
+            nones++;
+        } else {
+            if (nzeros % EF_SAMPLE == 0) {
+                set->zeros[nzeros / EF_SAMPLE] = bit;
+            }
+            nzeros++;
+        }
+    }
+
+    free(keys);
+    return set;
+
+fail:
+    free(keys);
+    quid_efset_free(set);
+    return NULL;
+}
+
+/* Release set */
+QUID_LIB_API void quid_efset_free(quid_efset_t *set) {
+    if (!set) { return; }
+
+    free(set->upper);
+    free(set->lower);
+    free(set->low);
+    free(set->ones);
+    free(set->zeros);
+    free(set);
+}
+
+/* Number of identifiers in set */
+QUID_LIB_API size_t quid_efset_size(const quid_efset_t *set) {
+    assert(set);
+    return set->count;
+}
+
+/* Memory used by the encoded set in bytes */
+QUID_LIB_API size_t quid_efset_bytes(const quid_efset_t *set) {
+    assert(set);
+
+    return sizeof(quid_efset_t)
+        + (size_t)(set->nbits / 64 + 2) * sizeof(uint64_t)
+        + (size_t)(((uint64_t)set->count * set->width) / 64 + 2) * sizeof(uint64_t)
+        + set->count * sizeof(uint64_t)
+        + (size_t)(set->count / EF_SAMPLE + 1) * sizeof(uint64_t)
+        + (size_t)(set->nbuckets / EF_SAMPLE + 1) * sizeof(uint64_t);
+}
+
+/**
+ * Number of identifiers in set ordered before identifier, see quid_order.
+ *
+ * @param   set    Set to search
+ * @param   cuuid  Identifier, need not be part of the set
+ * @return         Rank of identifier
+ */
+QUID_LIB_API size_t quid_efset_rank(const quid_efset_t *set, const cuuid_t *cuuid) {
+    quid128_t key;
+
+    assert(set);
+    assert(cuuid);
+
+    quid_pack(cuuid, &key);
+    return ef_rank(set, &key);
+}
+
+/**
+ * Check if identifier is part of set.
+ *
+ * @param   set    Set to search
+ * @param   cuuid  Identifier to find
+ * @return         QUID_OK if found, QUID_ERROR otherwise
+ */
+QUID_LIB_API cresult quid_efset_contains(const quid_efset_t *set, const cuuid_t *cuuid) {
+    quid128_t key, found;
+    size_t i;
+
+    if (!set || !cuuid) { return QUID_INVALID_PARAM; }
+
+    quid_pack(cuuid, &key);
+    i = ef_rank(set, &key);
+    if (i == set->count) {
+        return QUID_ERROR;
+    }
+
+    ef_decode(set, i, ef_select1(set, i), &found);
+    return (found.hi == key.hi && found.lo == key.lo) ? QUID_OK : QUID_ERROR;
+}
+
+/**
+ * Retrieve identifier at position in ascending order.
+ *
+ * @param   set    Set to search
+ * @param   i      Position of identifier
+ * @param   cuuid  Output quid structure
+ * @return         QUID_OK on success, QUID_ERROR if out of range
+ */
+QUID_LIB_API cresult quid_efset_select(const quid_efset_t *set, size_t i, cuuid_t *cuuid) {
+    quid128_t key;
+
+    if (!set || !cuuid) { return QUID_INVALID_PARAM; }
+    if (i >= set->count) { return QUID_ERROR; }
+
+    ef_decode(set, i, ef_select1(set, i), &key);
+    quid_unpack(&key, cuuid);
+    return QUID_OK;
+}
+
+/* Key of the first identifier not earlier than time in nanoseconds */
+static void time_key(int64_t ns, quid128_t *key) {
+    key->hi = ns_to_ticks(ns) << 4;
+    key->lo = 0;
+}
+
+/**
+ * Find positions of identifiers created in time range, see
+ * quid_index_range.
+ *
+ * @param   set    Set to search
+ * @param   t0     Start of range in nanoseconds since epoch, inclusive
+ * @param   t1     End of range in nanoseconds since epoch, exclusive
+ * @param   first  Output first matching position
+ * @param   last   Output position following the last match
+ * @return         QUID_OK if any identifier matches, QUID_ERROR otherwise
+ */
+QUID_LIB_API cresult quid_efset_range(const quid_efset_t *set, int64_t t0, int64_t t1, size_t *first, size_t *last) {
+    quid128_t key;
+
+    if (!set || !first || !last) { return QUID_INVALID_PARAM; }
+
+    time_key(t0, &key);
+    *first = ef_rank(set, &key);
+    time_key(t1, &key);
+    *last = ef_rank(set, &key);
+
+    if (*last < *first) {
+        *last = *first;
+    }
+
+    return *first < *last ? QUID_OK : QUID_ERROR;
+}
+
+/**
+ * Position iterator on identifier. Iterating decodes identifiers one
+ * by one in ascending order, scanning the upper bits sequentially.
+ *
+ * @param   set   Set to iterate
+ * @param   i     Position of the first identifier
+ * @param   iter  Iterator to initialize
+ */
+QUID_LIB_API void quid_efset_iter(const quid_efset_t *set, size_t i, quid_efset_iter_t *iter) {
+    assert(set);
+    assert(iter);
+
+    iter->set = set;
+    iter->pos = i;
+    iter->bit = (i < set->count) ? ef_select1(set, i) : 0;
+}
+
+/**
+ * Retrieve next identifier from iterator.
+ *
+ * @param   iter   Iterator
+ * @param   cuuid  Output quid structure
+ * @return         QUID_OK on success, QUID_ERROR when exhausted
+ */
+QUID_LIB_API cresult quid_efset_next(quid_efset_iter_t *iter, cuuid_t *cuuid) {
+    const quid_efset_t *set;
+    quid128_t key;
+
+    if (!iter || !cuuid) { return QUID_INVALID_PARAM; }
+
+    set = iter->set;
+    if (iter->pos >= set->count) {
+        return QUID_ERROR;
+    }
+
+    ef_decode(set, iter->pos, iter->bit, &key);
+    quid_unpack(&key, cuuid);
+
+    /* Advance to the next one */
+    if (++iter->pos < set->count) {
+        uint64_t idx = (iter->bit + 1) >> 6;
+        uint64_t word = set->upper[idx] & (~0ULL << ((iter->bit + 1) & 63));
+        while (!word) {
+            word = set->upper[++idx];
+        }
+        iter->bit = (idx << 6) + (uint64_t)bit_ctz64(word);
+    }
+
+    return QUID_OK;
+}
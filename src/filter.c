@@ -0,0 +1,613 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Approximate membership filters keyed by identifier. The blocked
+ * Bloom filter confines every key to a single cache line and accepts
+ * inserts at any time. The xor filter is built once from a static set
+ * and answers queries with three memory accesses at under 10 bits per
+ * key. Both filters live in a single flat buffer, header followed by
+ * the payload, which can be written to disk as is and mapped back in
+ * as a read only view. The buffer uses the native byte order.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <quid.h>
+
+#include "bits.h"
+
+#define FILTER_FORMAT       1               /* Flat buffer format version */
+#define FILTER_HEADER       64              /* Header size, padded to a cache line */
+#define FILTER_ALIGN        64              /* Payload alignment */
+#define FILTER_BATCH        16              /* Queries prefetched at once */
+
+#define BLOOM_MAGIC         0x4d4c4251      /* "QBLM" */
+#define BLOOM_WORDS         8               /* 64 bit words per block */
+#define BLOOM_BLOCK_BITS    (BLOOM_WORDS * 64)
+#define BLOOM_DEFAULT_BITS  12              /* Default bits per key */
+
+#define XORF_MAGIC          0x524f5851      /* "QXOR" */
+#define XORF_ATTEMPTS       64              /* Seeds tried before giving up */
+
+typedef struct {
+    uint32_t    magic;
+    uint32_t    format;
+    uint64_t    nblocks;                    /* Number of 512 bit blocks */
+    uint64_t    count;                      /* Number of inserted keys */
+} bloom_header_t;
+
+typedef struct {
+    uint32_t    magic;
+    uint32_t    format;
+    uint64_t    seed;                       /* Hash seed of successful build */
+    uint64_t    block_length;               /* Slots per hash segment */
+    uint64_t    count;                      /* Number of distinct keys */
+} xorf_header_t;
+
+struct quid_bloom {
+    bloom_header_t  *header;                /* Start of the flat buffer */
+    uint64_t        *blocks;                /* Filter blocks */
+    size_t          length;                 /* Size of flat buffer */
+    void            *alloc;                 /* Owned allocation, NULL for views */
+};
+
+struct quid_xorf {
+    xorf_header_t   *header;                /* Start of the flat buffer */
+    uint8_t         *fingerprints;          /* Fingerprint per slot */
+    size_t          length;                 /* Size of flat buffer */
+    void            *alloc;                 /* Owned allocation, NULL for views */
+};
+
+/* Salts pick one bit per word, as in the split block Bloom filter */
+static const uint32_t bloom_salt[BLOOM_WORDS] = {
+    0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+    0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31,
+};
+
+/* Allocate flat buffer with payload aligned to a cache line */
+static void *filter_alloc(size_t length, void **alloc) {
+    *alloc = calloc(1, length + FILTER_ALIGN);
+    if (!*alloc) {
+        return NULL;
+    }
+
+    return (void *)(((uintptr_t)*alloc + FILTER_ALIGN - 1) & ~(uintptr_t)(FILTER_ALIGN - 1));
+}
+
+static inline uint64_t *bloom_block(const quid_bloom_t *bloom, uint64_t hash) {
+    return bloom->blocks + (size_t)bit_reduce32((uint32_t)(hash >> 32), (uint32_t)bloom->header->nblocks) * BLOOM_WORDS;
+}
+
+static inline int bloom_test(const uint64_t *block, uint64_t hash) {
+    uint64_t miss = 0;
+    for (int i = 0; i < BLOOM_WORDS; ++i) {
+        uint64_t mask = 1ULL << (((uint32_t)hash * bloom_salt[i]) >> 26);
+        miss |= ~block[i] & mask;
+    }
+    return !miss;
+}
+
+static inline void bloom_set(uint64_t *block, uint64_t hash) {
+    for (int i = 0; i < BLOOM_WORDS; ++i) {
+        block[i] |= 1ULL << (((uint32_t)hash * bloom_salt[i]) >> 26);
+    }
+}
+
+/**
+ * Create new blocked Bloom filter. At the default of 12 bits per
+ * key the false positive rate is below one percent.
+ *
+ * @param   n             Expected number of keys
+ * @param   bits_per_key  Filter bits per key, 0 selects the default
+ * @return                New filter or NULL on faillure
+ */
+QUID_LIB_API quid_bloom_t *quid_bloom_new(size_t n, unsigned int bits_per_key) {
+    quid_bloom_t *bloom;
+    uint64_t nblocks;
+
+    if (!bits_per_key) {
+        bits_per_key = BLOOM_DEFAULT_BITS;
+    }
+
+    nblocks = ((uint64_t)n * bits_per_key + BLOOM_BLOCK_BITS - 1) / BLOOM_BLOCK_BITS;
+    if (!nblocks) {
+        nblocks = 1;
+    }
+    if (nblocks > UINT32_MAX) {
+        return NULL;
+    }
+
+    bloom = malloc(sizeof(quid_bloom_t));
+    if (!bloom) {
+        return NULL;
+    }
+
+    bloom->length = FILTER_HEADER + (size_t)nblocks * BLOOM_WORDS * sizeof(uint64_t);
+    bloom->header = filter_alloc(bloom->length, &bloom->alloc);
+    if (!bloom->header) {
+        free(bloom);
+        return NULL;
+    }
+
+    bloom->header->magic = BLOOM_MAGIC;
+    bloom->header->format = FILTER_FORMAT;
+    bloom->header->nblocks = nblocks;
+    bloom->header->count = 0;
+    bloom->blocks = (uint64_t *)((uint8_t *)bloom->header + FILTER_HEADER);
+
+    return bloom;
+}
+
+/**
+ * Open read only view on a flat buffer, for example a mapped file.
+ * The buffer is not copied and must outlive the view.
+ *
+ * @param   buffer  Flat buffer as returned by quid_bloom_data
+ * @param   length  Size of the buffer
+ * @return          New view or NULL if the buffer is invalid
+ */
+QUID_LIB_API quid_bloom_t *quid_bloom_view(const void *buffer, size_t length) {
+    const bloom_header_t *header = (const bloom_header_t *)buffer;
+    quid_bloom_t *bloom;
+
+    if (!buffer || length < FILTER_HEADER || ((uintptr_t)buffer % sizeof(uint64_t))) {
+        return NULL;
+    }
+
+    if (header->magic != BLOOM_MAGIC || header->format != FILTER_FORMAT
+        || !header->nblocks || header->nblocks > UINT32_MAX
+        || (length - FILTER_HEADER) / (BLOOM_WORDS * sizeof(uint64_t)) < header->nblocks) {
+        return NULL;
+    }
+
+    bloom = malloc(sizeof(quid_bloom_t));
+    if (!bloom) {
+        return NULL;
+    }
+
+    bloom->header = (bloom_header_t *)buffer;
+    bloom->blocks = (uint64_t *)((uint8_t *)buffer + FILTER_HEADER);
+    bloom->length = FILTER_HEADER + (size_t)header->nblocks * BLOOM_WORDS * sizeof(uint64_t);
+    bloom->alloc = NULL;
+
+    return bloom;
+}
+
+/* Release filter or view */
+QUID_LIB_API void quid_bloom_free(quid_bloom_t *bloom) {
+    if (!bloom) { return; }
+
+    free(bloom->alloc);
+    free(bloom);
+}
+
+/**
+ * Add identifiers to filter. Views are read only.
+ *
+ * @param   bloom  Filter to add to
+ * @param   cuuid  Array of quid structures
+ * @param   n      Number of elements in the array
+ * @return         QUID_OK on success
+ */
+QUID_LIB_API cresult quid_bloom_add_bulk(quid_bloom_t *bloom, const cuuid_t *cuuid, size_t n) {
+    quid128_t key;
+
+    if (!bloom || (!cuuid && n)) { return QUID_INVALID_PARAM; }
+    if (!bloom->alloc) { return QUID_ERROR; }
+
+    for (size_t i = 0; i < n; ++i) {
+        quid_pack(&cuuid[i], &key);
+        uint64_t hash = quid_hash128(&key);
+        bloom_set(bloom_block(bloom, hash), hash);
+    }
+
+    bloom->header->count += n;
+    return QUID_OK;
+}
+
+/* Add identifier to filter */
+QUID_LIB_API cresult quid_bloom_add(quid_bloom_t *bloom, const cuuid_t *cuuid) {
+    if (!cuuid) { return QUID_INVALID_PARAM; }
+
+    return quid_bloom_add_bulk(bloom, cuuid, 1);
+}
+
+/**
+ * Check identifier against filter.
+ *
+ * @param   bloom  Filter to query
+ * @param   cuuid  Identifier to check
+ * @return         QUID_OK if possibly present, QUID_ERROR if certainly absent
+ */
+QUID_LIB_API cresult quid_bloom_contains(const quid_bloom_t *bloom, const cuuid_t *cuuid) {
+    quid128_t key;
+
+    if (!bloom || !cuuid) { return QUID_INVALID_PARAM; }
+
+    quid_pack(cuuid, &key);
+    uint64_t hash = quid_hash128(&key);
+    return bloom_test(bloom_block(bloom, hash), hash) ? QUID_OK : QUID_ERROR;
+}
+
+/**
+ * Check array of identifiers against filter. The blocks of a batch
+ * of queries are prefetched before any of them is tested.
+ *
+ * @param   bloom  Filter to query
+ * @param   cuuid  Array of quid structures
+ * @param   n      Number of elements in the array, at most UINT32_MAX
+ * @param   sel    Output row numbers of possibly present identifiers,
+ *                 must hold n elements
+ * @return         Number of selected rows
+ */
+QUID_LIB_API size_t quid_bloom_query_bulk(const quid_bloom_t *bloom, const cuuid_t *cuuid, size_t n, uint32_t *sel) {
+    uint64_t hash[FILTER_BATCH];
+    const uint64_t *block[FILTER_BATCH];
+    quid128_t key;
+    size_t count = 0;
+
+    if (!bloom || !cuuid || !sel) { return 0; }
+
+    for (size_t base = 0; base < n; base += FILTER_BATCH) {
+        size_t len = (n - base < FILTER_BATCH) ? n - base : FILTER_BATCH;
+
+        for (size_t i = 0; i < len; ++i) {
+            quid_pack(&cuuid[base + i], &key);
+            hash[i] = quid_hash128(&key);
+            block[i] = bloom_block(bloom, hash[i]);
+            bit_prefetch(block[i]);
+        }
+
+        for (size_t i = 0; i < len; ++i) {
+            sel[count] = (uint32_t)(base + i);
+            count += bloom_test(block[i], hash[i]);
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Retrieve flat buffer of filter. The buffer can be stored and
+ * opened with quid_bloom_view later on.
+ *
+ * @param   bloom   Filter
+ * @param   length  Output size of the buffer
+ * @return          Flat buffer
+ */
+QUID_LIB_API const void *quid_bloom_data(const quid_bloom_t *bloom, size_t *length) {
+    assert(bloom);
+
+    if (length) {
+        *length = bloom->length;
+    }
+
+    return bloom->header;
+}
+
+/* Fingerprint stored for key */
+static inline uint8_t xorf_fingerprint(uint64_t hash) {
+    return (uint8_t)(hash ^ (hash >> 32));
+}
+
+/* Slot of key in one of the three segments */
+static inline uint32_t xorf_slot(uint64_t hash, int segment, uint32_t block_length) {
+    uint64_t rotated = (segment == 0) ? hash : (hash << (21 * segment)) | (hash >> (64 - 21 * segment));
+    return bit_reduce32((uint32_t)rotated, block_length) + (uint32_t)segment * block_length;
+}
+
+static inline int xorf_test(const quid_xorf_t *xorf, uint64_t hash) {
+    uint32_t block_length = (uint32_t)xorf->header->block_length;
+    const uint8_t *fp = xorf->fingerprints;
+
+    return xorf_fingerprint(hash) == (fp[xorf_slot(hash, 0, block_length)]
+                                    ^ fp[xorf_slot(hash, 1, block_length)]
+                                    ^ fp[xorf_slot(hash, 2, block_length)]);
+}
+
+/**
+ * Map every key to three slots and peel the slots referenced by a
+ * single key, as described by Graf and Lemire. Succeeds if all keys
+ * are peeled, in which case the peel order is stored in stack.
+ */
+static int xorf_peel(const uint64_t *keyhash, size_t n, uint64_t seed, uint32_t block_length,
+                     uint64_t *mask, uint32_t *count, uint32_t *queue, uint64_t *stack_hash, uint32_t *stack_slot) {
+    size_t capacity = (size_t)block_length * 3;
+    size_t qlen = 0, slen = 0;
+
+    memset(mask, 0, capacity * sizeof(uint64_t));
+    memset(count, 0, capacity * sizeof(uint32_t));
+
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t hash = mix64(keyhash[i] + seed);
+        for (int s = 0; s < 3; ++s) {
+            uint32_t slot = xorf_slot(hash, s, block_length);
+            mask[slot] ^= hash;
+            count[slot]++;
+        }
+    }
+
+    for (uint32_t slot = 0; slot < capacity; ++slot) {
+        if (count[slot] == 1) {
+            queue[qlen++] = slot;
+        }
+    }
+
+    while (qlen) {
+        uint32_t slot = queue[--qlen];
+        if (count[slot] != 1) {
+            continue;
+        }
+
+        uint64_t hash = mask[slot];
+        stack_hash[slen] = hash;
+        stack_slot[slen++] = slot;
+
+        for (int s = 0; s < 3; ++s) {
+            uint32_t other = xorf_slot(hash, s, block_length);
+            mask[other] ^= hash;
+            if (--count[other] == 1) {
+                queue[qlen++] = other;
+            }
+        }
+    }
+
+    return slen == n;
+}
+
+/**
+ * Build xor filter from a static set of identifiers. Duplicates
+ * are removed before the filter is built. The false positive rate
+ * is about 0.4 percent.
+ *
+ * @param   cuuid  Array of quid structures
+ * @param   n      Number of elements in the array
+ * @return         New filter or NULL on faillure
+ */
+QUID_LIB_API quid_xorf_t *quid_xorf_build(const cuuid_t *cuuid, size_t n) {
+    quid_xorf_t *xorf = NULL;
+    quid128_t *keys;
+    uint64_t *keyhash = NULL, *mask = NULL, *stack_hash = NULL;
+    uint32_t *count = NULL, *queue = NULL, *stack_slot = NULL;
+    size_t m = 0, capacity;
+    uint32_t block_length;
+    uint64_t seed = 0;
+    int built = 0;
+
+    if (!cuuid && n) { return NULL; }
+
+    /* Sort to remove duplicates, duplicate keys can never be peeled */
+    keys = malloc((n ? n : 1) * sizeof(quid128_t));
+    if (!keys) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        quid_pack(&cuuid[i], &keys[i]);
+    }
+
+    if (quid_sort128(keys, n) != QUID_OK) {
+        free(keys);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        if (!m || keys[i].hi != keys[m - 1].hi || keys[i].lo != keys[m - 1].lo) {
+            keys[m++] = keys[i];
+        }
+    }
+
+    capacity = 32 + (size_t)(1.23 * (double)m);
+    block_length = (uint32_t)(capacity / 3 + 1);
+    capacity = (size_t)block_length * 3;
+    if (capacity > UINT32_MAX) {
+        free(keys);
+        return NULL;
+    }
+
+    keyhash = malloc((m ? m : 1) * sizeof(uint64_t));
+    mask = malloc(capacity * sizeof(uint64_t));
+    count = malloc(capacity * sizeof(uint32_t));
+    queue = malloc(capacity * sizeof(uint32_t));
+    stack_hash = malloc((m ? m : 1) * sizeof(uint64_t));
+    stack_slot = malloc((m ? m : 1) * sizeof(uint32_t));
+    xorf = malloc(sizeof(quid_xorf_t));
+    if (!keyhash || !mask || !count || !queue || !stack_hash || !stack_slot || !xorf) {
+        goto done;
+    }
+
+    for (size_t i = 0; i < m; ++i) {
+        keyhash[i] = quid_hash128(&keys[i]);
+    }
+
+    for (int attempt = 0; attempt < XORF_ATTEMPTS && !built; ++attempt) {
+        seed = mix64(0x9e3779b97f4a7c15ULL * (attempt + 1));
+        built = xorf_peel(keyhash, m, seed, block_length, mask, count, queue, stack_hash, stack_slot);
+    }
+
+    if (!built) {
+        goto done;
+    }
+
+    xorf->length = FILTER_HEADER + capacity;
+    xorf->header = filter_alloc(xorf->length, &xorf->alloc);
+    if (!xorf->header) {
+        goto done;
+    }
+
+    xorf->header->magic = XORF_MAGIC;
+    xorf->header->format = FILTER_FORMAT;
+    xorf->header->seed = seed;
+    xorf->header->block_length = block_length;
+    xorf->header->count = m;
+    xorf->fingerprints = (uint8_t *)xorf->header + FILTER_HEADER;
+
+    /* Assign in reverse peel order, each slot is written exactly once */
+    for (size_t i = m; i-- > 0;) {
+        uint64_t hash = stack_hash[i];
+        uint8_t fp = xorf_fingerprint(hash);
+        for (int s = 0; s < 3; ++s) {
+            fp ^= xorf->fingerprints[xorf_slot(hash, s, block_length)];
+        }
+        xorf->fingerprints[stack_slot[i]] = fp;
+    }
+
+done:
+    if (xorf && (!built || !xorf->header)) {
+        free(xorf);
+        xorf = NULL;
+    }
+
+    free(keys);
+    free(keyhash);
+    free(mask);
+    free(count);
+    free(queue);
+    free(stack_hash);
+    free(stack_slot);
+    return xorf;
+}
+
+/**
+ * Open read only view on a flat buffer, for example a mapped file.
+ * The buffer is not copied and must outlive the view.
+ *
+ * @param   buffer  Flat buffer as returned by quid_xorf_data
+ * @param   length  Size of the buffer
+ * @return          New view or NULL if the buffer is invalid
+ */
+QUID_LIB_API quid_xorf_t *quid_xorf_view(const void *buffer, size_t length) {
+    const xorf_header_t *header = (const xorf_header_t *)buffer;
+    quid_xorf_t *xorf;
+
+    if (!buffer || length < FILTER_HEADER || ((uintptr_t)buffer % sizeof(uint64_t))) {
+        return NULL;
+    }
+
+    if (header->magic != XORF_MAGIC || header->format != FILTER_FORMAT
+        || !header->block_length || header->block_length > UINT32_MAX / 3
+        || (length - FILTER_HEADER) / 3 < header->block_length) {
+        return NULL;
+    }
+
+    xorf = malloc(sizeof(quid_xorf_t));
+    if (!xorf) {
+        return NULL;
+    }
+
+    xorf->header = (xorf_header_t *)buffer;
+    xorf->fingerprints = (uint8_t *)buffer + FILTER_HEADER;
+    xorf->length = FILTER_HEADER + (size_t)header->block_length * 3;
+    xorf->alloc = NULL;
+
+    return xorf;
+}
+
+/* Release filter or view */
+QUID_LIB_API void quid_xorf_free(quid_xorf_t *xorf) {
+    if (!xorf) { return; }
+
+    free(xorf->alloc);
+    free(xorf);
+}
+
+/**
+ * Check identifier against filter.
+ *
+ * @param   xorf   Filter to query
+ * @param   cuuid  Identifier to check
+ * @return         QUID_OK if possibly present, QUID_ERROR if certainly absent
+ */
+QUID_LIB_API cresult quid_xorf_contains(const quid_xorf_t *xorf, const cuuid_t *cuuid) {
+    quid128_t key;
+
+    if (!xorf || !cuuid) { return QUID_INVALID_PARAM; }
+
+    quid_pack(cuuid, &key);
+    return xorf_test(xorf, mix64(quid_hash128(&key) + xorf->header->seed)) ? QUID_OK : QUID_ERROR;
+}
+
+/**
+ * Check array of identifiers against filter, see quid_bloom_query_bulk.
+ *
+ * @param   xorf   Filter to query
+ * @param   cuuid  Array of quid structures
+ * @param   n      Number of elements in the array, at most UINT32_MAX
+ * @param   sel    Output row numbers of possibly present identifiers,
+ *                 must hold n elements
+ * @return         Number of selected rows
+ */
+QUID_LIB_API size_t quid_xorf_query_bulk(const quid_xorf_t *xorf, const cuuid_t *cuuid, size_t n, uint32_t *sel) {
+    uint64_t hash[FILTER_BATCH];
+    quid128_t key;
+    size_t count = 0;
+
+    if (!xorf || !cuuid || !sel) { return 0; }
+
+    uint32_t block_length = (uint32_t)xorf->header->block_length;
+    for (size_t base = 0; base < n; base += FILTER_BATCH) {
+        size_t len = (n - base < FILTER_BATCH) ? n - base : FILTER_BATCH;
+
+        for (size_t i = 0; i < len; ++i) {
+            quid_pack(&cuuid[base + i], &key);
+            hash[i] = mix64(quid_hash128(&key) + xorf->header->seed);
+            for (int s = 0; s < 3; ++s) {
+                bit_prefetch(&xorf->fingerprints[xorf_slot(hash[i], s, block_length)]);
+            }
+        }
+
+        for (size_t i = 0; i < len; ++i) {
+            sel[count] = (uint32_t)(base + i);
+            count += xorf_test(xorf, hash[i]);
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Retrieve flat buffer of filter. The buffer can be stored and
+ * opened with quid_xorf_view later on.
+ *
+ * @param   xorf    Filter
+ * @param   length  Output size of the buffer
+ * @return          Flat buffer
+ */
+QUID_LIB_API const void *quid_xorf_data(const quid_xorf_t *xorf, size_t *length) {
+    assert(xorf);
+
+    if (length) {
+        *length = xorf->length;
+    }
+
+    return xorf->header;
+}
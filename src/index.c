@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Read only index over an array of identifiers sorted by quid_order.
+ * The index keeps the packed key of every 64th row in a fence table,
+ * which is small enough to stay in cache. A lookup searches the fence
+ * table and then bisects a single block of rows. Since timestamps of
+ * generated identifiers are spread evenly, the fence table is searched
+ * by interpolation, alternated with bisection to bound the worst case.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include <quid.h>
+
+#include "bits.h"
+
+#define FENCE_INTERVAL  64              /* Rows per fence */
+
+struct quid_index {
+    const cuuid_t   *rows;              /* Indexed array, owned by the caller */
+    size_t          count;              /* Number of rows */
+    quid128_t       *fences;            /* Key of every FENCE_INTERVAL row */
+    size_t          nfences;            /* Number of fences */
+};
+
+static inline int key_less(const quid128_t *k1, const quid128_t *k2) {
+    return k1->hi < k2->hi || (k1->hi == k2->hi && k1->lo < k2->lo);
+}
+
+/**
+ * Count fences less than key. Interpolation on the upper word
+ * is alternated with bisection.
+ */
+static size_t fence_rank(const quid_index_t *index, const quid128_t *key) {
+    size_t lo = 0, hi = index->nfences;
+    int interpolate = 1;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (interpolate && hi - lo > 2) {
+            uint64_t first = index->fences[lo].hi;
+            uint64_t last = index->fences[hi - 1].hi;
+
+            if (key->hi <= first) {
+                mid = lo;
+            } else if (key->hi > last) {
+                mid = hi - 1;
+            } else {
+                mid = lo + (size_t)((double)(key->hi - first) / (double)(last - first) * (double)(hi - 1 - lo));
+            }
+        }
+        interpolate = !interpolate;
+
+        if (key_less(&index->fences[mid], key)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/* First row not less than key */
+static size_t index_lower_bound(const quid_index_t *index, const quid128_t *key) {
+    size_t rank = fence_rank(index, key);
+    size_t lo, hi;
+
+    if (!rank) {
+        return 0;
+    }
+
+    /* All rows up to and including the fence are less than key */
+    lo = (rank - 1) * FENCE_INTERVAL + 1;
+    hi = rank * FENCE_INTERVAL;
+    if (hi > index->count) {
+        hi = index->count;
+    }
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        quid128_t row;
+
+        quid_pack(&index->rows[mid], &row);
+        if (key_less(&row, key)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/**
+ * Build index over array of identifiers. The array must be sorted
+ * by quid_order, see quid_sort, and must outlive the index.
+ *
+ * @param   rows   Sorted array of quid structures
+ * @param   n      Number of elements in the array
+ * @return         New index or NULL if the array is not sorted
+ */
+QUID_LIB_API quid_index_t *quid_index_build(const cuuid_t *rows, size_t n) {
+    quid_index_t *index;
+    quid128_t prev, key;
+
+    if (!rows && n) { return NULL; }
+
+    index = malloc(sizeof(quid_index_t));
+    if (!index) {
+        return NULL;
+    }
+
+    index->rows = rows;
+    index->count = n;
+    index->nfences = (n + FENCE_INTERVAL - 1) / FENCE_INTERVAL;
+    index->fences = malloc((index->nfences ? index->nfences : 1) * sizeof(quid128_t));
+    if (!index->fences) {
+        free(index);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        quid_pack(&rows[i], &key);
+        if (i && key_less(&key, &prev)) {
+            quid_index_free(index);
+            return NULL;
+        }
+
+        if (i % FENCE_INTERVAL == 0) {
+            index->fences[i / FENCE_INTERVAL] = key;
+        }
+        prev = key;
+    }
+
+    return index;
+}
+
+/* Release index, the indexed array is left untouched */
+QUID_LIB_API void quid_index_free(quid_index_t *index) {
+    if (!index) { return; }
+
+    free(index->fences);
+    free(index);
+}
+
+/**
+ * Find rows created in time range. The matching rows are the
+ * consecutive rows starting at first up to but excluding last.
+ *
+ * @param   index  Index to search
+ * @param   t0     Start of range in nanoseconds since epoch, inclusive
+ * @param   t1     End of range in nanoseconds since epoch, exclusive
+ * @param   first  Output first matching row
+ * @param   last   Output row following the last matching row
+ * @return         QUID_OK if any row matches, QUID_ERROR otherwise
+ */
+QUID_LIB_API cresult quid_index_range(const quid_index_t *index, int64_t t0, int64_t t1, size_t *first, size_t *last) {
+    quid128_t key;
+
+    if (!index || !first || !last) { return QUID_INVALID_PARAM; }
+
+    key.lo = 0;
+    key.hi = ns_to_ticks(t0) << 4;
+    *first = index_lower_bound(index, &key);
+
+    key.hi = ns_to_ticks(t1) << 4;
+    *last = index_lower_bound(index, &key);
+
+    if (*last < *first) {
+        *last = *first;
+    }
+
+    return *first < *last ? QUID_OK : QUID_ERROR;
+}
+
+/**
+ * Find row of identifier.
+ *
+ * @param   index  Index to search
+ * @param   cuuid  Identifier to find
+ * @param   pos    Output row of the identifier
+ * @return         QUID_OK if found, QUID_ERROR otherwise
+ */
+QUID_LIB_API cresult quid_index_find(const quid_index_t *index, const cuuid_t *cuuid, size_t *pos) {
+    quid128_t key, row;
+    size_t i;
+
+    if (!index || !cuuid || !pos) { return QUID_INVALID_PARAM; }
+
+    quid_pack(cuuid, &key);
+    i = index_lower_bound(index, &key);
+    if (i == index->count) {
+        return QUID_ERROR;
+    }
+
+    quid_pack(&index->rows[i], &row);
+    if (row.hi != key.hi || row.lo != key.lo) {
+        return QUID_ERROR;
+    }
+
+    *pos = i;
+    return QUID_OK;
+}
@@ -0,0 +1,544 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Append only identifier log. Packed identifiers are appended as fixed
+ * 16 byte records to memory mapped segment files, named sequentially
+ * in the log directory. A segment is rotated when it is full or when
+ * its time span is exceeded. Every segment starts with a header and a
+ * sparse index holding, per block of LOG_BLOCK records, the smallest
+ * timestamp in the block and the largest timestamp up to and including
+ * the block. The latter never decreases, so the first block of a time
+ * range is found by bisection. Records are handed out straight from
+ * the mapping. Records use host byte order.
+ */
+
+#ifndef WIN32
+# define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <quid.h>
+
+#include "bits.h"
+
+#ifndef WIN32
+
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define LOG_MAGIC       0x474f4c51      /* "QLOG" */
+#define LOG_FORMAT      1               /* Segment format version */
+#define LOG_BLOCK       256             /* Records per index entry */
+#define LOG_PAGE        4096            /* Record alignment in segment */
+#define LOG_SEGMENT     (64 * 1024 * 1024)
+#define LOG_SUFFIX      ".qlog"
+
+typedef struct {
+    uint32_t    magic;
+    uint32_t    format;
+    uint64_t    capacity;               /* Records that fit the segment */
+    uint64_t    count;                  /* Records written */
+    uint64_t    offset;                 /* File offset of first record */
+    uint64_t    min;                    /* Smallest timestamp in segment */
+    uint64_t    max;                    /* Largest timestamp in segment */
+    uint64_t    reserved[2];
+} log_header_t;
+
+typedef struct {
+    uint64_t    max;                    /* Largest timestamp up to block */
+    uint64_t    min;                    /* Smallest timestamp in block */
+} log_entry_t;
+
+typedef struct {
+    unsigned        id;                 /* Sequence number of segment */
+    uint8_t         *base;              /* Mapping of segment file */
+    size_t          length;
+    log_header_t    *header;
+    log_entry_t     *index;
+    quid128_t       *records;
+} segment_t;
+
+struct quid_log {
+    char        *path;                  /* Log directory */
+    size_t      segment_size;           /* Size of new segments */
+    uint64_t    span;                   /* Time span of segment in ticks */
+    size_t      count;                  /* Number of segments */
+    size_t      capacity;
+    segment_t   *segments;
+};
+
+static int segment_name(const quid_log_t *log, unsigned id, char *name, size_t size) {
+    int rs = snprintf(name, size, "%s/%08u" LOG_SUFFIX, log->path, id);
+    return rs > 0 && (size_t)rs < size;
+}
+
+/* Map segment file and check header */
+static int segment_map(segment_t *segment, int fd) {
+    off_t length = lseek(fd, 0, SEEK_END);
+    log_header_t *header;
+
+    if (length < LOG_PAGE) {
+        return 0;
+    }
+
+    segment->base = mmap(NULL, (size_t)length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (segment->base == MAP_FAILED) {
+        segment->base = NULL;
+        return 0;
+    }
+
+    segment->length = (size_t)length;
+    header = (log_header_t *)segment->base;
+    if (header->magic != LOG_MAGIC
+        || header->format != LOG_FORMAT
+        || header->count > header->capacity
+        || header->offset % LOG_PAGE
+        || header->offset + header->capacity * sizeof(quid128_t) > segment->length
+        || sizeof(log_header_t) + (header->capacity + LOG_BLOCK - 1) / LOG_BLOCK * sizeof(log_entry_t) > header->offset) {
+        munmap(segment->base, segment->length);
+        segment->base = NULL;
+        return 0;
+    }
+
+    segment->header = header;
+    segment->index = (log_entry_t *)(segment->base + sizeof(log_header_t));
+    segment->records = (quid128_t *)(segment->base + header->offset);
+    return 1;
+}
+
+static segment_t *segment_push(quid_log_t *log) {
+    if (log->count == log->capacity) {
+        size_t capacity = log->capacity ? log->capacity * 2 : 8;
+        segment_t *segments = realloc(log->segments, capacity * sizeof(segment_t));
+        if (!segments) {
+            return NULL;
+        }
+        log->segments = segments;
+        log->capacity = capacity;
+    }
+
+    memset(&log->segments[log->count], 0, sizeof(segment_t));
+    return &log->segments[log->count++];
+}
+
+/* Create next segment file */
+static segment_t *segment_create(quid_log_t *log) {
+    char name[4096];
+    unsigned id = log->count ? log->segments[log->count - 1].id + 1 : 0;
+    uint64_t blocks, offset;
+    segment_t *segment;
+    log_header_t header;
+    int fd;
+
+    if (!segment_name(log, id, name, sizeof(name))) {
+        return NULL;
+    }
+
+    /* Index is sized for the most records the file could hold */
+    blocks = (log->segment_size / sizeof(quid128_t) + LOG_BLOCK - 1) / LOG_BLOCK;
+    offset = (sizeof(log_header_t) + blocks * sizeof(log_entry_t) + LOG_PAGE - 1) / LOG_PAGE * LOG_PAGE;
+
+    memset(&header, 0, sizeof(log_header_t));
+    header.magic = LOG_MAGIC;
+    header.format = LOG_FORMAT;
+    header.capacity = (log->segment_size - offset) / sizeof(quid128_t);
+    header.offset = offset;
+    header.min = UINT64_MAX;
+
+    fd = open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (ftruncate(fd, (off_t)log->segment_size) || pwrite(fd, &header, sizeof(log_header_t), 0) != sizeof(log_header_t)) {
+        goto fail;
+    }
+
+    segment = segment_push(log);
+    if (!segment) {
+        goto fail;
+    }
+
+    if (!segment_map(segment, fd)) {
+        log->count--;
+        goto fail;
+    }
+
+    segment->id = id;
+    close(fd);
+    return segment;
+
+fail:
+    close(fd);
+    unlink(name);
+    return NULL;
+}
+
+static int compare_id(const void *a, const void *b) {
+    unsigned x = *(const unsigned *)a;
+    unsigned y = *(const unsigned *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Map all segments found in log directory */
+static int log_load(quid_log_t *log) {
+    unsigned *ids = NULL;
+    size_t count = 0, capacity = 0;
+    struct dirent *entry;
+    DIR *dir;
+    int rs = 1;
+
+    dir = opendir(log->path);
+    if (!dir) {
+        return 0;
+    }
+
+    while ((entry = readdir(dir))) {
+        char *end;
+        unsigned long id = strtoul(entry->d_name, &end, 10);
+
+        if (end == entry->d_name || strcmp(end, LOG_SUFFIX) || id > UINT32_MAX) {
+            continue;
+        }
+
+        if (count == capacity) {
+            unsigned *resized;
+            capacity = capacity ? capacity * 2 : 8;
+            resized = realloc(ids, capacity * sizeof(unsigned));
+            if (!resized) {
+                rs = 0;
+                goto done;
+            }
+            ids = resized;
+        }
+        ids[count++] = (unsigned)id;
+    }
+
+    if (count) {
+        qsort(ids, count, sizeof(unsigned), compare_id);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        char name[4096];
+        segment_t *segment;
+        int fd;
+
+        if (!segment_name(log, ids[i], name, sizeof(name))) {
+            rs = 0;
+            break;
+        }
+
+        fd = open(name, O_RDWR);
+        if (fd < 0) {
+            rs = 0;
+            break;
+        }
+
+        segment = segment_push(log);
+        if (!segment || !segment_map(segment, fd)) {
+            if (segment) {
+                log->count--;
+            }
+            close(fd);
+            rs = 0;
+            break;
+        }
+
+        segment->id = ids[i];
+        close(fd);
+    }
+
+done:
+    closedir(dir);
+    free(ids);
+    return rs;
+}
+
+/**
+ * Open identifier log in directory, existing segments are mapped.
+ *
+ * @param   path  Log directory, must exist
+ * @param   size  Size of segment files in bytes, 0 for default
+ * @param   span  Time span of segment in nanoseconds, 0 for unlimited
+ * @return        Log or NULL on faillure
+ */
+QUID_LIB_API quid_log_t *quid_log_open(const char *path, size_t size, int64_t span) {
+    quid_log_t *log;
+
+    if (!path) {
+        return NULL;
+    }
+
+    if (!size) {
+        size = LOG_SEGMENT;
+    }
+
+    /* At least one page of records */
+    size = (size + LOG_PAGE - 1) / LOG_PAGE * LOG_PAGE;
+    if (size < 2 * LOG_PAGE) {
+        size = 2 * LOG_PAGE;
+    }
+
+    log = calloc(1, sizeof(quid_log_t));
+    if (!log) {
+        return NULL;
+    }
+
+    log->path = malloc(strlen(path) + 1);
+    if (!log->path) {
+        free(log);
+        return NULL;
+    }
+
+    strcpy(log->path, path);
+    log->segment_size = size;
+    log->span = span > 0 ? ns_to_ticks(span) : 0;
+
+    if (!log_load(log)) {
+        quid_log_close(log);
+        return NULL;
+    }
+
+    return log;
+}
+
+/* Unmap segments and release log */
+QUID_LIB_API void quid_log_close(quid_log_t *log) {
+    if (!log) { return; }
+
+    for (size_t i = 0; i < log->count; ++i) {
+        munmap(log->segments[i].base, log->segments[i].length);
+    }
+
+    free(log->segments);
+    free(log->path);
+    free(log);
+}
+
+/* Number of records in log */
+QUID_LIB_API size_t quid_log_size(const quid_log_t *log) {
+    size_t size = 0;
+
+    if (!log) { return 0; }
+
+    for (size_t i = 0; i < log->count; ++i) {
+        size += (size_t)log->segments[i].header->count;
+    }
+
+    return size;
+}
+
+/**
+ * Append identifiers to log. The log has a single writer.
+ *
+ * @param   log    Identifier log
+ * @param   cuuid  Array of quid structures
+ * @param   n      Number of elements in the array
+ * @return         QUID_OK on success, QUID_ERROR if a segment could not be created
+ */
+QUID_LIB_API cresult quid_log_append(quid_log_t *log, const cuuid_t *cuuid, size_t n) {
+    segment_t *segment = NULL;
+
+    if (!log || (!cuuid && n)) { return QUID_INVALID_PARAM; }
+
+    if (log->count) {
+        segment = &log->segments[log->count - 1];
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        log_header_t *header;
+        log_entry_t *entry;
+        quid128_t key;
+        uint64_t ticks;
+
+        quid_pack(&cuuid[i], &key);
+        ticks = key.hi >> 4;
+
+        if (!segment
+            || segment->header->count == segment->header->capacity
+            || (log->span && segment->header->count && ticks >= segment->header->min + log->span)) {
+            segment = segment_create(log);
+            if (!segment) {
+                return QUID_ERROR;
+            }
+        }
+
+        header = segment->header;
+        entry = &segment->index[header->count / LOG_BLOCK];
+        if (header->count % LOG_BLOCK == 0) {
+            entry->min = ticks;
+            entry->max = header->count ? entry[-1].max : ticks;
+        }
+
+        entry->min = ticks < entry->min ? ticks : entry->min;
+        entry->max = ticks > entry->max ? ticks : entry->max;
+        header->min = ticks < header->min ? ticks : header->min;
+        header->max = ticks > header->max ? ticks : header->max;
+
+        /* Record is in place before it is counted */
+        segment->records[header->count] = key;
+        header->count++;
+    }
+
+    return QUID_OK;
+}
+
+/* Flush the active segment to disk */
+QUID_LIB_API cresult quid_log_sync(quid_log_t *log) {
+    segment_t *segment;
+
+    if (!log) { return QUID_INVALID_PARAM; }
+    if (!log->count) { return QUID_OK; }
+
+    segment = &log->segments[log->count - 1];
+    return msync(segment->base, segment->length, MS_SYNC) ? QUID_ERROR : QUID_OK;
+}
+
+/* First block that may hold a timestamp not before lower */
+static size_t segment_seek(const segment_t *segment, size_t blocks, uint64_t lower) {
+    size_t lo = 0, hi = blocks;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (segment->index[mid].max < lower) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/**
+ * Scan identifiers created in time range. Matching records are passed
+ * to the callback in runs pointing into the segment mapping, records
+ * are in append order. The callback returns non-zero to stop the scan.
+ *
+ * @param   log   Identifier log
+ * @param   t0    Start of range in nanoseconds since epoch, inclusive
+ * @param   t1    End of range in nanoseconds since epoch, exclusive
+ * @param   cb    Callback receiving runs of records
+ * @param   arg   Argument passed to callback
+ * @return        Number of records passed to the callback
+ */
+QUID_LIB_API size_t quid_log_scan(const quid_log_t *log, int64_t t0, int64_t t1, quid_log_cb_t cb, void *arg) {
+    uint64_t lower = ns_to_ticks(t0);
+    uint64_t upper = ns_to_ticks(t1);
+    size_t total = 0;
+
+    if (!log || !cb) { return 0; }
+
+    for (size_t s = 0; s < log->count; ++s) {
+        const segment_t *segment = &log->segments[s];
+        size_t count = (size_t)segment->header->count;
+        size_t blocks = (count + LOG_BLOCK - 1) / LOG_BLOCK;
+
+        if (!count || segment->header->max < lower || segment->header->min >= upper) {
+            continue;
+        }
+
+        for (size_t b = segment_seek(segment, blocks, lower); b < blocks; ++b) {
+            size_t end = (b + 1) * LOG_BLOCK < count ? (b + 1) * LOG_BLOCK : count;
+            size_t run = 0;
+
+            if (segment->index[b].min >= upper) {
+                continue;
+            }
+
+            /* Hand out maximal runs of matching records */
+            for (size_t i = b * LOG_BLOCK; i <= end; ++i) {
+                uint64_t ticks = (i < end) ? segment->records[i].hi >> 4 : upper;
+
+                if (ticks >= lower && ticks < upper) {
+                    run++;
+                    continue;
+                }
+
+                if (run) {
+                    total += run;
+                    if (cb(&segment->records[i - run], run, arg)) {
+                        return total;
+                    }
+                    run = 0;
+                }
+            }
+        }
+    }
+
+    return total;
+}
+
+#else
+
+QUID_LIB_API quid_log_t *quid_log_open(const char *path, size_t size, int64_t span) {
+    ((void)path);
+    ((void)size);
+    ((void)span);
+    return NULL;
+}
+
+QUID_LIB_API void quid_log_close(quid_log_t *log) {
+    ((void)log);
+}
+
+QUID_LIB_API size_t quid_log_size(const quid_log_t *log) {
+    ((void)log);
+    return 0;
+}
+
+QUID_LIB_API cresult quid_log_append(quid_log_t *log, const cuuid_t *cuuid, size_t n) {
+    ((void)log);
+    ((void)cuuid);
+    ((void)n);
+    return QUID_ERROR;
+}
+
+QUID_LIB_API cresult quid_log_sync(quid_log_t *log) {
+    ((void)log);
+    return QUID_ERROR;
+}
+
+QUID_LIB_API size_t quid_log_scan(const quid_log_t *log, int64_t t0, int64_t t1, quid_log_cb_t cb, void *arg) {
+    ((void)log);
+    ((void)t0);
+    ((void)t1);
+    ((void)cb);
+    ((void)arg);
+    return 0;
+}
+
+#endif // WIN32
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Radix partitioning of identifier arrays. The partition of every row
+ * is derived from its decoded attributes in blocks, a histogram of the
+ * partitions gives the output offsets and a second pass scatters the
+ * rows. Rows are staged in small per partition buffers of whole cache
+ * lines, so the scatter writes full lines instead of touching a line
+ * per row in each partition. Rows keep their relative order.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include <quid.h>
+
+#include "bits.h"
+
+#define PARTITION_BLOCK 256             /* Rows decoded at once */
+#define PARTITION_WC    4               /* Rows per write combining buffer */
+#define PARTITION_MAX   256             /* Largest partition count staged, 32 KB of buffers */
+
+/* Stage buffer of one partition, aligned to a cache line */
+typedef struct {
+    cuuid_t     rows[PARTITION_WC];
+} stage_t;
+
+static inline uint32_t tag_value(const char tag[3]) {
+    return (uint32_t)(uint8_t)tag[0] << 16 | (uint32_t)(uint8_t)tag[1] << 8 | (uint8_t)tag[2];
+}
+
+/*
+ * Time bucket of timestamp modulo partition count for a width that is
+ * not a whole number of ticks. The timestamp in nanoseconds does not
+ * fit 64 bits, so the ticks are split into quotient and remainder of
+ * the width and the remainder is scaled by long division over the bits
+ * of NS_PER_TICK. Neither step can overflow as the width is below 2^63.
+ */
+static uint32_t time_bucket(uint64_t ticks, uint64_t width, uint32_t npart) {
+    uint64_t q = 0, r = 0;
+    uint64_t b = ticks % width;
+
+    for (uint64_t m = 64; m; m >>= 1) {
+        q <<= 1;
+        r <<= 1;
+        if (r >= width) {
+            r -= width;
+            q++;
+        }
+        if (NS_PER_TICK & m) {
+            r += b;
+            if (r >= width) {
+                r -= width;
+                q++;
+            }
+        }
+    }
+
+    return (uint32_t)(((ticks / width % npart) * NS_PER_TICK + q) % npart);
+}
+
+/* Compute partition for block of rows */
+static void partition_keys(const cuuid_t *cuuid, size_t n, int key, uint64_t width, uint32_t npart, uint32_t *part) {
+    quid_attr_t attr[PARTITION_BLOCK];
+
+    if (key == QUID_KEY_TIME_BUCKET) {
+        uint64_t tick_width = (width % NS_PER_TICK) ? 0 : width / NS_PER_TICK;
+
+        for (size_t i = 0; i < n; ++i) {
+            quid128_t k;
+            quid_pack(&cuuid[i], &k);
+            part[i] = tick_width
+                ? (uint32_t)((k.hi >> 4) / tick_width % npart)
+                : time_bucket(k.hi >> 4, width, npart);
+        }
+        return;
+    }
+
+    quid_decode_bulk(cuuid, n, attr);
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t value;
+
+        switch (key) {
+            case QUID_KEY_CATEGORY:
+                value = attr[i].category;
+                break;
+            case QUID_KEY_FLAG:
+                value = attr[i].flag;
+                break;
+            default:
+                value = (uint32_t)mix64(tag_value(attr[i].tag));
+                break;
+        }
+
+        part[i] = value % npart;
+    }
+}
+
+/**
+ * Partition identifiers by attribute. Rows are assigned partition
+ * key value modulo the partition count; tags are hashed first and
+ * time buckets count from the epoch. Rows that cannot be decoded have
+ * a key value of zero.
+ *
+ * @param   cuuid    Array of quid structures
+ * @param   n        Number of elements in the array
+ * @param   key      Partition key, QUID_KEY_*
+ * @param   width    Bucket width in nanoseconds for QUID_KEY_TIME_BUCKET
+ * @param   out      Output array, must hold n elements
+ * @param   offsets  Output start of each partition, must hold npart + 1 elements
+ * @param   npart    Number of partitions
+ * @return           QUID_OK on success
+ */
+QUID_LIB_API cresult quid_partition_by(const cuuid_t *cuuid, size_t n, int key, int64_t width, cuuid_t *out, size_t *offsets, size_t npart) {
+    uint32_t *part;
+    size_t *cursor;
+    stage_t *stage = NULL;
+    uint8_t *fill = NULL;
+    void *alloc = NULL;
+
+    if ((!cuuid || !out) && n) { return QUID_INVALID_PARAM; }
+    if (!offsets || !npart || npart > UINT32_MAX) { return QUID_INVALID_PARAM; }
+    if (key < QUID_KEY_CATEGORY || key > QUID_KEY_TIME_BUCKET) { return QUID_INVALID_PARAM; }
+    if (key == QUID_KEY_TIME_BUCKET && width <= 0) { return QUID_INVALID_PARAM; }
+
+    part = malloc((n ? n : 1) * sizeof(uint32_t));
+    cursor = malloc(npart * sizeof(size_t));
+    if (!part || !cursor) {
+        free(part);
+        free(cursor);
+        return QUID_ERROR;
+    }
+
+    /* Histogram pass */
+    memset(offsets, 0, (npart + 1) * sizeof(size_t));
+    for (size_t i = 0; i < n; i += PARTITION_BLOCK) {
+        size_t m = (n - i < PARTITION_BLOCK) ? n - i : PARTITION_BLOCK;
+
+        partition_keys(&cuuid[i], m, key, (uint64_t)width, (uint32_t)npart, &part[i]);
+        for (size_t j = 0; j < m; ++j) {
+            offsets[part[i + j] + 1]++;
+        }
+    }
+
+    for (size_t p = 0; p < npart; ++p) {
+        offsets[p + 1] += offsets[p];
+        cursor[p] = offsets[p];
+    }
+
+    /* Stage rows only while all stage buffers fit in the first level cache */
+    if (npart <= PARTITION_MAX) {
+        alloc = malloc(npart * sizeof(stage_t) + 64);
+        fill = calloc(npart, sizeof(uint8_t));
+        if (!alloc || !fill) {
+            free(alloc);
+            free(fill);
+            alloc = NULL;
+            fill = NULL;
+        } else {
+            stage = (stage_t *)(((uintptr_t)alloc + 63) & ~(uintptr_t)63);
+        }
+    }
+
+    if (!stage) {
+        for (size_t i = 0; i < n; ++i) {
+            out[cursor[part[i]]++] = cuuid[i];
+        }
+    } else {
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t p = part[i];
+
+            stage[p].rows[fill[p]++] = cuuid[i];
+            if (fill[p] == PARTITION_WC) {
+                memcpy(&out[cursor[p]], stage[p].rows, sizeof(stage_t));
+                cursor[p] += PARTITION_WC;
+                fill[p] = 0;
+            }
+        }
+
+        /* Drain partially filled buffers */
+        for (size_t p = 0; p < npart; ++p) {
+            memcpy(&out[cursor[p]], stage[p].rows, fill[p] * sizeof(cuuid_t));
+        }
+    }
+
+    free(alloc);
+    free(fill);
+    free(part);
+    free(cursor);
+    return QUID_OK;
+}
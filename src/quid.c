@@ -54,6 +54,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <stdatomic.h>
 #include <assert.h>
 
 #ifdef WIN32
@@ -68,13 +69,14 @@
 #include <config.h>
 
 #include "chacha.h"
+#include "bits.h"
 
 #define UIDS_PER_TICK   1024             /* Generate identifiers per tick interval */
 #define RANDFILE        ".rnd"           /* File descriptor for random seed */
 #define MEM_SEED_CYCLE  65536            /* Generate new memory seed after interval */
 #define RND_SEED_CYCLE  4096             /* Generate new random seed after interval */
 #define SEEDSZ          16               /* Seed size */
-#define QUIDMAGIC       0x80             /* QUID Timestamp magic */
+#define FILTER_BLOCK    256              /* Timestamps reconstructed per filter step */
 
 #define VERSION_REV4    0xa000
 #define VERSION_REV7    0xb000
@@ -159,26 +161,159 @@ static int memvcmp(void *memory, unsigned char val, unsigned int size)
 #endif // NDEBUG
 
 /**
-* Compare two quid structures and return match result.
+* Compare two quid structures and return match result. The fields
+* are compared as two packed words without branches.
 *
 * @param   s1  First quid to be compared
 * @param   s2  Second quid to be compared with first
-* @return      QUID_OK if the two identifiers did not match
+* @return      QUID_OK if the two identifiers did match
 */
 QUID_LIB_API cresult quid_cmp(const cuuid_t *s1, const cuuid_t *s2) {
+    quid128_t k1, k2;
+
     if (!s1 || !s2) { return QUID_INVALID_PARAM; }
 
-    return s1->time_low == s2->time_low
-        && s1->time_mid == s2->time_mid
-        && s1->time_hi_and_version == s2->time_hi_and_version
-        && s1->clock_seq_hi_and_reserved == s2->clock_seq_hi_and_reserved
-        && s1->clock_seq_low == s2->clock_seq_low
-        && s1->node[0] == s2->node[0]
-        && s1->node[1] == s2->node[1]
-        && s1->node[2] == s2->node[2]
-        && s1->node[3] == s2->node[3]
-        && s1->node[4] == s2->node[4]
-        && s1->node[5] == s2->node[5];
+    quid_pack(s1, &k1);
+    quid_pack(s2, &k2);
+
+    /* Packing drops the unused upper half of time_low */
+    return ((s1->time_low ^ s2->time_low) | (k1.hi ^ k2.hi) | (k1.lo ^ k2.lo)) == 0;
+}
+
+/**
+ * Pack quid structure into its 16 byte representation. The upper
+ * word holds the timestamp followed by the structure version, the
+ * lower word holds the clock sequence followed by the node.
+ *
+ * @param   cuuid  Input quid structure
+ * @param   key    Output packed identifier
+ */
+QUID_LIB_API void quid_pack(const cuuid_t *cuuid, quid128_t *key) {
+    assert(cuuid);
+    assert(key);
+
+    key->hi = (cuuid->time_low & 0xffffffff) << 4
+        | (uint64_t)cuuid->time_mid << 36
+        | (uint64_t)((cuuid->time_hi_and_version ^ QUIDMAGIC) & 0x0fff) << 52
+        | (uint64_t)(cuuid->time_hi_and_version >> 12);
+
+    key->lo = (uint64_t)cuuid->clock_seq_hi_and_reserved << 56
+        | (uint64_t)cuuid->clock_seq_low << 48
+        | (uint64_t)cuuid->node[0] << 40
+        | (uint64_t)cuuid->node[1] << 32
+        | (uint64_t)cuuid->node[2] << 24
+        | (uint64_t)cuuid->node[3] << 16
+        | (uint64_t)cuuid->node[4] << 8
+        | (uint64_t)cuuid->node[5];
+}
+
+/**
+ * Unpack 16 byte representation into quid structure. The internal
+ * version is derived from the structure version, the user defined
+ * tag is not part of the packed representation and is cleared.
+ *
+ * @param   key    Input packed identifier
+ * @param   cuuid  Output quid structure
+ */
+QUID_LIB_API void quid_unpack(const quid128_t *key, cuuid_t *cuuid) {
+    assert(key);
+    assert(cuuid);
+
+    cuuid->time_low = (key->hi >> 4) & 0xffffffff;
+    cuuid->time_mid = (uint16_t)(key->hi >> 36);
+    cuuid->time_hi_and_version = (uint16_t)((((key->hi >> 52) & 0x0fff) ^ QUIDMAGIC) | (key->hi & 0xf) << 12);
+
+    cuuid->clock_seq_hi_and_reserved = (uint8_t)(key->lo >> 56);
+    cuuid->clock_seq_low = (uint8_t)(key->lo >> 48);
+    cuuid->node[0] = (uint8_t)(key->lo >> 40);
+    cuuid->node[1] = (uint8_t)(key->lo >> 32);
+    cuuid->node[2] = (uint8_t)(key->lo >> 24);
+    cuuid->node[3] = (uint8_t)(key->lo >> 16);
+    cuuid->node[4] = (uint8_t)(key->lo >> 8);
+    cuuid->node[5] = (uint8_t)key->lo;
+
+    memset(cuuid->tag, '\0', sizeof(cuuid->tag));
+    if ((cuuid->time_hi_and_version & VERSION_REV7) == VERSION_REV7) {
+        cuuid->version = QUID_REV7;
+    } else if ((cuuid->time_hi_and_version & VERSION_REV4) == VERSION_REV4) {
+        cuuid->version = QUID_REV4;
+    } else {
+        cuuid->version = 0;
+    }
+}
+
+/**
+ * Order two packed identifiers. The comparison is free of branches
+ * and orders by timestamp first, followed by the remaining bits.
+ *
+ * @param   k1  First packed identifier
+ * @param   k2  Second packed identifier
+ * @return      Less than, equal to, or greater than zero if k1 is found,
+ *              respectively, to be less than, to match, or be greater than k2
+ */
+QUID_LIB_API int quid_order128(const quid128_t *k1, const quid128_t *k2) {
+    assert(k1);
+    assert(k2);
+
+    int hi = (k1->hi > k2->hi) - (k1->hi < k2->hi);
+    int lo = (k1->lo > k2->lo) - (k1->lo < k2->lo);
+
+    return 2 * hi + lo;
+}
+
+/**
+ * Order two quid structures, see quid_order128.
+ *
+ * @param   s1  First quid to be compared
+ * @param   s2  Second quid to be compared with first
+ * @return      Less than, equal to, or greater than zero if s1 is found,
+ *              respectively, to be less than, to match, or be greater than s2
+ */
+QUID_LIB_API int quid_order(const cuuid_t *s1, const cuuid_t *s2) {
+    quid128_t k1, k2;
+
+    if (!s1 || !s2) {
+        fprintf(stderr, "quid_order: 'cuuid' is uninitialized");
+        FATAL_ERROR_BAIL();
+    }
+
+    quid_pack(s1, &k1);
+    quid_pack(s2, &k2);
+
+    return quid_order128(&k1, &k2);
+}
+
+/**
+ * Hash packed identifier. Every bit of the input affects every
+ * bit of the output, so any subset of the result can be used
+ * as bucket index.
+ *
+ * @param   key  Packed identifier
+ * @return       64 bit hash
+ */
+QUID_LIB_API uint64_t quid_hash128(const quid128_t *key) {
+    assert(key);
+
+    return mix64(key->hi ^ mix64(key->lo ^ 0x9e3779b97f4a7c15ULL));
+}
+
+/**
+ * Hash quid structure over its significant bits. Identifiers that
+ * match according to quid_cmp produce the same hash.
+ *
+ * @param   cuuid  Input quid structure
+ * @return         64 bit hash
+ */
+QUID_LIB_API uint64_t quid_hash(const cuuid_t *cuuid) {
+    quid128_t key;
+
+    if (!cuuid) {
+        fprintf(stderr, "quid_hash: 'cuuid' is uninitialized");
+        FATAL_ERROR_BAIL();
+    }
+
+    quid_pack(cuuid, &key);
+    return quid_hash128(&key);
 }
 
 #ifndef HAS_GETTIMEOFDAY
@@ -232,6 +367,20 @@ static void get_system_time(cuuid_time_t *cuuid_time) {
     assert(cuuid_time);
 }
 
+/**
+ * Reconstruct the timestamp from the time fields. The version nibble
+ * is masked off instead of substracted per revision, which yields the
+ * same result for every revision and keeps the operation branch free.
+ *
+ * @param  cuuid   Quid input structure
+ * @return         Timestamp in 100 nanosecond intervals since epoch
+ */
+static inline cuuid_time_t quid_time_reconstruct(const cuuid_t *cuuid) {
+    return (cuuid->time_low & 0xffffffff)
+        | (uint64_t)cuuid->time_mid << 32
+        | (uint64_t)((cuuid->time_hi_and_version ^ QUIDMAGIC) & 0x0fff) << 48;
+}
+
 /**
  * Retrieve timestamp from QUID
  *
@@ -240,7 +389,6 @@ static void get_system_time(cuuid_time_t *cuuid_time) {
  */
 static void quid_timeval(cuuid_t *cuuid, struct timeval *tv) {
     cuuid_time_t cuuid_time;
-    uint16_t versubtr = 0;
     long int usec;
     time_t sec;
 
@@ -249,19 +397,8 @@ static void quid_timeval(cuuid_t *cuuid, struct timeval *tv) {
         FATAL_ERROR_BAIL();
     }
 
-    /* Determine version substraction */
-    switch (cuuid->version) {
-        case QUID_REV4:
-            versubtr = VERSION_REV4;
-            break;
-        case QUID_REV7:
-            versubtr = VERSION_REV7;
-            break;
-    }
-
     /* Reconstruct timestamp */
-    cuuid_time = (uint64_t)cuuid->time_low | (uint64_t)cuuid->time_mid << 32 | 
-    (uint64_t)((cuuid->time_hi_and_version ^ QUIDMAGIC) - versubtr) << 48;
+    cuuid_time = quid_time_reconstruct(cuuid);
 
     /* Timestamp to timeval */
     usec = (cuuid_time/10) % 1000000LL;
@@ -305,21 +442,117 @@ QUID_LIB_API struct tm *quid_timestamp(cuuid_t *cuuid) {
 #endif
 }
 
-//TODO: Return via parameter list
 /* Retrieve microtime */
 QUID_LIB_API long quid_microtime(cuuid_t *cuuid) {
-    struct timeval tv;
-
     if (!cuuid) {
         fprintf(stderr, "quid_microtime: 'cuuid' is uninitialized");
         FATAL_ERROR_BAIL();
     }
 
-    /* Fetch time from quid */
-    quid_timeval(cuuid, &tv);
-
     /* Microseconds */
-    return tv.tv_usec;
+    return (long)((quid_time_reconstruct(cuuid) / 10) % 1000000LL);
+}
+
+/**
+ * Retrieve timestamp as nanoseconds since epoch. Unlike quid_timestamp
+ * this function does not touch any shared state and is reentrant.
+ *
+ * @param  cuuid   Quid input structure
+ * @return         Nanoseconds since epoch
+ */
+QUID_LIB_API int64_t quid_epoch_ns(const cuuid_t *cuuid) {
+    if (!cuuid) {
+        fprintf(stderr, "quid_epoch_ns: 'cuuid' is uninitialized");
+        FATAL_ERROR_BAIL();
+    }
+
+    return (int64_t)quid_time_reconstruct(cuuid) * NS_PER_TICK;
+}
+
+/**
+ * Retrieve the timestamps of an array of identifiers as nanoseconds
+ * since epoch. The loop body consists of masks and shifts only, without
+ * any version dispatch, so the compiler is free to vectorize it.
+ *
+ * @param   cuuid  Array of quid structures
+ * @param   n      Number of elements in the array
+ * @param   out    Output array of at least n elements
+ * @return         QUID_OK on success
+ */
+QUID_LIB_API cresult quid_epoch_ns_bulk(const cuuid_t *cuuid, size_t n, int64_t *out) {
+    if (!n) { return QUID_OK; }
+    if (!cuuid || !out) { return QUID_INVALID_PARAM; }
+
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = (int64_t)quid_time_reconstruct(&cuuid[i]) * NS_PER_TICK;
+    }
+
+    return QUID_OK;
+}
+
+/**
+ * Select rows with a timestamp in the half open range [t0, t1). The
+ * bounds are converted to timestamp ticks once, the timestamps are
+ * reconstructed per block into a scratch buffer, after which the
+ * selection vector is written without branches.
+ *
+ * @param   cuuid  Array of quid structures
+ * @param   n      Number of elements in the array, at most UINT32_MAX
+ * @param   t0     Start of range in nanoseconds since epoch, inclusive
+ * @param   t1     End of range in nanoseconds since epoch, exclusive
+ * @param   sel    Output row numbers, must hold n elements
+ * @return         Number of selected rows
+ */
+QUID_LIB_API size_t quid_filter_time(const cuuid_t *cuuid, size_t n, int64_t t0, int64_t t1, uint32_t *sel) {
+    cuuid_time_t ticks[FILTER_BLOCK];
+    cuuid_time_t lower = ns_to_ticks(t0);
+    cuuid_time_t upper = ns_to_ticks(t1);
+    size_t count = 0;
+
+    if (!cuuid || !sel) { return 0; }
+
+    for (size_t base = 0; base < n; base += FILTER_BLOCK) {
+        size_t len = (n - base < FILTER_BLOCK) ? n - base : FILTER_BLOCK;
+
+        for (size_t i = 0; i < len; ++i) {
+            ticks[i] = quid_time_reconstruct(&cuuid[base + i]);
+        }
+
+        for (size_t i = 0; i < len; ++i) {
+            sel[count] = (uint32_t)(base + i);
+            count += (ticks[i] >= lower) & (ticks[i] < upper);
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Select rows with a timestamp in the half open range [t0, t1), see
+ * quid_filter_time. Operates on packed identifiers.
+ */
+QUID_LIB_API size_t quid_filter_time128(const quid128_t *keys, size_t n, int64_t t0, int64_t t1, uint32_t *sel) {
+    cuuid_time_t ticks[FILTER_BLOCK];
+    cuuid_time_t lower = ns_to_ticks(t0);
+    cuuid_time_t upper = ns_to_ticks(t1);
+    size_t count = 0;
+
+    if (!keys || !sel) { return 0; }
+
+    for (size_t base = 0; base < n; base += FILTER_BLOCK) {
+        size_t len = (n - base < FILTER_BLOCK) ? n - base : FILTER_BLOCK;
+
+        for (size_t i = 0; i < len; ++i) {
+            ticks[i] = keys[base + i].hi >> 4;
+        }
+
+        for (size_t i = 0; i < len; ++i) {
+            sel[count] = (uint32_t)(base + i);
+            count += (ticks[i] >= lower) & (ticks[i] < upper);
+        }
+    }
+
+    return count;
 }
 
 //TODO: Return via parameter list
@@ -419,6 +652,51 @@ QUID_LIB_API uint8_t quid_flag(cuuid_t *cuuid) {
     return QUID_ERROR;
 }
 
+/**
+ * Decode flag, category and tag of identifiers in one pass. Every
+ * REV7 node is decrypted once for all attributes.
+ *
+ * @param   cuuid  Array of quid structures
+ * @param   n      Number of elements in the array
+ * @param   attr   Output attributes, must hold n elements
+ * @return         QUID_OK on success
+ */
+QUID_LIB_API cresult quid_decode_bulk(const cuuid_t *cuuid, size_t n, quid_attr_t *attr) {
+    cuuid_node_t node;
+
+    if ((!cuuid || !attr) && n) { return QUID_INVALID_PARAM; }
+
+    for (size_t i = 0; i < n; ++i) {
+        memset(&attr[i], 0, sizeof(quid_attr_t));
+
+        switch (cuuid[i].version) {
+            case QUID_REV4:
+                attr[i].version = QUID_REV4;
+                attr[i].flag = cuuid[i].node[1];
+                attr[i].category = cuuid[i].node[2];
+                break;
+            case QUID_REV7:
+                memcpy(&node, &cuuid[i].node, sizeof(cuuid_node_t));
+                encrypt_node(cuuid[i].time_low, cuuid[i].clock_seq_hi_and_reserved, cuuid[i].clock_seq_low, &node);
+
+                /* Must match version */
+                if (node.node[0] != QUID_REV7) {
+                    break;
+                }
+
+                attr[i].version = QUID_REV7;
+                attr[i].flag = node.node[1];
+                attr[i].category = node.node[2];
+                if (memcmp(&node.node[3], padding, sizeof(padding))) {
+                    memcpy(attr[i].tag, &node.node[3], sizeof(attr[i].tag));
+                }
+                break;
+        }
+    }
+
+    return QUID_OK;
+}
+
 /**
  * Read seed or create if not exist.
  *
@@ -534,6 +812,26 @@ static void encrypt_node(uint64_t prekey, uint8_t preiv1, uint8_t preiv2, cuuid_
     assert(node);
 }
 
+/**
+ * Encrypt or decrypt a node in place with the same derivation as
+ * the library generators. The key is the lower time half of the
+ * identifier, the IV the clock sequence.
+ *
+ * @param  key    Lower time half
+ * @param  iv1    Clock sequence higher bits
+ * @param  iv2    Clock sequence lower bits
+ * @param  node   Node to encrypt, permuted in place
+ */
+QUID_LIB_API void quid_encrypt_node(uint64_t key, uint8_t iv1, uint8_t iv2, uint8_t node[6]) {
+    cuuid_node_t block;
+
+    assert(node);
+
+    memcpy(&block, node, sizeof(block));
+    encrypt_node(key, iv1, iv2, &block);
+    memcpy(node, &block, sizeof(block));
+}
+
 /* QUID format REV4 */
 QUID_LIB_API cresult quid_create_rev4(cuuid_t *uid, uint8_t flag, uint8_t subc) {
     cuuid_time_t    timestamp;
@@ -641,6 +939,196 @@ QUID_LIB_API cresult quid_create(cuuid_t *cuuid, uint8_t flag, uint8_t subc, cha
     return quid_create_rev7(cuuid, flag, subc, tag);
 }
 
+/* Advance the random state of a generator context */
+static inline uint64_t gen_random(quid_gen_t *gen) {
+    gen->rnd += 0x9e3779b97f4a7c15ULL;
+    return mix64(gen->rnd);
+}
+
+/* Last timestamp handed out by any generator context in the process */
+static _Atomic uint64_t gen_time_last;
+
+/**
+ * Reserve a run of consecutive timestamps for a generator. All
+ * contexts draw from the same process wide sequence so that no two
+ * contexts ever hand out the same timestamp. The run starts at the
+ * later of the observed time and the last reserved timestamp, and
+ * is refused when it would end more than UIDS_PER_TICK intervals
+ * ahead of the observed time.
+ *
+ * @param  now    Observed time in 100 nanosecond intervals
+ * @param  count  Number of timestamps to reserve, at most UIDS_PER_TICK
+ * @return        First reserved timestamp, or zero if the caller must
+ *                read the clock again and retry
+ */
+QUID_LIB_API uint64_t quid_gen_reserve(uint64_t now, size_t count) {
+    uint64_t last = atomic_load_explicit(&gen_time_last, memory_order_relaxed);
+    uint64_t next;
+
+    if (count == 0 || count > UIDS_PER_TICK) {
+        return 0;
+    }
+
+    do {
+        next = last + 1;
+        if (next < now) {
+            next = now;
+        }
+        if (next + count - 1 > now + UIDS_PER_TICK) {
+            return 0;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&gen_time_last, &last, next + count - 1,
+                                                    memory_order_relaxed, memory_order_relaxed));
+
+    return next;
+}
+
+/**
+ * Reserve timestamps for a generator context, waiting for the clock
+ * to catch up while the process wide sequence runs ahead of it.
+ *
+ * @param  gen    Generator context
+ * @param  now    Last observed system time, updated when the clock is read
+ * @param  count  Number of timestamps to reserve, at most UIDS_PER_TICK
+ * @return        First reserved timestamp in 100 nanosecond intervals
+ */
+static cuuid_time_t gen_next_time(quid_gen_t *gen, cuuid_time_t *now, size_t count) {
+    cuuid_time_t next;
+
+    while (!(next = quid_gen_reserve(*now, count))) {
+        get_system_time(now);
+    }
+
+    gen->time_last = next + count - 1;
+    return next;
+}
+
+/* Format a single identifier from the context */
+static void gen_format(quid_gen_t *gen, cuuid_time_t timestamp, cuuid_t *uid) {
+    uint64_t rnd = gen_random(gen);
+    cuuid_node_t node;
+
+    memset(uid, '\0', sizeof(cuuid_t));
+    memcpy(&node, gen->node, sizeof(node));
+
+    if (gen->version == QUID_REV4) {
+        uid->version = QUID_REV4;
+        uid->time_low = (uint64_t)(timestamp & 0xffffffff);
+        uid->time_mid = (uint16_t)((timestamp >> 32) & 0xffff);
+        uid->time_hi_and_version = (uint16_t)((((timestamp >> 48) & 0xfff) ^ QUIDMAGIC) | VERSION_REV4);
+        uid->clock_seq_low = (uint8_t)rnd;
+        uid->clock_seq_hi_and_reserved = (uint8_t)(((rnd & 0x3f00) >> 8) | QUIDMAGIC);
+
+        node.node[0] = (uint8_t)(rnd >> 16);
+        node.node[5] = (uint8_t)(rnd >> 24);
+        memcpy(&uid->node, &node, sizeof(uid->node));
+        return;
+    }
+
+    uid->version = QUID_REV7;
+    format_quid_rev7(uid, (uint16_t)rnd, timestamp);
+
+    encrypt_node(uid->time_low, uid->clock_seq_hi_and_reserved, uid->clock_seq_low, &node);
+    memcpy(&uid->node, &node, sizeof(uid->node));
+}
+
+/**
+ * Initialize a generator context. The flag, category and tag are
+ * fixed for the lifetime of the context. Any version other than
+ * QUID_REV4 yields the latest revision, like quid_create.
+ *
+ * @param  gen   Generator context, the caller must provide the memory
+ * @param  ver   Internal version to generate
+ * @param  flag  Indicator flag to encode in every identifier
+ * @param  subc  Subclass to encode in every identifier
+ * @param  tag   Optional tag, revision 7 only
+ * @return       QUID_OK on success
+ */
+QUID_LIB_API cresult quid_gen_init(quid_gen_t *gen, uint8_t ver, uint8_t flag, uint8_t subc, const char tag[3]) {
+    cuuid_time_t now;
+
+    if (!gen) { return QUID_INVALID_PARAM; }
+
+    get_system_time(&now);
+    gen->time_last = 0;
+    gen->rnd = mix64(now ^ (uint64_t)(uintptr_t)gen) ^ true_random();
+
+    if (ver == QUID_REV4) {
+        uint64_t seed = gen_random(gen);
+
+        gen->version = QUID_REV4;
+        gen->node[0] = 0;
+        gen->node[1] = flag;
+        gen->node[2] = subc;
+        gen->node[3] = (uint8_t)seed;
+        gen->node[4] = (uint8_t)(seed >> 8);
+        gen->node[5] = 0;
+        return QUID_OK;
+    }
+
+    gen->version = QUID_REV7;
+    gen->node[0] = QUID_REV7;
+    gen->node[1] = flag;
+    gen->node[2] = subc;
+    if (tag && tag[0] != 0 && tag[1] != 0 && tag[2] != 0) {
+        memcpy(&gen->node[3], tag, 3);
+    } else {
+        memcpy(&gen->node[3], padding, 3);
+    }
+
+    return QUID_OK;
+}
+
+/**
+ * Create the next identifier from a generator context.
+ *
+ * @param  gen   Generator context
+ * @param  uid   The quid output structure
+ * @return       QUID_OK on success
+ */
+QUID_LIB_API cresult quid_gen_next(quid_gen_t *gen, cuuid_t *uid) {
+    cuuid_time_t now;
+
+    if (!gen) { return QUID_INVALID_PARAM; }
+    if (!uid) { return QUID_INVALID_PARAM; }
+
+    get_system_time(&now);
+    gen_format(gen, gen_next_time(gen, &now, 1), uid);
+
+    return QUID_OK;
+}
+
+/**
+ * Fill an array with packed identifiers from a generator context.
+ * Timestamps are reserved in runs of up to UIDS_PER_TICK, the clock
+ * is read once per call and only again when a run would be ahead.
+ *
+ * @param  gen   Generator context
+ * @param  key   Output array of packed identifiers
+ * @param  n     Number of identifiers to create
+ * @return       QUID_OK on success
+ */
+QUID_LIB_API cresult quid_gen_fill(quid_gen_t *gen, quid128_t *key, size_t n) {
+    cuuid_time_t now;
+    cuuid_t uid;
+
+    if (!gen) { return QUID_INVALID_PARAM; }
+    if (!key && n) { return QUID_INVALID_PARAM; }
+
+    get_system_time(&now);
+    for (size_t i = 0; i < n;) {
+        size_t run = (n - i < UIDS_PER_TICK) ? n - i : UIDS_PER_TICK;
+        cuuid_time_t timestamp = gen_next_time(gen, &now, run);
+
+        for (size_t j = 0; j < run; ++j, ++i) {
+            gen_format(gen, timestamp + j, &uid);
+            quid_pack(&uid, &key[i]);
+        }
+    }
+
+    return QUID_OK;
+}
+
 /**
  * Format QUID from the timestamp, clocksequence, and node ID
  * Structure succeeds version 3 (REV1).
@@ -683,36 +1171,17 @@ static void format_quid_rev7(cuuid_t *uid, uint16_t clock_seq, cuuid_time_t time
     uid->clock_seq_hi_and_reserved |= QUIDMAGIC;
 }
 
-/* Get current time including cpu clock */
+/**
+ * Get current time for a single identifier. The timestamp is reserved
+ * from the sequence shared with the generator contexts, so identifiers
+ * from quid_create and from contexts never share a timestamp.
+ */
 static void get_current_time(cuuid_time_t *timestamp) {
-    static int              inited = 0;
-    static cuuid_time_t     time_last;
-    static uint16_t         ids_this_tick;
-    cuuid_time_t            time_now;
-
-    if (!inited) {
-        get_system_time(&time_now);
-        ids_this_tick = UIDS_PER_TICK;
-        inited = 1;
-    }
+    cuuid_time_t time_now;
 
-    for (;;) {
+    do {
         get_system_time(&time_now);
-
-        if (time_last != time_now) {
-            ids_this_tick = 0;
-            time_last = time_now;
-            break;
-        }
-
-        if (ids_this_tick < UIDS_PER_TICK) {
-            ids_this_tick++;
-            break;
-        }
-    }
-
-    *timestamp = time_now + ids_this_tick;
-    assert(timestamp);
+    } while (!(*timestamp = quid_gen_reserve(time_now, 1)));
 }
 
 /* Get hardware tick count */
@@ -882,6 +1351,72 @@ QUID_LIB_API cresult quid_parse(char *quid, cuuid_t *cuuid) {
     return QUID_OK;
 }
 
+/* Hex digit value plus one, zero for any other character */
+static const uint8_t hex_digit[256] = {
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+    ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
+/**
+ * Convert a string of known length to quid identifier. Accepts
+ * the same formats as quid_parse, but leaves the input untouched,
+ * does not require null termination and decodes the digits in a
+ * single pass without intermediate copies.
+ *
+ * @param    str    Input string to be parsed by the function
+ * @param    len    Length of the input string
+ * @param    cuuid  Output quid structure provided by the caller
+ * @return          QUID_OK on success
+ */
+QUID_LIB_API cresult quid_parse_n(const char *str, size_t len, cuuid_t *cuuid) {
+    uint8_t nibble[QUID_LEN];
+    size_t n = 0;
+
+    if (!str) { return QUID_INVALID_PARAM; }
+    if (!cuuid) { return QUID_INVALID_PARAM; }
+
+    for (size_t i = 0; i < len; ++i) {
+        unsigned char c = (unsigned char)str[i];
+        uint8_t v = hex_digit[c];
+
+        if (v) {
+            if (n == QUID_LEN) {
+                return QUID_ERROR;
+            }
+            nibble[n++] = v - 1;
+        } else if (c != '-' && c != '{' && c != '}' && c != ' ') {
+            return QUID_ERROR;
+        }
+    }
+
+    /* Fail if invalid length */
+    if (n != QUID_LEN) {
+        return QUID_ERROR;
+    }
+
+    cuuid->time_low = 0;
+    for (int i = 0; i < 8; ++i) {
+        cuuid->time_low = cuuid->time_low << 4 | nibble[i];
+    }
+
+    cuuid->time_mid = (uint16_t)(nibble[8] << 12 | nibble[9] << 8 | nibble[10] << 4 | nibble[11]);
+    cuuid->time_hi_and_version = (uint16_t)(nibble[12] << 12 | nibble[13] << 8 | nibble[14] << 4 | nibble[15]);
+    cuuid->clock_seq_hi_and_reserved = (uint8_t)(nibble[16] << 4 | nibble[17]);
+    cuuid->clock_seq_low = (uint8_t)(nibble[18] << 4 | nibble[19]);
+    for (int i = 0; i < 6; ++i) {
+        cuuid->node[i] = (uint8_t)(nibble[20 + i * 2] << 4 | nibble[21 + i * 2]);
+    }
+
+    memset(cuuid->tag, '\0', sizeof(cuuid->tag));
+    if (!quid_validate(cuuid)) {
+        return QUID_ERROR;
+    }
+
+    return QUID_OK;
+}
+
 /**
  * Convert quid structure to string. The caller must provide
  * an array capable of holding the size of a QUID_FULLLEN+1. If
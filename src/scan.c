@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Equality scans over arrays of packed identifiers. A packed
+ * identifier fills a 128 bit register, the key is compared against
+ * one identifier per SSE2 instruction or two per AVX2 instruction and
+ * the comparison results are collected as bitmasks. Builds without
+ * either fall back to a branch free scalar loop.
+ */
+
+#include <quid.h>
+
+#include "bits.h"
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+#endif
+
+#define SCAN_BATCH      64              /* Identifiers per mask word */
+
+/* Equality mask of up to 64 identifiers, bit i set if arr[i] matches */
+static inline uint64_t scan_mask(const quid128_t *arr, size_t n, const quid128_t *key) {
+    uint64_t mask = 0;
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    __m256i k = _mm256_set_epi64x((long long)key->lo, (long long)key->hi, (long long)key->lo, (long long)key->hi);
+
+    for (; i + 4 <= n; i += 4) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)&arr[i]);
+        __m256i b = _mm256_loadu_si256((const __m256i *)&arr[i + 2]);
+        uint64_t ma = (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(a, k)));
+        uint64_t mb = (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(b, k)));
+
+        /* Both words of an identifier must match */
+        ma &= ma >> 1;
+        mb &= mb >> 1;
+        mask |= ((ma & 1) | (ma >> 1 & 2) | (mb & 1) << 2 | (mb >> 1 & 2) << 2) << i;
+    }
+#elif defined(HAS_SSE2)
+    __m128i k = _mm_loadu_si128((const __m128i *)key);
+
+    for (; i + 4 <= n; i += 4) {
+        uint64_t m0 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)&arr[i]), k)) == 0xffff;
+        uint64_t m1 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)&arr[i + 1]), k)) == 0xffff;
+        uint64_t m2 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)&arr[i + 2]), k)) == 0xffff;
+        uint64_t m3 = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)&arr[i + 3]), k)) == 0xffff;
+
+        mask |= (m0 | m1 << 1 | m2 << 2 | m3 << 3) << i;
+    }
+#endif
+
+    for (; i < n; ++i) {
+        mask |= (uint64_t)(((arr[i].hi ^ key->hi) | (arr[i].lo ^ key->lo)) == 0) << i;
+    }
+
+    return mask;
+}
+
+/**
+ * Find identifier in unsorted array of packed identifiers.
+ *
+ * @param   arr  Array of packed identifiers
+ * @param   n    Number of elements in the array
+ * @param   key  Identifier to find
+ * @return       Position of the first match, or n if not found
+ */
+QUID_LIB_API size_t quid_find(const quid128_t *arr, size_t n, const quid128_t *key) {
+    if (!arr || !key) { return n; }
+
+    for (size_t base = 0; base < n; base += SCAN_BATCH) {
+        size_t len = (n - base < SCAN_BATCH) ? n - base : SCAN_BATCH;
+        uint64_t mask = scan_mask(&arr[base], len, key);
+
+        if (mask) {
+            return base + (size_t)bit_ctz64(mask);
+        }
+    }
+
+    return n;
+}
+
+/**
+ * Compare every identifier in array with key. Bit i of the mask is
+ * set if element i matches.
+ *
+ * @param   arr   Array of packed identifiers
+ * @param   n     Number of elements in the array
+ * @param   key   Identifier to compare with
+ * @param   mask  Output bitmask, must hold (n + 63) / 64 words
+ * @return        Number of matching elements
+ */
+QUID_LIB_API size_t quid_eq_mask(const quid128_t *arr, size_t n, const quid128_t *key, uint64_t *mask) {
+    size_t count = 0;
+
+    if (!arr || !key || !mask) { return 0; }
+
+    for (size_t base = 0; base < n; base += SCAN_BATCH) {
+        size_t len = (n - base < SCAN_BATCH) ? n - base : SCAN_BATCH;
+
+        mask[base / SCAN_BATCH] = scan_mask(&arr[base], len, key);
+        count += (size_t)bit_popcount64(mask[base / SCAN_BATCH]);
+    }
+
+    return count;
+}
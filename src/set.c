@@ -0,0 +1,473 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Open addressing hash set and hash map keyed by identifier. The
+ * table follows the layout of SwissTable: every slot has a control
+ * byte holding either a marker or 7 bits of the hash, and groups of
+ * 16 control bytes are probed at once. Keys are kept in their packed
+ * 16 byte representation.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <quid.h>
+
+#include "bits.h"
+
+#define GROUP_WIDTH     16                  /* Slots per probe group */
+#define CTRL_EMPTY      ((int8_t)-128)      /* Slot never used */
+#define CTRL_DELETED    ((int8_t)-2)        /* Slot used before, probe on */
+#define MIN_CAPACITY    GROUP_WIDTH         /* Smallest table */
+#define SLOT_NONE       ((size_t)-1)
+
+/**
+ * Table shared by set and map. Values are only
+ * allocated for maps.
+ */
+typedef struct {
+    int8_t      *ctrl;          /* Control byte per slot */
+    quid128_t   *keys;          /* Packed keys */
+    void        **values;       /* Values per slot, NULL for sets */
+    size_t      capacity;       /* Number of slots, power of two */
+    size_t      size;           /* Number of live entries */
+    size_t      growth;         /* Empty slots left to claim before rehash */
+} table_t;
+
+struct quid_set {
+    table_t table;
+};
+
+struct quid_map {
+    table_t table;
+};
+
+/* Match control bytes in group against value */
+static inline uint32_t group_match(const int8_t *ctrl, int8_t h2) {
+#ifdef HAS_SSE2
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(h2)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < GROUP_WIDTH; ++i) {
+        mask |= (uint32_t)(ctrl[i] == h2) << i;
+    }
+    return mask;
+#endif
+}
+
+/* Match empty or deleted slots in group */
+static inline uint32_t group_match_free(const int8_t *ctrl) {
+#ifdef HAS_SSE2
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < GROUP_WIDTH; ++i) {
+        mask |= (uint32_t)(ctrl[i] < 0) << i;
+    }
+    return mask;
+#endif
+}
+
+/* Usable slots for capacity, keeps load factor under 7/8 */
+static inline size_t table_max_load(size_t capacity) {
+    return capacity - capacity / 8;
+}
+
+static int table_init(table_t *t, size_t hint, int with_values) {
+    size_t capacity = MIN_CAPACITY;
+
+    while (table_max_load(capacity) < hint) {
+        capacity <<= 1;
+    }
+
+    t->ctrl = malloc(capacity);
+    t->keys = malloc(capacity * sizeof(quid128_t));
+    t->values = with_values ? malloc(capacity * sizeof(void *)) : NULL;
+    if (!t->ctrl || !t->keys || (with_values && !t->values)) {
+        free(t->ctrl);
+        free(t->keys);
+        free(t->values);
+        return 0;
+    }
+
+    memset(t->ctrl, CTRL_EMPTY, capacity);
+    t->capacity = capacity;
+    t->size = 0;
+    t->growth = table_max_load(capacity);
+    return 1;
+}
+
+static void table_release(table_t *t) {
+    free(t->ctrl);
+    free(t->keys);
+    free(t->values);
+}
+
+static void table_clear(table_t *t) {
+    memset(t->ctrl, CTRL_EMPTY, t->capacity);
+    t->size = 0;
+    t->growth = table_max_load(t->capacity);
+}
+
+/**
+ * Find slot holding key. Groups are visited in triangular
+ * order which covers every group once for power of two tables.
+ *
+ * @return  Slot index or SLOT_NONE if key is not present
+ */
+static size_t table_find(const table_t *t, const quid128_t *key, uint64_t hash) {
+    size_t mask = t->capacity / GROUP_WIDTH - 1;
+    size_t group = (size_t)(hash >> 7) & mask;
+    int8_t h2 = (int8_t)(hash & 0x7f);
+
+    for (size_t step = 1;; ++step) {
+        const int8_t *ctrl = t->ctrl + group * GROUP_WIDTH;
+        uint32_t match = group_match(ctrl, h2);
+
+        while (match) {
+            size_t slot = group * GROUP_WIDTH + bit_ctz32(match);
+            if (t->keys[slot].hi == key->hi && t->keys[slot].lo == key->lo) {
+                return slot;
+            }
+            match &= match - 1;
+        }
+
+        if (group_match(ctrl, CTRL_EMPTY)) {
+            return SLOT_NONE;
+        }
+
+        group = (group + step) & mask;
+    }
+}
+
+/* Find first free slot on the probe sequence */
+static size_t table_find_free(const table_t *t, uint64_t hash) {
+    size_t mask = t->capacity / GROUP_WIDTH - 1;
+    size_t group = (size_t)(hash >> 7) & mask;
+
+    for (size_t step = 1;; ++step) {
+        uint32_t match = group_match_free(t->ctrl + group * GROUP_WIDTH);
+        if (match) {
+            return group * GROUP_WIDTH + bit_ctz32(match);
+        }
+
+        group = (group + step) & mask;
+    }
+}
+
+/* Rebuild table, doubles capacity unless most claimed slots are tombstones */
+static int table_rehash(table_t *t) {
+    table_t n;
+    size_t capacity = t->capacity;
+
+    if (t->size >= table_max_load(capacity) / 2) {
+        capacity <<= 1;
+    }
+
+    if (!table_init(&n, table_max_load(capacity), t->values != NULL)) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < t->capacity; ++i) {
+        if (t->ctrl[i] < 0) {
+            continue;
+        }
+
+        uint64_t hash = quid_hash128(&t->keys[i]);
+        size_t slot = table_find_free(&n, hash);
+        n.ctrl[slot] = (int8_t)(hash & 0x7f);
+        n.keys[slot] = t->keys[i];
+        if (n.values) {
+            n.values[slot] = t->values[i];
+        }
+    }
+
+    n.size = t->size;
+    n.growth -= t->size;
+
+    table_release(t);
+    *t = n;
+    return 1;
+}
+
+/**
+ * Insert key into table if not present.
+ *
+ * @param   slot  Slot of the key, new or existing
+ * @return        QUID_OK if inserted, QUID_EXISTS if present
+ */
+static cresult table_insert(table_t *t, const quid128_t *key, size_t *slot) {
+    uint64_t hash = quid_hash128(key);
+
+    *slot = table_find(t, key, hash);
+    if (*slot != SLOT_NONE) {
+        return QUID_EXISTS;
+    }
+
+    *slot = table_find_free(t, hash);
+    if (t->ctrl[*slot] == CTRL_EMPTY && !t->growth) {
+        if (!table_rehash(t)) {
+            return QUID_ERROR;
+        }
+        *slot = table_find_free(t, hash);
+    }
+
+    if (t->ctrl[*slot] == CTRL_EMPTY) {
+        t->growth--;
+    }
+
+    t->ctrl[*slot] = (int8_t)(hash & 0x7f);
+    t->keys[*slot] = *key;
+    t->size++;
+    return QUID_OK;
+}
+
+/* Remove key from table */
+static cresult table_erase(table_t *t, const quid128_t *key) {
+    size_t slot = table_find(t, key, quid_hash128(key));
+    if (slot == SLOT_NONE) {
+        return QUID_ERROR;
+    }
+
+    /**
+     * Probes only continue past groups without empty slots. If this group
+     * has an empty slot the entry can be released, otherwise a tombstone
+     * is left behind to keep the probe sequence intact.
+     */
+    if (group_match(t->ctrl + (slot & ~(size_t)(GROUP_WIDTH - 1)), CTRL_EMPTY)) {
+        t->ctrl[slot] = CTRL_EMPTY;
+        t->growth++;
+    } else {
+        t->ctrl[slot] = CTRL_DELETED;
+    }
+
+    t->size--;
+    return QUID_OK;
+}
+
+/**
+ * Create new set. The set is sized to hold at least
+ * the number of hinted elements without rehashing.
+ *
+ * @param   hint  Expected number of elements
+ * @return        New set or NULL on faillure
+ */
+QUID_LIB_API quid_set_t *quid_set_new(size_t hint) {
+    quid_set_t *set = malloc(sizeof(quid_set_t));
+    if (!set) {
+        return NULL;
+    }
+
+    if (!table_init(&set->table, hint, 0)) {
+        free(set);
+        return NULL;
+    }
+
+    return set;
+}
+
+/* Release set */
+QUID_LIB_API void quid_set_free(quid_set_t *set) {
+    if (!set) { return; }
+
+    table_release(&set->table);
+    free(set);
+}
+
+/* Remove all elements, keeps the allocated capacity */
+QUID_LIB_API void quid_set_clear(quid_set_t *set) {
+    assert(set);
+    table_clear(&set->table);
+}
+
+/* Number of elements in set */
+QUID_LIB_API size_t quid_set_size(const quid_set_t *set) {
+    assert(set);
+    return set->table.size;
+}
+
+/**
+ * Insert identifier into set.
+ *
+ * @param   set    Set to insert into
+ * @param   cuuid  Identifier to insert
+ * @return         QUID_OK if inserted, QUID_EXISTS if already present
+ */
+QUID_LIB_API cresult quid_set_insert(quid_set_t *set, const cuuid_t *cuuid) {
+    quid128_t key;
+    size_t slot;
+
+    if (!set || !cuuid) { return QUID_INVALID_PARAM; }
+
+    quid_pack(cuuid, &key);
+    return table_insert(&set->table, &key, &slot);
+}
+
+/**
+ * Check if identifier is part of set.
+ *
+ * @param   set    Set to search
+ * @param   cuuid  Identifier to find
+ * @return         QUID_OK if found, QUID_ERROR otherwise
+ */
+QUID_LIB_API cresult quid_set_contains(const quid_set_t *set, const cuuid_t *cuuid) {
+    quid128_t key;
+
+    if (!set || !cuuid) { return QUID_INVALID_PARAM; }
+
+    quid_pack(cuuid, &key);
+    return table_find(&set->table, &key, quid_hash128(&key)) != SLOT_NONE ? QUID_OK : QUID_ERROR;
+}
+
+/**
+ * Remove identifier from set.
+ *
+ * @param   set    Set to remove from
+ * @param   cuuid  Identifier to remove
+ * @return         QUID_OK if removed, QUID_ERROR if not found
+ */
+QUID_LIB_API cresult quid_set_erase(quid_set_t *set, const cuuid_t *cuuid) {
+    quid128_t key;
+
+    if (!set || !cuuid) { return QUID_INVALID_PARAM; }
+
+    quid_pack(cuuid, &key);
+    return table_erase(&set->table, &key);
+}
+
+/**
+ * Create new map. The map is sized to hold at least
+ * the number of hinted elements without rehashing.
+ *
+ * @param   hint  Expected number of elements
+ * @return        New map or NULL on faillure
+ */
+QUID_LIB_API quid_map_t *quid_map_new(size_t hint) {
+    quid_map_t *map = malloc(sizeof(quid_map_t));
+    if (!map) {
+        return NULL;
+    }
+
+    if (!table_init(&map->table, hint, 1)) {
+        free(map);
+        return NULL;
+    }
+
+    return map;
+}
+
+/* Release map, the values are owned by the caller */
+QUID_LIB_API void quid_map_free(quid_map_t *map) {
+    if (!map) { return; }
+
+    table_release(&map->table);
+    free(map);
+}
+
+/* Remove all elements, keeps the allocated capacity */
+QUID_LIB_API void quid_map_clear(quid_map_t *map) {
+    assert(map);
+    table_clear(&map->table);
+}
+
+/* Number of elements in map */
+QUID_LIB_API size_t quid_map_size(const quid_map_t *map) {
+    assert(map);
+    return map->table.size;
+}
+
+/**
+ * Insert or replace value for identifier.
+ *
+ * @param   map    Map to insert into
+ * @param   cuuid  Identifier as key
+ * @param   value  Value to store, owned by the caller
+ * @return         QUID_OK if inserted, QUID_EXISTS if the value was replaced
+ */
+QUID_LIB_API cresult quid_map_put(quid_map_t *map, const cuuid_t *cuuid, void *value) {
+    quid128_t key;
+    size_t slot;
+    cresult rs;
+
+    if (!map || !cuuid) { return QUID_INVALID_PARAM; }
+
+    quid_pack(cuuid, &key);
+    rs = table_insert(&map->table, &key, &slot);
+    if (rs == QUID_OK || rs == QUID_EXISTS) {
+        map->table.values[slot] = value;
+    }
+
+    return rs;
+}
+
+/**
+ * Retrieve value for identifier.
+ *
+ * @param   map    Map to search
+ * @param   cuuid  Identifier as key
+ * @param   value  Output value, untouched if not found
+ * @return         QUID_OK if found, QUID_ERROR otherwise
+ */
+QUID_LIB_API cresult quid_map_get(const quid_map_t *map, const cuuid_t *cuuid, void **value) {
+    quid128_t key;
+    size_t slot;
+
+    if (!map || !cuuid) { return QUID_INVALID_PARAM; }
+
+    quid_pack(cuuid, &key);
+    slot = table_find(&map->table, &key, quid_hash128(&key));
+    if (slot == SLOT_NONE) {
+        return QUID_ERROR;
+    }
+
+    if (value) {
+        *value = map->table.values[slot];
+    }
+
+    return QUID_OK;
+}
+
+/**
+ * Remove identifier from map.
+ *
+ * @param   map    Map to remove from
+ * @param   cuuid  Identifier as key
+ * @return         QUID_OK if removed, QUID_ERROR if not found
+ */
+QUID_LIB_API cresult quid_map_erase(quid_map_t *map, const cuuid_t *cuuid) {
+    quid128_t key;
+
+    if (!map || !cuuid) { return QUID_INVALID_PARAM; }
+
+    quid_pack(cuuid, &key);
+    return table_erase(&map->table, &key);
+}
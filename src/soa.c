@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Identifiers stored column wise. The fields of cuuid_t are kept in
+ * parallel arrays of their natural width, each column aligned to a
+ * cache line. The bulk kernels below read only the columns they need
+ * and their loops are free of branches, so the compiler can vectorize
+ * them. Results match the kernels operating on cuuid_t arrays.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include <quid.h>
+
+#include "bits.h"
+
+#define SOA_ALIGN       64              /* Column alignment */
+#define SOA_BLOCK       256             /* Rows processed at once */
+
+static inline size_t align_up(size_t size) {
+    return (size + SOA_ALIGN - 1) & ~(size_t)(SOA_ALIGN - 1);
+}
+
+/* Timestamp in ticks of row */
+static inline uint64_t soa_ticks(const quid_soa_t *soa, size_t i) {
+    return (uint64_t)soa->time_low[i]
+        | (uint64_t)soa->time_mid[i] << 32
+        | (uint64_t)((soa->time_hi_and_version[i] ^ QUIDMAGIC) & 0x0fff) << 48;
+}
+
+/* Packed identifier of row, see quid_pack */
+static inline void soa_pack(const quid_soa_t *soa, size_t i, quid128_t *key) {
+    const uint8_t *node = &soa->node[i * 6];
+
+    key->hi = soa_ticks(soa, i) << 4 | (uint64_t)(soa->time_hi_and_version[i] >> 12);
+    key->lo = (uint64_t)soa->clock_seq[i] << 48
+        | (uint64_t)node[0] << 40
+        | (uint64_t)node[1] << 32
+        | (uint64_t)node[2] << 24
+        | (uint64_t)node[3] << 16
+        | (uint64_t)node[4] << 8
+        | (uint64_t)node[5];
+}
+
+/**
+ * Allocate columns for a number of rows.
+ *
+ * @param   soa       Container to initialize
+ * @param   capacity  Number of rows
+ * @return            QUID_OK on success, QUID_ERROR on allocation faillure
+ */
+QUID_LIB_API cresult quid_soa_init(quid_soa_t *soa, size_t capacity) {
+    size_t length;
+    uint8_t *base;
+
+    if (!soa) { return QUID_INVALID_PARAM; }
+
+    memset(soa, 0, sizeof(quid_soa_t));
+    if (!capacity) {
+        capacity = 1;
+    }
+
+    length = align_up(capacity * sizeof(uint32_t))
+        + 3 * align_up(capacity * sizeof(uint16_t))
+        + align_up(capacity * 6);
+
+    soa->alloc = malloc(length + SOA_ALIGN);
+    if (!soa->alloc) {
+        return QUID_ERROR;
+    }
+
+    base = (uint8_t *)(((uintptr_t)soa->alloc + SOA_ALIGN - 1) & ~(uintptr_t)(SOA_ALIGN - 1));
+    soa->time_low = (uint32_t *)base;
+    base += align_up(capacity * sizeof(uint32_t));
+    soa->time_mid = (uint16_t *)base;
+    base += align_up(capacity * sizeof(uint16_t));
+    soa->time_hi_and_version = (uint16_t *)base;
+    base += align_up(capacity * sizeof(uint16_t));
+    soa->clock_seq = (uint16_t *)base;
+    base += align_up(capacity * sizeof(uint16_t));
+    soa->node = base;
+    soa->capacity = capacity;
+
+    return QUID_OK;
+}
+
+/* Release columns */
+QUID_LIB_API void quid_soa_free(quid_soa_t *soa) {
+    if (!soa) { return; }
+
+    free(soa->alloc);
+    memset(soa, 0, sizeof(quid_soa_t));
+}
+
+/**
+ * Load identifiers into container, replacing its contents. The
+ * columns grow when needed.
+ *
+ * @param   soa    Container
+ * @param   cuuid  Array of quid structures
+ * @param   n      Number of elements in the array
+ * @return         QUID_OK on success, QUID_ERROR on allocation faillure
+ */
+QUID_LIB_API cresult quid_soa_load(quid_soa_t *soa, const cuuid_t *cuuid, size_t n) {
+    if (!soa || (!cuuid && n)) { return QUID_INVALID_PARAM; }
+
+    if (n > soa->capacity) {
+        quid_soa_free(soa);
+        if (quid_soa_init(soa, n) != QUID_OK) {
+            return QUID_ERROR;
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        soa->time_low[i] = (uint32_t)cuuid[i].time_low;
+        soa->time_mid[i] = cuuid[i].time_mid;
+        soa->time_hi_and_version[i] = cuuid[i].time_hi_and_version;
+        soa->clock_seq[i] = (uint16_t)(cuuid[i].clock_seq_hi_and_reserved << 8 | cuuid[i].clock_seq_low);
+        memcpy(&soa->node[i * 6], cuuid[i].node, 6);
+    }
+
+    soa->count = n;
+    return QUID_OK;
+}
+
+/**
+ * Store rows of container as quid structures. The internal version
+ * is derived as in quid_unpack, the tag is cleared.
+ *
+ * @param   soa    Container
+ * @param   cuuid  Output array, must hold count elements
+ * @return         QUID_OK on success
+ */
+QUID_LIB_API cresult quid_soa_store(const quid_soa_t *soa, cuuid_t *cuuid) {
+    if (!soa || (!cuuid && soa->count)) { return QUID_INVALID_PARAM; }
+
+    for (size_t i = 0; i < soa->count; ++i) {
+        quid128_t key;
+
+        soa_pack(soa, i, &key);
+        quid_unpack(&key, &cuuid[i]);
+    }
+
+    return QUID_OK;
+}
+
+/* Timestamps as nanoseconds since epoch, see quid_epoch_ns_bulk */
+QUID_LIB_API cresult quid_soa_epoch_ns(const quid_soa_t *soa, int64_t *out) {
+    if (!soa || (!out && soa->count)) { return QUID_INVALID_PARAM; }
+
+    const uint32_t *time_low = soa->time_low;
+    const uint16_t *time_mid = soa->time_mid;
+    const uint16_t *time_hi_and_version = soa->time_hi_and_version;
+    size_t n = soa->count;
+
+    /* Load column pointers once, stores to out could alias the container */
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = (int64_t)((uint64_t)time_low[i]
+            | (uint64_t)time_mid[i] << 32
+            | (uint64_t)((time_hi_and_version[i] ^ QUIDMAGIC) & 0x0fff) << 48) * NS_PER_TICK;
+    }
+
+    return QUID_OK;
+}
+
+/* Select rows with a timestamp in range [t0, t1), see quid_filter_time */
+QUID_LIB_API size_t quid_soa_filter_time(const quid_soa_t *soa, int64_t t0, int64_t t1, uint32_t *sel) {
+    uint64_t ticks[SOA_BLOCK];
+    uint64_t lower = ns_to_ticks(t0);
+    uint64_t upper = ns_to_ticks(t1);
+    size_t count = 0;
+
+    if (!soa || !sel) { return 0; }
+
+    for (size_t base = 0; base < soa->count; base += SOA_BLOCK) {
+        size_t len = (soa->count - base < SOA_BLOCK) ? soa->count - base : SOA_BLOCK;
+
+        for (size_t i = 0; i < len; ++i) {
+            ticks[i] = soa_ticks(soa, base + i);
+        }
+
+        for (size_t i = 0; i < len; ++i) {
+            sel[count] = (uint32_t)(base + i);
+            count += (ticks[i] >= lower) & (ticks[i] < upper);
+        }
+    }
+
+    return count;
+}
+
+/* Hash of every row, see quid_hash */
+QUID_LIB_API cresult quid_soa_hash(const quid_soa_t *soa, uint64_t *out) {
+    if (!soa || (!out && soa->count)) { return QUID_INVALID_PARAM; }
+
+    for (size_t i = 0; i < soa->count; ++i) {
+        quid128_t key;
+
+        soa_pack(soa, i, &key);
+        out[i] = quid_hash128(&key);
+    }
+
+    return QUID_OK;
+}
+
+/**
+ * Order every row against identifier, see quid_order.
+ *
+ * @param   soa    Container
+ * @param   cuuid  Identifier to compare with
+ * @param   out    Output order of each row, must hold count elements
+ * @return         QUID_OK on success
+ */
+QUID_LIB_API cresult quid_soa_order(const quid_soa_t *soa, const cuuid_t *cuuid, int *out) {
+    quid128_t ref;
+
+    if (!soa || !cuuid || (!out && soa->count)) { return QUID_INVALID_PARAM; }
+
+    quid_pack(cuuid, &ref);
+    for (size_t i = 0; i < soa->count; ++i) {
+        quid128_t key;
+
+        soa_pack(soa, i, &key);
+        out[i] = 2 * ((key.hi > ref.hi) - (key.hi < ref.hi)) + ((key.lo > ref.lo) - (key.lo < ref.lo));
+    }
+
+    return QUID_OK;
+}
+
+/* Decode attributes of every row, see quid_decode_bulk */
+QUID_LIB_API cresult quid_soa_decode(const quid_soa_t *soa, quid_attr_t *attr) {
+    cuuid_t rows[SOA_BLOCK];
+
+    if (!soa || (!attr && soa->count)) { return QUID_INVALID_PARAM; }
+
+    for (size_t base = 0; base < soa->count; base += SOA_BLOCK) {
+        size_t len = (soa->count - base < SOA_BLOCK) ? soa->count - base : SOA_BLOCK;
+
+        for (size_t i = 0; i < len; ++i) {
+            quid128_t key;
+
+            soa_pack(soa, base + i, &key);
+            quid_unpack(&key, &rows[i]);
+        }
+
+        quid_decode_bulk(rows, len, &attr[base]);
+    }
+
+    return QUID_OK;
+}
@@ -0,0 +1,383 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Sorting of identifier arrays. Identifiers are packed into their
+ * 16 byte representation and sorted with a least significant digit
+ * radix sort on 8 bit digits. Passes in which all keys share the same
+ * digit, which is common for the time ordered upper bits, are skipped.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <quid.h>
+
+#include "thread.h"
+
+#define RADIX_BITS      8                   /* Bits per digit */
+#define RADIX_SIZE      (1 << RADIX_BITS)   /* Buckets per pass */
+#define RADIX_PASSES    16                  /* Digits per packed identifier */
+#define SORT_INSERTION  32                  /* Insertion sort below this count */
+#define SORT_MT_CHUNK   65536               /* Minimum elements per thread */
+#define SORT_MT_MAX     64                  /* Maximum number of threads */
+
+enum {
+    SORT_COUNT_ALL,
+    SORT_COUNT,
+    SORT_SCATTER,
+};
+
+/**
+ * Worker state for the multi-threaded sort. Each worker
+ * owns a contiguous chunk of the source array.
+ */
+typedef struct {
+    const quid128_t *src;
+    quid128_t       *dst;
+    size_t          begin;
+    size_t          end;
+    int             pass;
+    int             mode;
+    size_t          count[RADIX_PASSES][RADIX_SIZE];
+} sort_worker_t;
+
+/* Extract digit for pass, least significant first */
+static inline uint8_t radix_digit(const quid128_t *key, int pass) {
+    return (pass < 8) ? (uint8_t)(key->lo >> (pass * RADIX_BITS))
+                      : (uint8_t)(key->hi >> ((pass - 8) * RADIX_BITS));
+}
+
+/* Sort small arrays in place */
+static void insertion_sort(quid128_t *keys, size_t n) {
+    for (size_t i = 1; i < n; ++i) {
+        quid128_t key = keys[i];
+        size_t j = i;
+        while (j > 0 && quid_order128(&keys[j - 1], &key) > 0) {
+            keys[j] = keys[j - 1];
+            j--;
+        }
+        keys[j] = key;
+    }
+}
+
+/* Check if all keys fall in the same bucket */
+static int radix_trivial(size_t count[RADIX_SIZE], size_t n) {
+    for (int d = 0; d < RADIX_SIZE; ++d) {
+        if (count[d]) {
+            return count[d] == n;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Single threaded radix sort. The histograms for all passes are
+ * collected in a single sweep over the input.
+ *
+ * @param   keys     Keys to sort, result is written back
+ * @param   scratch  Scratch space of at least n elements
+ * @param   n        Number of keys
+ * @return           QUID_OK on success
+ */
+static cresult radix_sort(quid128_t *keys, quid128_t *scratch, size_t n) {
+    size_t (*count)[RADIX_SIZE] = calloc(RADIX_PASSES, sizeof(*count));
+    quid128_t *src = keys, *dst = scratch;
+
+    if (!count) {
+        return QUID_ERROR;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        for (int p = 0; p < RADIX_PASSES; ++p) {
+            count[p][radix_digit(&src[i], p)]++;
+        }
+    }
+
+    for (int p = 0; p < RADIX_PASSES; ++p) {
+        size_t offset = 0;
+
+        if (radix_trivial(count[p], n)) {
+            continue;
+        }
+
+        for (int d = 0; d < RADIX_SIZE; ++d) {
+            size_t c = count[p][d];
+            count[p][d] = offset;
+            offset += c;
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            dst[count[p][radix_digit(&src[i], p)]++] = src[i];
+        }
+
+        quid128_t *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != keys) {
+        memcpy(keys, src, n * sizeof(quid128_t));
+    }
+
+    free(count);
+    return QUID_OK;
+}
+
+/* Run one phase of the sort on the worker chunk */
+QTHREAD_ROUTINE(sort_worker_run, arg) {
+    sort_worker_t *w = (sort_worker_t *)arg;
+
+    switch (w->mode) {
+        case SORT_COUNT_ALL:
+            for (size_t i = w->begin; i < w->end; ++i) {
+                for (int p = 0; p < RADIX_PASSES; ++p) {
+                    w->count[p][radix_digit(&w->src[i], p)]++;
+                }
+            }
+            break;
+        case SORT_COUNT:
+            memset(w->count[w->pass], 0, sizeof(w->count[w->pass]));
+            for (size_t i = w->begin; i < w->end; ++i) {
+                w->count[w->pass][radix_digit(&w->src[i], w->pass)]++;
+            }
+            break;
+        case SORT_SCATTER:
+            for (size_t i = w->begin; i < w->end; ++i) {
+                w->dst[w->count[w->pass][radix_digit(&w->src[i], w->pass)]++] = w->src[i];
+            }
+            break;
+    }
+
+    QTHREAD_RETURN();
+}
+
+/**
+ * Run phase on all workers. The first worker runs on the calling
+ * thread. Workers that could not be started are run inline as well.
+ */
+static void sort_phase(sort_worker_t *workers, unsigned int nthreads, int mode, int pass) {
+    qthread_t threads[SORT_MT_MAX];
+    int started[SORT_MT_MAX];
+
+    for (unsigned int t = 0; t < nthreads; ++t) {
+        workers[t].mode = mode;
+        workers[t].pass = pass;
+    }
+
+    for (unsigned int t = 1; t < nthreads; ++t) {
+        started[t] = qthread_create(&threads[t], sort_worker_run, &workers[t]) == 0;
+        if (!started[t]) {
+            sort_worker_run(&workers[t]);
+        }
+    }
+
+    sort_worker_run(&workers[0]);
+
+    for (unsigned int t = 1; t < nthreads; ++t) {
+        if (started[t]) {
+            qthread_join(threads[t]);
+        }
+    }
+}
+
+/**
+ * Multi threaded radix sort. Every pass counts the digits per chunk
+ * in parallel, computes the output offset of every chunk per bucket
+ * and lets all chunks scatter in parallel. Stability is preserved
+ * since chunks are laid out in order within each bucket.
+ *
+ * @param   keys      Keys to sort, result is written back
+ * @param   scratch   Scratch space of at least n elements
+ * @param   n         Number of keys
+ * @param   nthreads  Number of threads
+ * @return            QUID_OK on success
+ */
+static cresult radix_sort_mt(quid128_t *keys, quid128_t *scratch, size_t n, unsigned int nthreads) {
+    sort_worker_t *workers = calloc(nthreads, sizeof(sort_worker_t));
+    size_t total[RADIX_PASSES][RADIX_SIZE];
+    quid128_t *src = keys, *dst = scratch;
+    int counted = 1;
+
+    if (!workers) {
+        return QUID_ERROR;
+    }
+
+    for (unsigned int t = 0; t < nthreads; ++t) {
+        workers[t].begin = (n / nthreads) * t;
+        workers[t].end = (t == nthreads - 1) ? n : (n / nthreads) * (t + 1);
+    }
+
+    /* Global histogram, also valid as chunk histogram for the first pass */
+    for (unsigned int t = 0; t < nthreads; ++t) {
+        workers[t].src = src;
+    }
+    sort_phase(workers, nthreads, SORT_COUNT_ALL, 0);
+
+    memset(total, 0, sizeof(total));
+    for (unsigned int t = 0; t < nthreads; ++t) {
+        for (int p = 0; p < RADIX_PASSES; ++p) {
+            for (int d = 0; d < RADIX_SIZE; ++d) {
+                total[p][d] += workers[t].count[p][d];
+            }
+        }
+    }
+
+    for (int p = 0; p < RADIX_PASSES; ++p) {
+        size_t offset = 0;
+
+        if (radix_trivial(total[p], n)) {
+            continue;
+        }
+
+        for (unsigned int t = 0; t < nthreads; ++t) {
+            workers[t].src = src;
+            workers[t].dst = dst;
+        }
+
+        if (!counted) {
+            sort_phase(workers, nthreads, SORT_COUNT, p);
+        }
+        counted = 0;
+
+        for (int d = 0; d < RADIX_SIZE; ++d) {
+            for (unsigned int t = 0; t < nthreads; ++t) {
+                size_t c = workers[t].count[p][d];
+                workers[t].count[p][d] = offset;
+                offset += c;
+            }
+        }
+
+        sort_phase(workers, nthreads, SORT_SCATTER, p);
+
+        quid128_t *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != keys) {
+        memcpy(keys, src, n * sizeof(quid128_t));
+    }
+
+    free(workers);
+    return QUID_OK;
+}
+
+/**
+ * Sort packed identifiers in ascending order. If nthreads is larger
+ * than one the sort is spread over at most nthreads threads, small
+ * arrays are always sorted on the calling thread.
+ *
+ * @param   keys      Array of packed identifiers
+ * @param   n         Number of elements in the array
+ * @param   nthreads  Maximum number of threads
+ * @return            QUID_OK on success
+ */
+QUID_LIB_API cresult quid_sort128_mt(quid128_t *keys, size_t n, unsigned int nthreads) {
+    quid128_t *scratch;
+    cresult rs = QUID_OK;
+
+    if (n < 2) { return QUID_OK; }
+    if (!keys) { return QUID_INVALID_PARAM; }
+
+    if (n <= SORT_INSERTION) {
+        insertion_sort(keys, n);
+        return QUID_OK;
+    }
+
+    scratch = malloc(n * sizeof(quid128_t));
+    if (!scratch) {
+        return QUID_ERROR;
+    }
+
+    if (nthreads > n / SORT_MT_CHUNK) {
+        nthreads = (unsigned int)(n / SORT_MT_CHUNK);
+    }
+    if (nthreads > SORT_MT_MAX) {
+        nthreads = SORT_MT_MAX;
+    }
+
+    if (nthreads > 1) {
+        rs = radix_sort_mt(keys, scratch, n, nthreads);
+    } else {
+        rs = radix_sort(keys, scratch, n);
+    }
+
+    free(scratch);
+    return rs;
+}
+
+/* Sort packed identifiers in ascending order */
+QUID_LIB_API cresult quid_sort128(quid128_t *keys, size_t n) {
+    return quid_sort128_mt(keys, n, 1);
+}
+
+/**
+ * Sort quid structures in ascending order, see quid_order. The
+ * structures are rebuilt from their packed representation, as such
+ * the internal version is derived and the user tag is cleared.
+ *
+ * @param   cuuid     Array of quid structures
+ * @param   n         Number of elements in the array
+ * @param   nthreads  Maximum number of threads
+ * @return            QUID_OK on success
+ */
+QUID_LIB_API cresult quid_sort_mt(cuuid_t *cuuid, size_t n, unsigned int nthreads) {
+    quid128_t *keys;
+    cresult rs;
+
+    if (n < 2) { return QUID_OK; }
+    if (!cuuid) { return QUID_INVALID_PARAM; }
+
+    keys = malloc(n * sizeof(quid128_t));
+    if (!keys) {
+        return QUID_ERROR;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        quid_pack(&cuuid[i], &keys[i]);
+    }
+
+    rs = quid_sort128_mt(keys, n, nthreads);
+    if (rs == QUID_OK) {
+        for (size_t i = 0; i < n; ++i) {
+            quid_unpack(&keys[i], &cuuid[i]);
+        }
+    }
+
+    free(keys);
+    return rs;
+}
+
+/* Sort quid structures in ascending order */
+QUID_LIB_API cresult quid_sort(cuuid_t *cuuid, size_t n) {
+    return quid_sort_mt(cuuid, n, 1);
+}
@@ -0,0 +1,457 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Columnar identifier stream. A stream starts with a file header and
+ * is followed by blocks of up to STREAM_BLOCK identifiers. Every block
+ * header records the row count, payload length and the smallest and
+ * largest timestamp so readers can skip blocks outside a time range
+ * without decoding them. The payload stores each field as a column:
+ *
+ *   timestamps   first value as varint, then zigzag varint deltas
+ *   versions     4 bit version nibbles, two per byte
+ *   clock/node   8 raw bytes per row, the node is already encrypted
+ *
+ * All integers are little endian.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <quid.h>
+
+#include "bits.h"
+
+#define STREAM_MAGIC    0x52545351      /* "QSTR" */
+#define STREAM_FORMAT   1               /* Stream format version */
+#define STREAM_BLOCK    4096            /* Rows per block */
+#define STREAM_HEADER   16              /* File header size */
+#define BLOCK_HEADER    24              /* Block header size */
+#define VARINT_MAX      10              /* Longest 64 bit varint */
+
+/* Largest possible payload for block */
+#define BLOCK_PAYLOAD(n) ((n) * (VARINT_MAX + 8) + ((n) + 1) / 2)
+
+struct quid_writer {
+    FILE        *fp;
+    size_t      count;                  /* Rows in pending block */
+    cresult     status;                 /* Sticky write failure */
+    quid128_t   rows[STREAM_BLOCK];
+    uint8_t     buffer[BLOCK_HEADER + BLOCK_PAYLOAD(STREAM_BLOCK)];
+};
+
+struct quid_reader {
+    FILE        *fp;
+    uint64_t    lower;                  /* First tick in range */
+    uint64_t    upper;                  /* First tick after range */
+    size_t      count;                  /* Rows in current block */
+    size_t      cursor;                 /* Next row in current block */
+    cresult     status;                 /* Sticky read or decode failure */
+    quid128_t   rows[STREAM_BLOCK];
+    uint8_t     buffer[BLOCK_PAYLOAD(STREAM_BLOCK)];
+};
+
+static inline void put_u32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static inline void put_u64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static inline uint32_t get_u32(const uint8_t *p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; --i) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+static inline uint64_t get_u64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+static inline size_t put_varint(uint8_t *p, uint64_t v) {
+    size_t n = 0;
+
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+
+    return n;
+}
+
+/* Decode varint, returns zero on malformed input */
+static inline size_t get_varint(const uint8_t *p, const uint8_t *end, uint64_t *v) {
+    size_t n = 0;
+    unsigned shift = 0;
+
+    *v = 0;
+    while (p + n < end && shift < 64) {
+        uint8_t b = p[n++];
+        *v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return n;
+        }
+        shift += 7;
+    }
+
+    return 0;
+}
+
+static inline uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/* Encode and write pending rows as one block */
+static cresult writer_flush(quid_writer_t *writer) {
+    uint8_t *p = writer->buffer + BLOCK_HEADER;
+    uint64_t prev = 0, min = UINT64_MAX, max = 0;
+    size_t n = writer->count;
+
+    if (writer->status != QUID_OK) {
+        return writer->status;
+    }
+    if (!n) {
+        return QUID_OK;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t ticks = writer->rows[i].hi >> 4;
+
+        p += put_varint(p, i ? zigzag((int64_t)(ticks - prev)) : ticks);
+        prev = ticks;
+        min = ticks < min ? ticks : min;
+        max = ticks > max ? ticks : max;
+    }
+
+    memset(p, 0, (n + 1) / 2);
+    for (size_t i = 0; i < n; ++i) {
+        p[i / 2] |= (uint8_t)((writer->rows[i].hi & 0xf) << (4 * (i & 1)));
+    }
+    p += (n + 1) / 2;
+
+    /* Clock sequence and node in identifier byte order */
+    for (size_t i = 0; i < n; ++i) {
+        for (int j = 0; j < 8; ++j) {
+            p[j] = (uint8_t)(writer->rows[i].lo >> (56 - 8 * j));
+        }
+        p += 8;
+    }
+
+    put_u32(writer->buffer, (uint32_t)n);
+    put_u32(writer->buffer + 4, (uint32_t)(p - writer->buffer - BLOCK_HEADER));
+    put_u64(writer->buffer + 8, min);
+    put_u64(writer->buffer + 16, max);
+
+    if (fwrite(writer->buffer, 1, (size_t)(p - writer->buffer), writer->fp) != (size_t)(p - writer->buffer)) {
+        writer->status = QUID_ERROR;
+        return QUID_ERROR;
+    }
+
+    writer->count = 0;
+    return QUID_OK;
+}
+
+/**
+ * Start identifier stream on file. The file is not closed by the writer.
+ *
+ * @param   fp  File opened for binary writing
+ * @return      New writer or NULL on faillure
+ */
+QUID_LIB_API quid_writer_t *quid_writer_open(FILE *fp) {
+    quid_writer_t *writer;
+    uint8_t header[STREAM_HEADER] = {0};
+
+    if (!fp) {
+        return NULL;
+    }
+
+    writer = calloc(1, sizeof(quid_writer_t));
+    if (!writer) {
+        return NULL;
+    }
+
+    put_u32(header, STREAM_MAGIC);
+    put_u32(header + 4, STREAM_FORMAT);
+    put_u32(header + 8, STREAM_BLOCK);
+    if (fwrite(header, 1, STREAM_HEADER, fp) != STREAM_HEADER) {
+        free(writer);
+        return NULL;
+    }
+
+    writer->fp = fp;
+    writer->status = QUID_OK;
+    return writer;
+}
+
+/**
+ * Append identifiers to stream. A failed write leaves the writer in an
+ * error state in which every later put and close fails. The identifiers
+ * consumed before the failure are lost with the pending block, so part
+ * of the array may have been taken when QUID_ERROR is returned.
+ *
+ * @param   writer  Stream writer
+ * @param   cuuid   Array of quid structures
+ * @param   n       Number of elements in the array
+ * @return          QUID_OK on success, QUID_ERROR on write faillure
+ */
+QUID_LIB_API cresult quid_writer_put(quid_writer_t *writer, const cuuid_t *cuuid, size_t n) {
+    if (!writer || (!cuuid && n)) { return QUID_INVALID_PARAM; }
+    if (writer->status != QUID_OK) { return writer->status; }
+
+    for (size_t i = 0; i < n; ++i) {
+        quid_pack(&cuuid[i], &writer->rows[writer->count++]);
+        if (writer->count == STREAM_BLOCK && writer_flush(writer) != QUID_OK) {
+            return QUID_ERROR;
+        }
+    }
+
+    return QUID_OK;
+}
+
+/**
+ * Write pending identifiers and release writer. The writer is released
+ * even when an earlier or the final write failed.
+ *
+ * @param   writer  Stream writer
+ * @return          QUID_OK on success, QUID_ERROR on write faillure
+ */
+QUID_LIB_API cresult quid_writer_close(quid_writer_t *writer) {
+    cresult rs;
+
+    if (!writer) { return QUID_INVALID_PARAM; }
+
+    rs = writer_flush(writer);
+    if (rs == QUID_OK && fflush(writer->fp)) {
+        rs = QUID_ERROR;
+    }
+
+    free(writer);
+    return rs;
+}
+
+/**
+ * Open identifier stream for reading. The file is not closed by the reader.
+ *
+ * @param   fp  File opened for binary reading
+ * @return      New reader or NULL if the stream is invalid
+ */
+QUID_LIB_API quid_reader_t *quid_reader_open(FILE *fp) {
+    quid_reader_t *reader;
+    uint8_t header[STREAM_HEADER];
+
+    if (!fp) {
+        return NULL;
+    }
+
+    if (fread(header, 1, STREAM_HEADER, fp) != STREAM_HEADER
+        || get_u32(header) != STREAM_MAGIC
+        || get_u32(header + 4) != STREAM_FORMAT
+        || get_u32(header + 8) > STREAM_BLOCK) {
+        return NULL;
+    }
+
+    reader = calloc(1, sizeof(quid_reader_t));
+    if (!reader) {
+        return NULL;
+    }
+
+    reader->fp = fp;
+    reader->upper = UINT64_MAX;
+    reader->status = QUID_OK;
+    return reader;
+}
+
+/* Release reader */
+QUID_LIB_API void quid_reader_close(quid_reader_t *reader) {
+    free(reader);
+}
+
+/**
+ * Limit reader to identifiers created in time range. Blocks outside
+ * the range are skipped without decoding.
+ *
+ * @param   reader  Stream reader
+ * @param   t0      Start of range in nanoseconds since epoch, inclusive
+ * @param   t1      End of range in nanoseconds since epoch, exclusive
+ */
+QUID_LIB_API void quid_reader_range(quid_reader_t *reader, int64_t t0, int64_t t1) {
+    if (!reader) { return; }
+
+    reader->lower = ns_to_ticks(t0);
+    reader->upper = ns_to_ticks(t1);
+}
+
+/* Record failure, truncated input is corrupt unless the read failed */
+static cresult reader_fail(quid_reader_t *reader) {
+    reader->status = ferror(reader->fp) ? QUID_ERROR : QUID_CORRUPT;
+    return QUID_ERROR;
+}
+
+/**
+ * Load next block overlapping range. Returns QUID_ERROR at the end of
+ * the stream, and on failure in which case the status is recorded.
+ */
+static cresult reader_next_block(quid_reader_t *reader) {
+    uint8_t header[BLOCK_HEADER];
+    const uint8_t *p, *end;
+    uint64_t ticks = 0, v, min, max;
+    size_t n, length, used;
+
+    for (;;) {
+        used = fread(header, 1, BLOCK_HEADER, reader->fp);
+        if (used == 0 && feof(reader->fp)) {
+            return QUID_ERROR;
+        }
+        if (used != BLOCK_HEADER) {
+            return reader_fail(reader);
+        }
+
+        n = get_u32(header);
+        length = get_u32(header + 4);
+        min = get_u64(header + 8);
+        max = get_u64(header + 16);
+        if (!n || n > STREAM_BLOCK || length > BLOCK_PAYLOAD(n) || min > max || max >= TIMESTAMP_MAX) {
+            return reader_fail(reader);
+        }
+
+        if (max >= reader->lower && min < reader->upper) {
+            break;
+        }
+
+        /* Streams that cannot seek are read past */
+        if (fseek(reader->fp, (long)length, SEEK_CUR) && fread(reader->buffer, 1, length, reader->fp) != length) {
+            return reader_fail(reader);
+        }
+    }
+
+    if (fread(reader->buffer, 1, length, reader->fp) != length) {
+        return reader_fail(reader);
+    }
+
+    /* Decoded timestamps must stay within the bounds of the header */
+    p = reader->buffer;
+    end = p + length;
+    for (size_t i = 0; i < n; ++i) {
+        used = get_varint(p, end, &v);
+        if (!used) {
+            return reader_fail(reader);
+        }
+        p += used;
+        ticks = i ? ticks + (uint64_t)unzigzag(v) : v;
+        if (ticks < min || ticks > max) {
+            return reader_fail(reader);
+        }
+        reader->rows[i].hi = ticks << 4;
+    }
+
+    if ((size_t)(end - p) != (n + 1) / 2 + n * 8) {
+        return reader_fail(reader);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        reader->rows[i].hi |= (p[i / 2] >> (4 * (i & 1))) & 0xf;
+    }
+    p += (n + 1) / 2;
+
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t lo = 0;
+        for (int j = 0; j < 8; ++j) {
+            lo = (lo << 8) | p[j];
+        }
+        reader->rows[i].lo = lo;
+        p += 8;
+    }
+
+    reader->count = n;
+    reader->cursor = 0;
+    return QUID_OK;
+}
+
+/**
+ * Read identifiers from stream. Reading stops at the end of the stream
+ * or at the first corrupt block, quid_reader_status tells them apart.
+ *
+ * @param   reader  Stream reader
+ * @param   cuuid   Output array of quid structures
+ * @param   n       Capacity of the output array
+ * @return          Number of identifiers read, zero at end of stream or on failure
+ */
+QUID_LIB_API size_t quid_reader_read(quid_reader_t *reader, cuuid_t *cuuid, size_t n) {
+    size_t count = 0;
+
+    if (!reader || !cuuid || reader->status != QUID_OK) { return 0; }
+
+    while (count < n) {
+        const quid128_t *row;
+        uint64_t ticks;
+
+        if (reader->cursor == reader->count && reader_next_block(reader) != QUID_OK) {
+            reader->count = reader->cursor = 0;
+            break;
+        }
+
+        row = &reader->rows[reader->cursor++];
+        ticks = row->hi >> 4;
+        if (ticks >= reader->lower && ticks < reader->upper) {
+            quid_unpack(row, &cuuid[count++]);
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Status of the reader, to be checked once reading returned zero.
+ *
+ * @param   reader  Stream reader
+ * @return          QUID_OK if no failure occurred, QUID_CORRUPT if the stream
+ *                  is malformed or truncated, QUID_ERROR if reading failed
+ */
+QUID_LIB_API cresult quid_reader_status(const quid_reader_t *reader) {
+    if (!reader) { return QUID_INVALID_PARAM; }
+
+    return reader->status;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __QTHREAD__
+#define __QTHREAD__
+
+#ifdef _WIN32
+# pragma once
+#endif
+
+/**
+ * Minimal threading shim over Win32 and POSIX threads. Only
+ * the primitives used by the library are provided.
+ */
+#ifdef WIN32
+# include <windows.h>
+
+typedef HANDLE qthread_t;
+typedef CRITICAL_SECTION qmutex_t;
+
+# define QTHREAD_ROUTINE(name, arg) static DWORD WINAPI name(LPVOID arg)
+# define QTHREAD_RETURN() return 0
+
+# define qthread_create(t,f,a) ((*(t) = CreateThread(NULL, 0, f, a, 0, NULL)) ? 0 : -1)
+# define qthread_join(t) (WaitForSingleObject(t, INFINITE), CloseHandle(t))
+# define qthread_yield() SwitchToThread()
+
+# define qmutex_init(m) (InitializeCriticalSection(m), 0)
+# define qmutex_lock(m) EnterCriticalSection(m)
+# define qmutex_unlock(m) LeaveCriticalSection(m)
+# define qmutex_destroy(m) DeleteCriticalSection(m)
+#else
+# include <pthread.h>
+# include <sched.h>
+
+typedef pthread_t qthread_t;
+typedef pthread_mutex_t qmutex_t;
+
+# define QTHREAD_ROUTINE(name, arg) static void *name(void *arg)
+# define QTHREAD_RETURN() return NULL
+
+# define qthread_create(t,f,a) pthread_create(t, NULL, f, a)
+# define qthread_join(t) pthread_join(t, NULL)
+# define qthread_yield() sched_yield()
+
+# define qmutex_init(m) pthread_mutex_init(m, NULL)
+# define qmutex_lock(m) pthread_mutex_lock(m)
+# define qmutex_unlock(m) pthread_mutex_unlock(m)
+# define qmutex_destroy(m) pthread_mutex_destroy(m)
+#endif
+
+#endif // __QTHREAD__
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <quid.h>
+
+#include "tinytest.h"
+#include "testutil.h"
+
+#define TC_COUNT 70000
+
+static cuuid_t tc_ids[TC_COUNT];
+static quid_attr_t tc_attr[TC_COUNT];
+static uint32_t tc_rows[TC_COUNT];
+
+static char tc_tags[3][3] = {
+    {'P', 'A', 'Y'},
+    {'A', 'U', 'T'},
+    {'L', 'O', 'G'},
+};
+
+static void generate_ids() {
+    for (int i = 0; i < TC_COUNT; ++i) {
+        uint8_t flag = (uint8_t)(rand() & (IDF_PUBLIC | IDF_SIGNED | IDF_STRICT));
+        uint8_t category = (uint8_t)(CLS_CMON + rand() % 4);
+        int tag = rand() % 4;
+
+        ASSERT_EQUALS(QUID_OK, tc_create_id(&tc_ids[i], (i % 5) ? QUID_REV7 : QUID_REV4, flag, category, tag < 3 ? tc_tags[tag] : NULL));
+    }
+}
+
+static void decode_bulk() {
+    ASSERT_EQUALS(QUID_OK, quid_decode_bulk(tc_ids, TC_COUNT, tc_attr));
+
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(tc_ids[i].version, tc_attr[i].version);
+        ASSERT_EQUALS(quid_flag(&tc_ids[i]), tc_attr[i].flag);
+        ASSERT_EQUALS(quid_category(&tc_ids[i]), tc_attr[i].category);
+        if (tc_attr[i].tag[0]) {
+            ASSERT_EQUALS(0, memcmp(quid_tag(&tc_ids[i]), tc_attr[i].tag, 3));
+        }
+    }
+}
+
+/* Check query against a scan over the decoded attributes */
+static void check_query(const quid_attrindex_t *index, const quid_term_t *terms, size_t nterms) {
+    size_t count = quid_attrindex_query(index, terms, nterms, tc_rows);
+    size_t expect = 0;
+
+    for (uint32_t i = 0; i < TC_COUNT; ++i) {
+        int match = 1;
+        for (size_t t = 0; t < nterms; ++t) {
+            switch (terms[t].key) {
+                case QUID_KEY_CATEGORY:
+                    match &= tc_attr[i].category == terms[t].value;
+                    break;
+                case QUID_KEY_FLAG:
+                    match &= (tc_attr[i].flag & terms[t].value) == terms[t].value;
+                    break;
+                case QUID_KEY_TAG:
+                    match &= !memcmp(tc_attr[i].tag, terms[t].tag, 3);
+                    break;
+            }
+        }
+
+        if (match) {
+            ASSERT("too few rows", expect < count);
+            ASSERT_EQUALS(i, tc_rows[expect]);
+            expect++;
+        }
+    }
+
+    ASSERT_EQUALS(expect, count);
+}
+
+static void attrindex_query() {
+    quid_attrindex_t *index = quid_attrindex_build(tc_ids, TC_COUNT);
+    quid_term_t terms[3];
+
+    ASSERT("no index", index);
+    ASSERT_EQUALS(TC_COUNT, quid_attrindex_size(index));
+
+    memset(terms, 0, sizeof(terms));
+    terms[0].key = QUID_KEY_CATEGORY;
+    terms[0].value = CLS_ERROR;
+    check_query(index, terms, 1);
+
+    terms[1].key = QUID_KEY_TAG;
+    memcpy(terms[1].tag, tc_tags[0], 3);
+    check_query(index, terms, 2);
+
+    terms[2].key = QUID_KEY_FLAG;
+    terms[2].value = IDF_PUBLIC | IDF_STRICT;
+    check_query(index, terms, 3);
+    check_query(index, &terms[2], 1);
+
+    /* Untagged rows */
+    memset(terms[1].tag, 0, 3);
+    check_query(index, &terms[1], 1);
+
+    /* Unknown values match nothing */
+    terms[0].value = 0x7f;
+    ASSERT_EQUALS(0, quid_attrindex_query(index, terms, 1, tc_rows));
+    ASSERT_EQUALS(TC_COUNT, quid_attrindex_query(index, NULL, 0, tc_rows));
+
+    quid_attrindex_free(index);
+}
+
+static void attrindex_flat_buffer() {
+    quid_attrindex_t *index = quid_attrindex_build(tc_ids, TC_COUNT);
+    quid_attrindex_t *view;
+    quid_term_t term;
+    const void *data;
+    uint64_t *copy;
+    size_t length;
+
+    ASSERT("no index", index);
+    data = quid_attrindex_data(index, &length);
+    copy = malloc(length);
+    memcpy(copy, data, length);
+    quid_attrindex_free(index);
+
+    view = quid_attrindex_view(copy, length);
+    ASSERT("no view", view);
+
+    memset(&term, 0, sizeof(term));
+    term.key = QUID_KEY_TAG;
+    memcpy(term.tag, tc_tags[1], 3);
+    check_query(view, &term, 1);
+    quid_attrindex_free(view);
+
+    ASSERT("truncated buffer accepted", quid_attrindex_view(copy, length - 8) == NULL);
+    copy[0] ^= 1;
+    ASSERT("invalid buffer accepted", quid_attrindex_view(copy, length) == NULL);
+    free(copy);
+
+    index = quid_attrindex_build(NULL, 0);
+    ASSERT("no empty index", index);
+    ASSERT_EQUALS(0, quid_attrindex_query(index, &term, 1, tc_rows));
+    quid_attrindex_free(index);
+}
+
+int main() {
+    printf("Test vectors for QUID attribute index\n");
+    printf("======================================\n\n");
+
+    RUN(generate_ids);
+    RUN(decode_bulk);
+    RUN(attrindex_query);
+    RUN(attrindex_flat_buffer);
+    return TEST_REPORT();
+}
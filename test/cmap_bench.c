@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Scaling benchmark for the concurrent map. Every thread runs a
+ * 90/10 read/write mix on a shared key set, first against a single
+ * mutex guarded map and then against the sharded concurrent map.
+ *
+ * Usage: cmap_bench [max_threads] [ops_per_thread]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <quid.h>
+
+#include "../src/thread.h"
+
+#define BENCH_KEYS      (1 << 16)
+#define BENCH_SHARDS    64
+
+typedef struct {
+    unsigned int    seed;
+    long            ops;
+    int             locked;
+} bench_worker_t;
+
+static cuuid_t bench_ids[BENCH_KEYS];
+static quid_cmap_t *bench_cmap;
+static quid_map_t *bench_map;
+static qmutex_t bench_lock;
+
+/* Per thread generator, rand() is not reentrant */
+static inline unsigned int bench_rand(unsigned int *seed) {
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 8;
+}
+
+static double bench_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+QTHREAD_ROUTINE(bench_worker, arg) {
+    bench_worker_t *w = (bench_worker_t *)arg;
+    void *value;
+
+    for (long i = 0; i < w->ops; ++i) {
+        unsigned int r = bench_rand(&w->seed);
+        const cuuid_t *key = &bench_ids[r % BENCH_KEYS];
+        int write = (r >> 20) % 10 == 0;
+
+        if (w->locked) {
+            qmutex_lock(&bench_lock);
+            if (write) {
+                quid_map_put(bench_map, key, (void *)key);
+            } else {
+                quid_map_get(bench_map, key, &value);
+            }
+            qmutex_unlock(&bench_lock);
+        } else if (write) {
+            quid_cmap_put(bench_cmap, key, (void *)key);
+        } else {
+            quid_cmap_get(bench_cmap, key, &value);
+        }
+    }
+
+    QTHREAD_RETURN();
+}
+
+static double bench_run(int nthreads, long ops, int locked) {
+    qthread_t threads[256];
+    bench_worker_t workers[256];
+    double start = bench_now();
+
+    for (int t = 0; t < nthreads; ++t) {
+        workers[t].seed = (unsigned int)t * 7919 + 1;
+        workers[t].ops = ops;
+        workers[t].locked = locked;
+        qthread_create(&threads[t], bench_worker, &workers[t]);
+    }
+    for (int t = 0; t < nthreads; ++t) {
+        qthread_join(threads[t]);
+    }
+
+    return (nthreads * ops) / (bench_now() - start) / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+    int max_threads = argc > 1 ? atoi(argv[1]) : 8;
+    long ops = argc > 2 ? atol(argv[2]) : 1000000;
+
+    if (max_threads < 1 || max_threads > 256) {
+        fprintf(stderr, "threads must be between 1 and 256\n");
+        return 1;
+    }
+
+    for (int i = 0; i < BENCH_KEYS; ++i) {
+        bench_ids[i].version = QUID_REV7;
+        quid_create_simple(&bench_ids[i]);
+    }
+
+    bench_cmap = quid_cmap_new(BENCH_KEYS, BENCH_SHARDS);
+    bench_map = quid_map_new(BENCH_KEYS);
+    qmutex_init(&bench_lock);
+
+    /* Preload half of the keys */
+    for (int i = 0; i < BENCH_KEYS; i += 2) {
+        quid_cmap_put(bench_cmap, &bench_ids[i], &bench_ids[i]);
+        quid_map_put(bench_map, &bench_ids[i], &bench_ids[i]);
+    }
+
+    printf("threads    mutex Mops/s    cmap Mops/s\n");
+    for (int t = 1; t <= max_threads; t *= 2) {
+        double locked = bench_run(t, ops, 1);
+        double sharded = bench_run(t, ops, 0);
+        printf("%7d    %12.2f    %11.2f\n", t, locked, sharded);
+    }
+
+    quid_cmap_free(bench_cmap);
+    quid_map_free(bench_map);
+    qmutex_destroy(&bench_lock);
+    return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include <quid.h>
+
+#include "../src/thread.h"
+
+#include "tinytest.h"
+#include "testutil.h"
+
+#define TC_COUNT    40000
+#define TC_THREADS  4
+#define TC_STABLE   256
+#define TC_WINDOW   64
+
+static cuuid_t tc_ids[TC_COUNT];
+static quid_cmap_t *tc_map;
+static int tc_misses[TC_THREADS];
+static atomic_int tc_churning;
+
+static void generate_ids() {
+    ASSERT_EQUALS(QUID_OK, tc_create_ids(tc_ids, TC_COUNT));
+}
+
+static void cmap_put_and_get() {
+    quid_cmap_t *map = quid_cmap_new(0, 8);
+    void *value;
+
+    ASSERT("no map", map);
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_cmap_put(map, &tc_ids[i], &tc_ids[i]));
+    }
+    ASSERT_EQUALS(TC_COUNT, quid_cmap_size(map));
+
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_cmap_get(map, &tc_ids[i], &value));
+        ASSERT("value does not match", value == &tc_ids[i]);
+    }
+
+    ASSERT_EQUALS(QUID_EXISTS, quid_cmap_put(map, &tc_ids[0], NULL));
+    ASSERT_EQUALS(QUID_OK, quid_cmap_get(map, &tc_ids[0], &value));
+    ASSERT("value not replaced", value == NULL);
+
+    for (int i = 0; i < TC_COUNT; i += 2) {
+        ASSERT_EQUALS(QUID_OK, quid_cmap_erase(map, &tc_ids[i]));
+        ASSERT_EQUALS(QUID_ERROR, quid_cmap_erase(map, &tc_ids[i]));
+    }
+    ASSERT_EQUALS(TC_COUNT / 2, quid_cmap_size(map));
+
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS((i % 2) ? QUID_OK : QUID_ERROR, quid_cmap_get(map, &tc_ids[i], NULL));
+    }
+
+    quid_cmap_free(map);
+}
+
+/* Each thread owns a slice, inserts it and reads back all slices */
+QTHREAD_ROUTINE(cmap_worker, arg) {
+    int t = (int)(size_t)arg;
+    int slice = TC_COUNT / TC_THREADS;
+    void *value;
+
+    for (int i = t * slice; i < (t + 1) * slice; ++i) {
+        quid_cmap_put(tc_map, &tc_ids[i], &tc_ids[i]);
+        if (quid_cmap_get(tc_map, &tc_ids[i], &value) != QUID_OK || value != &tc_ids[i]) {
+            tc_misses[t]++;
+        }
+    }
+
+    for (int i = 0; i < TC_COUNT; ++i) {
+        if (quid_cmap_get(tc_map, &tc_ids[i], &value) == QUID_OK && value != &tc_ids[i]) {
+            tc_misses[t]++;
+        }
+    }
+
+    QTHREAD_RETURN();
+}
+
+static void cmap_threaded() {
+    qthread_t threads[TC_THREADS];
+
+    tc_map = quid_cmap_new(0, 4);
+    ASSERT("no map", tc_map);
+
+    for (int t = 0; t < TC_THREADS; ++t) {
+        ASSERT_EQUALS(0, qthread_create(&threads[t], cmap_worker, (void *)(size_t)t));
+    }
+    for (int t = 0; t < TC_THREADS; ++t) {
+        qthread_join(threads[t]);
+        ASSERT_EQUALS(0, tc_misses[t]);
+    }
+
+    ASSERT_EQUALS(TC_COUNT, quid_cmap_size(tc_map));
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_cmap_get(tc_map, &tc_ids[i], NULL));
+    }
+
+    quid_cmap_free(tc_map);
+}
+
+/* Stable keys must stay visible while other keys come and go */
+QTHREAD_ROUTINE(cmap_reader, arg) {
+    int *misses = (int *)arg;
+    void *value;
+
+    while (atomic_load(&tc_churning)) {
+        for (int i = 0; i < TC_STABLE; ++i) {
+            if (quid_cmap_get(tc_map, &tc_ids[i], &value) != QUID_OK || value != &tc_ids[i]) {
+                (*misses)++;
+            }
+        }
+    }
+
+    QTHREAD_RETURN();
+}
+
+/* Erasing leaves deleted slots, which are rehashed in place */
+static void cmap_churn() {
+    qthread_t reader;
+    int misses = 0;
+
+    tc_map = quid_cmap_new(0, 1);
+    ASSERT("no map", tc_map);
+
+    for (int i = 0; i < TC_STABLE; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_cmap_put(tc_map, &tc_ids[i], &tc_ids[i]));
+    }
+
+    atomic_store(&tc_churning, 1);
+    ASSERT_EQUALS(0, qthread_create(&reader, cmap_reader, &misses));
+
+    for (int i = TC_STABLE; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_cmap_put(tc_map, &tc_ids[i], &tc_ids[i]));
+        if (i - TC_STABLE >= TC_WINDOW) {
+            ASSERT_EQUALS(QUID_OK, quid_cmap_erase(tc_map, &tc_ids[i - TC_WINDOW]));
+        }
+    }
+
+    atomic_store(&tc_churning, 0);
+    qthread_join(reader);
+    ASSERT_EQUALS(0, misses);
+
+    ASSERT_EQUALS(TC_STABLE + TC_WINDOW, quid_cmap_size(tc_map));
+    for (int i = 0; i < TC_COUNT; ++i) {
+        int live = i < TC_STABLE || i >= TC_COUNT - TC_WINDOW;
+        ASSERT_EQUALS(live ? QUID_OK : QUID_ERROR, quid_cmap_get(tc_map, &tc_ids[i], NULL));
+    }
+
+    quid_cmap_free(tc_map);
+}
+
+int main() {
+    printf("Test vectors for QUID concurrent map\n");
+    printf("=========================================\n\n");
+
+    RUN(generate_ids);
+    RUN(cmap_put_and_get);
+    RUN(cmap_threaded);
+    RUN(cmap_churn);
+    return TEST_REPORT();
+}
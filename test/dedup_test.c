@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <quid.h>
+
+#include "tinytest.h"
+#include "testutil.h"
+
+#define TC_COUNT    20000
+#define TC_SECOND   10000000ULL         /* Ticks per second */
+#define TC_WINDOW   (600 * 1000000000LL)
+
+/* Identifier created at second offset from a fixed point in time */
+static void make_id(uint64_t second, cuuid_t *cuuid) {
+    tc_synthetic_id(second * TC_SECOND + tc_rand64() % TC_SECOND, cuuid);
+}
+
+/* Clock at the end of the second offset */
+static int64_t tc_now(uint64_t second) {
+    return (int64_t)(TC_BASE_TICKS + (second + 1) * TC_SECOND) * 100;
+}
+
+static void dedup_replay() {
+    quid_dedup_t *dedup = quid_dedup_new(TC_WINDOW, 0, TC_COUNT);
+    cuuid_t cuuid;
+
+    ASSERT("no cache", dedup);
+    for (int i = 0; i < TC_COUNT; ++i) {
+        srand(i + 1);
+        make_id(i / 100, &cuuid);
+        ASSERT_EQUALS(QUID_OK, quid_dedup_check_at(dedup, &cuuid, tc_now(i / 100)));
+    }
+    ASSERT_EQUALS(TC_COUNT, quid_dedup_size(dedup));
+
+    /* Replays inside the window are rejected */
+    for (int i = 0; i < TC_COUNT; ++i) {
+        srand(i + 1);
+        make_id(i / 100, &cuuid);
+        ASSERT_EQUALS(QUID_EXISTS, quid_dedup_check_at(dedup, &cuuid, tc_now(TC_COUNT / 100)));
+    }
+
+    quid_dedup_clear(dedup);
+    ASSERT_EQUALS(0, quid_dedup_size(dedup));
+    srand(1);
+    make_id(0, &cuuid);
+    ASSERT_EQUALS(QUID_OK, quid_dedup_check_at(dedup, &cuuid, tc_now(0)));
+
+    quid_dedup_free(dedup);
+}
+
+static void dedup_window_slide() {
+    quid_dedup_t *dedup = quid_dedup_new(TC_WINDOW, 10, 0);
+    cuuid_t first, cuuid;
+
+    ASSERT("no cache", dedup);
+    make_id(0, &first);
+    ASSERT_EQUALS(QUID_OK, quid_dedup_check_at(dedup, &first, tc_now(0)));
+
+    /* Still inside the window */
+    make_id(599, &cuuid);
+    ASSERT_EQUALS(QUID_OK, quid_dedup_check_at(dedup, &cuuid, tc_now(599)));
+    ASSERT_EQUALS(QUID_EXISTS, quid_dedup_check_at(dedup, &first, tc_now(599)));
+
+    /* Sliding past the window expires the first identifier */
+    make_id(2000, &cuuid);
+    ASSERT_EQUALS(QUID_OK, quid_dedup_check_at(dedup, &cuuid, tc_now(2000)));
+    ASSERT_EQUALS(QUID_ERROR, quid_dedup_check_at(dedup, &first, tc_now(2000)));
+    ASSERT_EQUALS(1, quid_dedup_size(dedup));
+
+    /* Late arrivals within the window are still tracked */
+    make_id(1500, &cuuid);
+    ASSERT_EQUALS(QUID_OK, quid_dedup_check_at(dedup, &cuuid, tc_now(2000)));
+    ASSERT_EQUALS(QUID_EXISTS, quid_dedup_check_at(dedup, &cuuid, tc_now(2000)));
+    ASSERT_EQUALS(2, quid_dedup_size(dedup));
+
+    /* The window does not move back with the clock */
+    ASSERT_EQUALS(QUID_ERROR, quid_dedup_check_at(dedup, &first, tc_now(0)));
+
+    quid_dedup_free(dedup);
+}
+
+static void dedup_future() {
+    quid_dedup_t *dedup = quid_dedup_new(TC_WINDOW, 10, 0);
+    cuuid_t first, cuuid;
+
+    ASSERT("no cache", dedup);
+    make_id(100, &first);
+    ASSERT_EQUALS(QUID_OK, quid_dedup_check_at(dedup, &first, tc_now(100)));
+
+    /* Dated far ahead of the clock, rejected without moving the window */
+    make_id(5000, &cuuid);
+    ASSERT_EQUALS(QUID_ERROR, quid_dedup_check_at(dedup, &cuuid, tc_now(100)));
+    ASSERT_EQUALS(QUID_EXISTS, quid_dedup_check_at(dedup, &first, tc_now(101)));
+
+    make_id(101, &cuuid);
+    ASSERT_EQUALS(QUID_OK, quid_dedup_check_at(dedup, &cuuid, tc_now(101)));
+
+    /* Small clock skew is tolerated */
+    make_id(130, &cuuid);
+    ASSERT_EQUALS(QUID_OK, quid_dedup_check_at(dedup, &cuuid, tc_now(101)));
+    ASSERT_EQUALS(3, quid_dedup_size(dedup));
+
+    quid_dedup_free(dedup);
+}
+
+/* Window driven by the system clock */
+static void dedup_wall_clock() {
+    quid_dedup_t *dedup = quid_dedup_new(TC_WINDOW, 0, 0);
+    cuuid_t cuuid;
+
+    ASSERT("no cache", dedup);
+    for (int i = 0; i < 100; ++i) {
+        memset(&cuuid, 0, sizeof(cuuid_t));
+        cuuid.version = QUID_REV7;
+        ASSERT_EQUALS(QUID_OK, quid_create_simple(&cuuid));
+        ASSERT_EQUALS(QUID_OK, quid_dedup_check(dedup, &cuuid));
+        ASSERT_EQUALS(QUID_EXISTS, quid_dedup_check(dedup, &cuuid));
+    }
+
+    /* Identifier from 2014 is outside the window */
+    quid128_t key;
+    key.hi = (14000000000000000ULL << 4) | 0xb;
+    key.lo = tc_rand64();
+    quid_unpack(&key, &cuuid);
+    ASSERT_EQUALS(QUID_ERROR, quid_dedup_check(dedup, &cuuid));
+
+    quid_dedup_free(dedup);
+}
+
+static void dedup_invalid() {
+    ASSERT("empty window accepted", quid_dedup_new(0, 0, 0) == NULL);
+    ASSERT_EQUALS(QUID_INVALID_PARAM, quid_dedup_check(NULL, NULL));
+    ASSERT_EQUALS(QUID_INVALID_PARAM, quid_dedup_check_at(NULL, NULL, 0));
+}
+
+int main() {
+    printf("Test vectors for QUID deduplication cache\n");
+    printf("==========================================\n\n");
+
+    RUN(dedup_replay);
+    RUN(dedup_window_slide);
+    RUN(dedup_future);
+    RUN(dedup_wall_clock);
+    RUN(dedup_invalid);
+    return TEST_REPORT();
+}
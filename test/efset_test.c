@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <quid.h>
+
+#include "tinytest.h"
+#include "testutil.h"
+
+#define TC_COUNT 20000
+
+static cuuid_t tc_ids[TC_COUNT];
+static cuuid_t tc_sorted[TC_COUNT];
+static int64_t tc_ns[TC_COUNT];
+
+/* Identifiers spread over about two minutes, unsorted and without duplicates */
+static void generate_ids() {
+    for (int i = 0; i < TC_COUNT; ++i) {
+        tc_synthetic_id((tc_rand64() % 1200000000ULL) / 3 * 3, &tc_ids[i]);
+    }
+
+    memcpy(tc_sorted, tc_ids, sizeof(tc_ids));
+    ASSERT_EQUALS(QUID_OK, quid_sort(tc_sorted, TC_COUNT));
+    ASSERT_EQUALS(QUID_OK, quid_epoch_ns_bulk(tc_sorted, TC_COUNT, tc_ns));
+}
+
+static void efset_membership() {
+    quid_efset_t *set = quid_efset_build(tc_ids, TC_COUNT);
+    cuuid_t other;
+
+    ASSERT("no set", set);
+    ASSERT_EQUALS(TC_COUNT, quid_efset_size(set));
+    ASSERT("set exceeds 96 bits per key", quid_efset_bytes(set) * 8 < TC_COUNT * 96);
+
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_efset_contains(set, &tc_ids[i]));
+
+        other = tc_ids[i];
+        other.node[5] ^= 1;
+        ASSERT_EQUALS(QUID_ERROR, quid_efset_contains(set, &other));
+    }
+
+    quid_efset_free(set);
+}
+
+static void efset_rank_select() {
+    quid_efset_t *set = quid_efset_build(tc_ids, TC_COUNT);
+    cuuid_t cuuid;
+
+    ASSERT("no set", set);
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_efset_select(set, i, &cuuid));
+        ASSERT_EQUALS(0, quid_order(&cuuid, &tc_sorted[i]));
+        ASSERT_EQUALS(i, quid_efset_rank(set, &tc_sorted[i]));
+    }
+
+    ASSERT_EQUALS(QUID_ERROR, quid_efset_select(set, TC_COUNT, &cuuid));
+
+    quid_efset_free(set);
+}
+
+static void efset_iterate() {
+    quid_efset_t *set = quid_efset_build(tc_ids, TC_COUNT);
+    quid_efset_iter_t iter;
+    cuuid_t cuuid;
+    size_t count = 0;
+
+    ASSERT("no set", set);
+    quid_efset_iter(set, 0, &iter);
+    while (quid_efset_next(&iter, &cuuid) == QUID_OK) {
+        ASSERT_EQUALS(0, quid_order(&cuuid, &tc_sorted[count]));
+        count++;
+    }
+    ASSERT_EQUALS(TC_COUNT, count);
+
+    quid_efset_iter(set, TC_COUNT - 10, &iter);
+    for (int i = TC_COUNT - 10; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_efset_next(&iter, &cuuid));
+        ASSERT_EQUALS(0, quid_order(&cuuid, &tc_sorted[i]));
+    }
+    ASSERT_EQUALS(QUID_ERROR, quid_efset_next(&iter, &cuuid));
+
+    quid_efset_free(set);
+}
+
+static void efset_time_range() {
+    quid_efset_t *set = quid_efset_build(tc_ids, TC_COUNT);
+    size_t first, last;
+
+    ASSERT("no set", set);
+    for (int i = 0; i < 1000; ++i) {
+        int64_t t0 = tc_ns[rand() % TC_COUNT] + (rand() % 3) * 100 - 100;
+        int64_t t1 = t0 + (int64_t)(tc_rand64() % 10000000000ULL);
+        size_t expect_first = TC_COUNT, expect_last = 0;
+
+        for (size_t j = 0; j < TC_COUNT; ++j) {
+            if (tc_ns[j] >= t0 && tc_ns[j] < t1) {
+                if (expect_first == TC_COUNT) {
+                    expect_first = j;
+                }
+                expect_last = j + 1;
+            }
+        }
+
+        if (expect_first == TC_COUNT) {
+            ASSERT_EQUALS(QUID_ERROR, quid_efset_range(set, t0, t1, &first, &last));
+            continue;
+        }
+
+        ASSERT_EQUALS(QUID_OK, quid_efset_range(set, t0, t1, &first, &last));
+        ASSERT_EQUALS(expect_first, first);
+        ASSERT_EQUALS(expect_last, last);
+    }
+
+    ASSERT_EQUALS(QUID_ERROR, quid_efset_range(set, 0, 1, &first, &last));
+    ASSERT_EQUALS(QUID_OK, quid_efset_range(set, 0, INT64_MAX, &first, &last));
+    ASSERT_EQUALS(0, first);
+    ASSERT_EQUALS(TC_COUNT, last);
+
+    quid_efset_free(set);
+}
+
+static void efset_duplicates() {
+    quid_efset_t *set;
+    cuuid_t cuuid;
+
+    /* Duplicates are collapsed */
+    memcpy(&tc_ids[TC_COUNT - 100], tc_ids, 100 * sizeof(cuuid_t));
+    set = quid_efset_build(tc_ids, TC_COUNT);
+    ASSERT("no set", set);
+    ASSERT_EQUALS(TC_COUNT - 100, quid_efset_size(set));
+    quid_efset_free(set);
+
+    /* A single key and the empty set */
+    set = quid_efset_build(tc_ids, 1);
+    ASSERT("no set", set);
+    ASSERT_EQUALS(QUID_OK, quid_efset_select(set, 0, &cuuid));
+    ASSERT_EQUALS(0, quid_order(&cuuid, &tc_ids[0]));
+    ASSERT_EQUALS(QUID_OK, quid_efset_contains(set, &tc_ids[0]));
+    ASSERT_EQUALS(QUID_ERROR, quid_efset_contains(set, &tc_ids[1]));
+    quid_efset_free(set);
+
+    set = quid_efset_build(NULL, 0);
+    ASSERT("no empty set", set);
+    ASSERT_EQUALS(0, quid_efset_size(set));
+    ASSERT_EQUALS(QUID_ERROR, quid_efset_contains(set, &tc_ids[0]));
+    quid_efset_free(set);
+}
+
+int main() {
+    printf("Test vectors for QUID succinct set\n");
+    printf("===================================\n\n");
+
+    RUN(generate_ids);
+    RUN(efset_membership);
+    RUN(efset_rank_select);
+    RUN(efset_iterate);
+    RUN(efset_time_range);
+    RUN(efset_duplicates);
+    return TEST_REPORT();
+}
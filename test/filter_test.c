@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <quid.h>
+
+#include "tinytest.h"
+#include "testutil.h"
+
+#define TC_COUNT 20000
+
+static cuuid_t tc_ids[TC_COUNT];
+static cuuid_t tc_other[TC_COUNT];
+static uint32_t tc_sel[TC_COUNT];
+
+static void generate_ids() {
+    ASSERT_EQUALS(QUID_OK, tc_create_ids(tc_ids, TC_COUNT));
+    ASSERT_EQUALS(QUID_OK, tc_create_ids(tc_other, TC_COUNT));
+}
+
+static void bloom_membership() {
+    quid_bloom_t *bloom = quid_bloom_new(TC_COUNT, 0);
+    size_t positives = 0;
+
+    ASSERT("no filter", bloom);
+    ASSERT_EQUALS(QUID_OK, quid_bloom_add_bulk(bloom, tc_ids, TC_COUNT / 2));
+    for (int i = TC_COUNT / 2; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_bloom_add(bloom, &tc_ids[i]));
+    }
+
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_bloom_contains(bloom, &tc_ids[i]));
+        positives += quid_bloom_contains(bloom, &tc_other[i]) == QUID_OK;
+    }
+
+    ASSERT("false positive rate too high", positives < TC_COUNT / 50);
+    ASSERT_EQUALS(TC_COUNT, quid_bloom_query_bulk(bloom, tc_ids, TC_COUNT, tc_sel));
+    ASSERT_EQUALS(TC_COUNT - 1, tc_sel[TC_COUNT - 1]);
+    ASSERT_EQUALS(positives, quid_bloom_query_bulk(bloom, tc_other, TC_COUNT, tc_sel));
+
+    quid_bloom_free(bloom);
+}
+
+static void bloom_flat_buffer() {
+    quid_bloom_t *bloom = quid_bloom_new(TC_COUNT, 16);
+    quid_bloom_t *view;
+    const void *data;
+    uint64_t *copy;
+    size_t length;
+
+    ASSERT_EQUALS(QUID_OK, quid_bloom_add_bulk(bloom, tc_ids, TC_COUNT));
+    data = quid_bloom_data(bloom, &length);
+
+    copy = malloc(length);
+    memcpy(copy, data, length);
+    quid_bloom_free(bloom);
+
+    view = quid_bloom_view(copy, length);
+    ASSERT("no view", view);
+    ASSERT_EQUALS(TC_COUNT, quid_bloom_query_bulk(view, tc_ids, TC_COUNT, tc_sel));
+    ASSERT_EQUALS(QUID_ERROR, quid_bloom_add(view, &tc_other[0]));
+    quid_bloom_free(view);
+
+    ASSERT("truncated buffer accepted", quid_bloom_view(copy, length - 1) == NULL);
+    copy[0] ^= 1;
+    ASSERT("invalid buffer accepted", quid_bloom_view(copy, length) == NULL);
+
+    free(copy);
+}
+
+static void xorf_membership() {
+    quid_xorf_t *xorf, *view;
+    const void *data;
+    uint64_t *copy;
+    size_t length, positives = 0;
+
+    /* Duplicates must not break the build */
+    memcpy(&tc_ids[TC_COUNT - 100], tc_ids, 100 * sizeof(cuuid_t));
+
+    xorf = quid_xorf_build(tc_ids, TC_COUNT);
+    ASSERT("no filter", xorf);
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_xorf_contains(xorf, &tc_ids[i]));
+        positives += quid_xorf_contains(xorf, &tc_other[i]) == QUID_OK;
+    }
+
+    ASSERT("false positive rate too high", positives < TC_COUNT / 100);
+    ASSERT_EQUALS(TC_COUNT, quid_xorf_query_bulk(xorf, tc_ids, TC_COUNT, tc_sel));
+    ASSERT_EQUALS(positives, quid_xorf_query_bulk(xorf, tc_other, TC_COUNT, tc_sel));
+
+    data = quid_xorf_data(xorf, &length);
+    ASSERT("filter exceeds 10 bits per key", length * 8 < (TC_COUNT + 1000) * 10);
+    copy = malloc(length);
+    memcpy(copy, data, length);
+    quid_xorf_free(xorf);
+
+    view = quid_xorf_view(copy, length);
+    ASSERT("no view", view);
+    ASSERT_EQUALS(TC_COUNT, quid_xorf_query_bulk(view, tc_ids, TC_COUNT, tc_sel));
+    quid_xorf_free(view);
+
+    ASSERT("bloom buffer accepted", quid_bloom_view(copy, length) == NULL);
+    free(copy);
+
+    xorf = quid_xorf_build(NULL, 0);
+    ASSERT("no empty filter", xorf);
+    quid_xorf_free(xorf);
+}
+
+int main() {
+    printf("Test vectors for QUID membership filters\n");
+    printf("=========================================\n\n");
+
+    RUN(generate_ids);
+    RUN(bloom_membership);
+    RUN(bloom_flat_buffer);
+    RUN(xorf_membership);
+    return TEST_REPORT();
+}
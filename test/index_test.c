@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <quid.h>
+
+#include "tinytest.h"
+#include "testutil.h"
+
+#define TC_COUNT 20000
+
+static cuuid_t tc_ids[TC_COUNT];
+static int64_t tc_ns[TC_COUNT];
+
+/* Sorted identifiers spread over about two minutes, with duplicate timestamps */
+static void generate_ids() {
+    for (int i = 0; i < TC_COUNT; ++i) {
+        tc_synthetic_id((tc_rand64() % 1200000000ULL) / 3 * 3, &tc_ids[i]);
+    }
+
+    ASSERT_EQUALS(QUID_OK, quid_sort(tc_ids, TC_COUNT));
+    ASSERT_EQUALS(QUID_OK, quid_epoch_ns_bulk(tc_ids, TC_COUNT, tc_ns));
+}
+
+static void index_unsorted() {
+    cuuid_t tc_u[2] = { tc_ids[1], tc_ids[0] };
+
+    ASSERT("unsorted array indexed", quid_index_build(tc_u, 2) == NULL);
+}
+
+static void index_time_range() {
+    quid_index_t *index = quid_index_build(tc_ids, TC_COUNT);
+    size_t first, last;
+
+    ASSERT("no index", index);
+    for (int i = 0; i < 1000; ++i) {
+        int64_t t0 = tc_ns[rand() % TC_COUNT] + (rand() % 3) * 100 - 100;
+        int64_t t1 = t0 + (int64_t)(tc_rand64() % 10000000000ULL);
+        size_t expect_first = TC_COUNT, expect_last = 0;
+
+        for (size_t r = 0; r < TC_COUNT; ++r) {
+            if (tc_ns[r] >= t0 && tc_ns[r] < t1) {
+                if (expect_first == TC_COUNT) {
+                    expect_first = r;
+                }
+                expect_last = r + 1;
+            }
+        }
+
+        if (expect_first == TC_COUNT) {
+            ASSERT_EQUALS(QUID_ERROR, quid_index_range(index, t0, t1, &first, &last));
+            continue;
+        }
+
+        ASSERT_EQUALS(QUID_OK, quid_index_range(index, t0, t1, &first, &last));
+        ASSERT_EQUALS(expect_first, first);
+        ASSERT_EQUALS(expect_last, last);
+    }
+
+    ASSERT_EQUALS(QUID_OK, quid_index_range(index, 0, INT64_MAX, &first, &last));
+    ASSERT_EQUALS(0, first);
+    ASSERT_EQUALS(TC_COUNT, last);
+    ASSERT_EQUALS(QUID_ERROR, quid_index_range(index, 0, tc_ns[0], &first, &last));
+    ASSERT_EQUALS(QUID_ERROR, quid_index_range(index, tc_ns[TC_COUNT - 1] + 1, INT64_MAX, &first, &last));
+
+    quid_index_free(index);
+}
+
+static void index_point_lookup() {
+    quid_index_t *index = quid_index_build(tc_ids, TC_COUNT);
+    quid128_t key;
+    cuuid_t tc_u;
+    size_t pos;
+
+    ASSERT("no index", index);
+    for (size_t i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_index_find(index, &tc_ids[i], &pos));
+        ASSERT_EQUALS(i, pos);
+
+        quid_pack(&tc_ids[i], &key);
+        key.lo ^= 1;
+        quid_unpack(&key, &tc_u);
+        if (i + 1 < TC_COUNT && !quid_cmp(&tc_u, &tc_ids[i + 1]) && (!i || !quid_cmp(&tc_u, &tc_ids[i - 1]))) {
+            ASSERT_EQUALS(QUID_ERROR, quid_index_find(index, &tc_u, &pos));
+        }
+    }
+
+    quid_index_free(index);
+}
+
+int main() {
+    printf("Test vectors for QUID time range index\n");
+    printf("=========================================\n\n");
+
+    srand(7);
+
+    RUN(generate_ids);
+    RUN(index_unsorted);
+    RUN(index_time_range);
+    RUN(index_point_lookup);
+    return TEST_REPORT();
+}
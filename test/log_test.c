@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WIN32
+# define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <quid.h>
+
+#include "tinytest.h"
+#include "testutil.h"
+
+#ifndef WIN32
+
+#include <unistd.h>
+#include <dirent.h>
+
+#define TC_COUNT    20000
+#define TC_SECOND   10000000ULL         /* Ticks per second */
+
+static cuuid_t tc_ids[TC_COUNT];
+static int64_t tc_ns[TC_COUNT];
+static char tc_path[] = "/tmp/quid_log_XXXXXX";
+
+/* Identifiers about one per millisecond, slightly out of order */
+static void generate_ids() {
+    for (int i = 0; i < TC_COUNT; ++i) {
+        tc_synthetic_id((uint64_t)i * TC_SECOND / 1000 + tc_rand64() % (TC_SECOND / 100), &tc_ids[i]);
+    }
+
+    ASSERT_EQUALS(QUID_OK, quid_epoch_ns_bulk(tc_ids, TC_COUNT, tc_ns));
+    ASSERT("no directory", mkdtemp(tc_path));
+}
+
+static int count_segments() {
+    struct dirent *entry;
+    DIR *dir = opendir(tc_path);
+    int count = 0;
+
+    while (dir && (entry = readdir(dir))) {
+        count += strstr(entry->d_name, ".qlog") != NULL;
+    }
+
+    if (dir) {
+        closedir(dir);
+    }
+    return count;
+}
+
+static void log_append() {
+    quid_log_t *log = quid_log_open(tc_path, 64 * 1024, 0);
+
+    ASSERT("no log", log);
+    ASSERT_EQUALS(QUID_OK, quid_log_append(log, tc_ids, TC_COUNT / 2));
+    ASSERT_EQUALS(QUID_OK, quid_log_sync(log));
+    quid_log_close(log);
+
+    /* Reopened log continues in the last segment */
+    log = quid_log_open(tc_path, 64 * 1024, 0);
+    ASSERT("no log", log);
+    ASSERT_EQUALS(TC_COUNT / 2, quid_log_size(log));
+    for (int i = TC_COUNT / 2; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_log_append(log, &tc_ids[i], 1));
+    }
+    ASSERT_EQUALS(TC_COUNT, quid_log_size(log));
+    ASSERT("no rotation", count_segments() > 1);
+    quid_log_close(log);
+}
+
+typedef struct {
+    size_t  count;
+    int64_t t0;
+    int64_t t1;
+    int     valid;
+} scan_t;
+
+static int scan_cb(const quid128_t *records, size_t n, void *arg) {
+    scan_t *scan = arg;
+
+    for (size_t i = 0; i < n; ++i) {
+        cuuid_t cuuid;
+        int64_t ns;
+
+        quid_unpack(&records[i], &cuuid);
+        ns = quid_epoch_ns(&cuuid);
+        scan->valid &= ns >= scan->t0 && ns < scan->t1;
+    }
+
+    scan->count += n;
+    return 0;
+}
+
+static int stop_cb(const quid128_t *records, size_t n, void *arg) {
+    ((void)records);
+    *(size_t *)arg += n;
+    return 1;
+}
+
+static void log_scan() {
+    quid_log_t *log = quid_log_open(tc_path, 64 * 1024, 0);
+    size_t stopped = 0;
+
+    ASSERT("no log", log);
+    for (int i = 0; i < 200; ++i) {
+        scan_t scan = { 0, 0, 0, 1 };
+        size_t expect = 0;
+
+        scan.t0 = tc_ns[rand() % TC_COUNT];
+        scan.t1 = scan.t0 + (int64_t)(tc_rand64() % 2000000000ULL);
+        for (int j = 0; j < TC_COUNT; ++j) {
+            expect += tc_ns[j] >= scan.t0 && tc_ns[j] < scan.t1;
+        }
+
+        ASSERT_EQUALS(expect, quid_log_scan(log, scan.t0, scan.t1, scan_cb, &scan));
+        ASSERT_EQUALS(expect, scan.count);
+        ASSERT("record out of range", scan.valid);
+    }
+
+    ASSERT_EQUALS(0, quid_log_scan(log, 0, 1, stop_cb, &stopped));
+    ASSERT("scan not stopped", quid_log_scan(log, 0, INT64_MAX, stop_cb, &stopped) < TC_COUNT);
+
+    quid_log_close(log);
+}
+
+static void log_rotate_time() {
+    quid_log_t *log;
+    int segments = count_segments();
+
+    /* Segments spanning a second */
+    log = quid_log_open(tc_path, 0, 1000000000LL);
+    ASSERT("no log", log);
+    ASSERT_EQUALS(QUID_OK, quid_log_append(log, tc_ids, 5000));
+    ASSERT("no time rotation", count_segments() >= segments + 4);
+    ASSERT_EQUALS(TC_COUNT + 5000, quid_log_size(log));
+    quid_log_close(log);
+}
+
+static void log_cleanup() {
+    struct dirent *entry;
+    DIR *dir = opendir(tc_path);
+    char name[4096];
+
+    while (dir && (entry = readdir(dir))) {
+        if (strstr(entry->d_name, ".qlog")) {
+            snprintf(name, sizeof(name), "%s/%s", tc_path, entry->d_name);
+            unlink(name);
+        }
+    }
+
+    if (dir) {
+        closedir(dir);
+    }
+    ASSERT_EQUALS(0, rmdir(tc_path));
+}
+
+int main() {
+    printf("Test vectors for QUID log\n");
+    printf("==========================\n\n");
+
+    RUN(generate_ids);
+    RUN(log_append);
+    RUN(log_scan);
+    RUN(log_rotate_time);
+    RUN(log_cleanup);
+    return TEST_REPORT();
+}
+
+#else
+
+int main() {
+    return 0;
+}
+
+#endif // WIN32
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <quid.h>
+
+#include "tinytest.h"
+#include "testutil.h"
+
+#define TC_COUNT 20000
+
+static cuuid_t tc_ids[TC_COUNT];
+static cuuid_t tc_out[TC_COUNT];
+static quid_attr_t tc_attr[TC_COUNT];
+static size_t tc_offsets[8192 + 1];
+
+static void generate_ids() {
+    char tag[3] = {'A', 'B', 'C'};
+
+    for (int i = 0; i < TC_COUNT; ++i) {
+        uint8_t flag = (uint8_t)(rand() & (IDF_PUBLIC | IDF_MASTER | IDF_STRICT));
+        uint8_t category = (uint8_t)(CLS_CMON + rand() % 4);
+
+        tag[2] = (char)('A' + rand() % 16);
+        ASSERT_EQUALS(QUID_OK, tc_create_id(&tc_ids[i], QUID_REV7, flag, category, tag));
+    }
+
+    ASSERT_EQUALS(QUID_OK, quid_decode_bulk(tc_ids, TC_COUNT, tc_attr));
+}
+
+/* Every partition must hold the rows of its key in input order */
+static void check_partitions(int key, int64_t width, size_t npart) {
+    static size_t cursor[8192];
+
+    ASSERT_EQUALS(QUID_OK, quid_partition_by(tc_ids, TC_COUNT, key, width, tc_out, tc_offsets, npart));
+    ASSERT_EQUALS(0, tc_offsets[0]);
+    ASSERT_EQUALS(TC_COUNT, tc_offsets[npart]);
+
+    memcpy(cursor, tc_offsets, npart * sizeof(size_t));
+    for (size_t i = 0; i < TC_COUNT; ++i) {
+        size_t p;
+
+        switch (key) {
+            case QUID_KEY_CATEGORY:
+                p = tc_attr[i].category % npart;
+                break;
+            case QUID_KEY_FLAG:
+                p = tc_attr[i].flag % npart;
+                break;
+            default:
+                p = (size_t)((uint64_t)quid_epoch_ns(&tc_ids[i]) / (uint64_t)width % npart);
+                break;
+        }
+
+        ASSERT("partition overflow", cursor[p] < tc_offsets[p + 1]);
+        ASSERT_EQUALS(0, memcmp(&tc_ids[i], &tc_out[cursor[p]], sizeof(cuuid_t)));
+        cursor[p]++;
+    }
+}
+
+static void partition_category() {
+    check_partitions(QUID_KEY_CATEGORY, 0, 5);
+    check_partitions(QUID_KEY_CATEGORY, 0, 1);
+}
+
+static void partition_flag() {
+    check_partitions(QUID_KEY_FLAG, 0, 256);
+    check_partitions(QUID_KEY_FLAG, 0, 8192);
+}
+
+static void partition_time() {
+    check_partitions(QUID_KEY_TIME_BUCKET, 1000000, 64);
+}
+
+/* Timestamps in nanoseconds beyond 64 bits, checked in 128 bit arithmetic */
+static void partition_time_high() {
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 u128_t;
+    static const int64_t widths[] = {1000000, 999999937, 7, INT64_MAX};
+    static cuuid_t ids[TC_COUNT];
+    quid128_t key;
+
+    for (int i = 0; i < TC_COUNT; ++i) {
+        key.hi = (((1ULL << 60) - 1 - (uint64_t)i * 1000003) << 4) | 0xb;
+        key.lo = tc_rand64();
+        quid_unpack(&key, &ids[i]);
+    }
+
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w) {
+        ASSERT_EQUALS(QUID_OK, quid_partition_by(ids, TC_COUNT, QUID_KEY_TIME_BUCKET, widths[w], tc_out, tc_offsets, 64));
+        ASSERT_EQUALS(TC_COUNT, tc_offsets[64]);
+
+        for (size_t p = 0; p < 64; ++p) {
+            for (size_t j = tc_offsets[p]; j < tc_offsets[p + 1]; ++j) {
+                u128_t ns;
+
+                quid_pack(&tc_out[j], &key);
+                ns = (u128_t)(key.hi >> 4) * 100;
+                ASSERT_EQUALS(p, (size_t)(ns / (uint64_t)widths[w] % 64));
+            }
+        }
+    }
+#endif
+}
+
+static void partition_tag() {
+    static quid_attr_t attr[TC_COUNT];
+    int seen[256];
+
+    ASSERT_EQUALS(QUID_OK, quid_partition_by(tc_ids, TC_COUNT, QUID_KEY_TAG, 0, tc_out, tc_offsets, 16));
+    ASSERT_EQUALS(TC_COUNT, tc_offsets[16]);
+    ASSERT_EQUALS(QUID_OK, quid_decode_bulk(tc_out, TC_COUNT, attr));
+
+    /* Equal tags share a partition */
+    memset(seen, -1, sizeof(seen));
+    for (int p = 0; p < 16; ++p) {
+        for (size_t j = tc_offsets[p]; j < tc_offsets[p + 1]; ++j) {
+            uint8_t c = (uint8_t)attr[j].tag[2];
+
+            if (seen[c] < 0) {
+                seen[c] = p;
+            }
+            ASSERT_EQUALS(seen[c], p);
+        }
+    }
+}
+
+static void partition_invalid() {
+    ASSERT_EQUALS(QUID_INVALID_PARAM, quid_partition_by(tc_ids, TC_COUNT, QUID_KEY_TIME_BUCKET, 0, tc_out, tc_offsets, 4));
+    ASSERT_EQUALS(QUID_INVALID_PARAM, quid_partition_by(tc_ids, TC_COUNT, QUID_KEY_CATEGORY, 0, tc_out, tc_offsets, 0));
+    ASSERT_EQUALS(QUID_INVALID_PARAM, quid_partition_by(tc_ids, TC_COUNT, 0, 0, tc_out, tc_offsets, 4));
+}
+
+int main() {
+    printf("Test vectors for QUID partitioning\n");
+    printf("===================================\n\n");
+
+    RUN(generate_ids);
+    RUN(partition_category);
+    RUN(partition_flag);
+    RUN(partition_time);
+    RUN(partition_tag);
+    RUN(partition_time_high);
+    RUN(partition_invalid);
+    return TEST_REPORT();
+}
@@ -34,6 +34,10 @@
 #include <quid.h>
 
 #include "tinytest.h"
+#include "../src/thread.h"
+
+#define TC_GEN_THREADS  4
+#define TC_GEN_COUNT    20000
 
 #ifdef WIN32
 # define STRCOPY(s,c) strcpy_s(s, sizeof(s), c);
@@ -163,6 +167,36 @@ static void legacy_string_and_back() {
     ASSERT_EQUALS(QUID_REV4, tc_c.version);
 }
 
+static void parse_bounded_string() {
+    cuuid_t tc_u, tc_c;
+    char tc_str[QUID_FULLLEN + 1];
+    const char *tc_buf = "ef8b38d40f17b0b88000ce377d90ec18,{a3c5d3f4-0f18-a0b8-8000-0000015dfc00}";
+
+    for (int i = 0; i < 20; ++i) {
+        tc_u.version = QUID_REV7;
+        ASSERT_EQUALS(QUID_OK, quid_create_simple(&tc_u));
+        quid_tostring(&tc_u, tc_str);
+        ASSERT_EQUALS(QUID_OK, quid_parse_n(tc_str, strlen(tc_str), &tc_c));
+        ASSERT("quid does not match", quid_cmp(&tc_u, &tc_c));
+        ASSERT_EQUALS(QUID_OK, quid_parse_n(tc_str + 1, QUID_FULLLEN - 2, &tc_c));
+        ASSERT("quid does not match", quid_cmp(&tc_u, &tc_c));
+    }
+
+    ASSERT_EQUALS(QUID_OK, quid_parse_n(tc_buf, 32, &tc_c));
+    ASSERT_EQUALS(QUID_REV7, tc_c.version);
+    ASSERT_EQUALS(QUID_OK, quid_parse_n(tc_buf + 33, QUID_FULLLEN, &tc_c));
+    ASSERT_EQUALS(QUID_REV4, tc_c.version);
+    ASSERT_EQUALS(0x015dfc00, tc_c.node[2] << 24 | tc_c.node[3] << 16 | tc_c.node[4] << 8 | tc_c.node[5]);
+
+    ASSERT_EQUALS(QUID_ERROR, quid_parse_n(tc_buf, 31, &tc_c));
+    ASSERT_EQUALS(QUID_ERROR, quid_parse_n(tc_buf, 33, &tc_c));
+    ASSERT_EQUALS(QUID_ERROR, quid_parse_n(tc_buf, strlen(tc_buf), &tc_c));
+    ASSERT_EQUALS(QUID_ERROR, quid_parse_n("{00000000-0000-0000-0000-000000000000}", QUID_FULLLEN, &tc_c));
+    ASSERT_EQUALS(QUID_ERROR, quid_parse_n("{00000001-0000-b000-0000-00000000000g}", QUID_FULLLEN, &tc_c));
+    ASSERT_EQUALS(QUID_OK, quid_parse_n("{00000001-0000-b000-0000-000000000000}", QUID_FULLLEN, &tc_c));
+    ASSERT_EQUALS(QUID_INVALID_PARAM, quid_parse_n(NULL, 0, &tc_c));
+}
+
 static void check_category_and_flags() {
     cuuid_t tc_u;
 
@@ -240,6 +274,192 @@ static void check_timestamp() {
     }
 }
 
+static void check_epoch_ns() {
+    cuuid_t tc_u[64];
+    int64_t tc_ns[64];
+
+    for (int i = 0; i < 64; ++i) {
+        memset(&tc_u[i], 0, sizeof(cuuid_t));
+        tc_u[i].version = (i % 2) ? QUID_REV4 : QUID_REV7;
+        ASSERT_EQUALS(QUID_OK, quid_create_simple(&tc_u[i]));
+    }
+
+    ASSERT_EQUALS(QUID_OK, quid_epoch_ns_bulk(tc_u, 64, tc_ns));
+    ASSERT_EQUALS(QUID_INVALID_PARAM, quid_epoch_ns_bulk(NULL, 64, tc_ns));
+
+    time_t timt = time(NULL);
+    for (int i = 0; i < 64; ++i) {
+        ASSERT_EQUALS(quid_epoch_ns(&tc_u[i]), tc_ns[i]);
+        ASSERT_EQUALS(quid_microtime(&tc_u[i]), (long)((tc_ns[i] / 1000) % 1000000));
+        ASSERT("timestamp skew", tc_ns[i] / 1000000000 <= timt
+               && tc_ns[i] / 1000000000 >= timt - 2);
+    }
+}
+
+static void check_generator() {
+    quid_gen_t tc_gen;
+    quid128_t tc_keys[5000];
+    quid_attr_t tc_attr;
+    cuuid_t tc_u;
+
+    ASSERT_EQUALS(QUID_OK, quid_gen_init(&tc_gen, QUID_REV7, IDF_PUBLIC, CLS_WARN, "ABC"));
+    ASSERT_EQUALS(QUID_OK, quid_gen_fill(&tc_gen, tc_keys, 5000));
+    for (int i = 0; i < 5000; ++i) {
+        ASSERT("ticks not increasing", i == 0 || (tc_keys[i - 1].hi >> 4) < (tc_keys[i].hi >> 4));
+        quid_unpack(&tc_keys[i], &tc_u);
+        ASSERT_EQUALS(QUID_OK, quid_validate(&tc_u));
+        ASSERT_EQUALS(QUID_OK, quid_decode_bulk(&tc_u, 1, &tc_attr));
+        ASSERT_EQUALS(QUID_REV7, tc_attr.version);
+        ASSERT_EQUALS(IDF_PUBLIC, tc_attr.flag);
+        ASSERT_EQUALS(CLS_WARN, tc_attr.category);
+        ASSERT("tag does not match", !memcmp(tc_attr.tag, "ABC", 3));
+    }
+
+    ASSERT_EQUALS(QUID_OK, quid_gen_next(&tc_gen, &tc_u));
+    ASSERT_EQUALS(QUID_OK, quid_validate(&tc_u));
+    ASSERT_EQUALS(IDF_PUBLIC, quid_flag(&tc_u));
+    ASSERT_EQUALS(CLS_WARN, quid_category(&tc_u));
+    ASSERT("timestamp not after batch", quid_epoch_ns(&tc_u) > (int64_t)(tc_keys[4999].hi >> 4) * 100);
+
+    ASSERT_EQUALS(QUID_OK, quid_gen_init(&tc_gen, QUID_REV4, IDF_MASTER | IDF_STRICT, CLS_WARN, NULL));
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_gen_next(&tc_gen, &tc_u));
+        ASSERT_EQUALS(QUID_REV4, tc_u.version);
+        ASSERT_EQUALS(QUID_OK, quid_validate(&tc_u));
+        ASSERT("no flag found", quid_flag(&tc_u) & FLAG_MASTER);
+        ASSERT("no flag found", quid_flag(&tc_u) & FLAG_STRICT);
+        ASSERT_EQUALS(CLS_WARN, quid_category(&tc_u));
+    }
+
+    ASSERT_EQUALS(QUID_INVALID_PARAM, quid_gen_init(NULL, QUID_REV7, IDF_NULL, CLS_CMON, NULL));
+    ASSERT_EQUALS(QUID_INVALID_PARAM, quid_gen_fill(&tc_gen, NULL, 1));
+    ASSERT_EQUALS(QUID_OK, quid_gen_fill(&tc_gen, NULL, 0));
+}
+
+static quid128_t tc_gen_keys[TC_GEN_THREADS][TC_GEN_COUNT];
+
+/* Each thread owns a context, fills its slice in batches and singles */
+QTHREAD_ROUTINE(gen_worker, arg) {
+    size_t t = (size_t)arg;
+    quid_gen_t gen;
+    cuuid_t uid;
+
+    quid_gen_init(&gen, QUID_REV7, IDF_NULL, CLS_CMON, NULL);
+    for (size_t i = 0; i < TC_GEN_COUNT;) {
+        if (i % 2) {
+            quid_gen_next(&gen, &uid);
+            quid_pack(&uid, &tc_gen_keys[t][i++]);
+        } else {
+            size_t n = (TC_GEN_COUNT - i < 1500) ? TC_GEN_COUNT - i : 1500;
+            quid_gen_fill(&gen, &tc_gen_keys[t][i], n);
+            i += n;
+        }
+    }
+
+    QTHREAD_RETURN();
+}
+
+static void check_generator_threaded() {
+    qthread_t threads[TC_GEN_THREADS];
+    quid128_t *keys = &tc_gen_keys[0][0];
+    size_t total = TC_GEN_THREADS * TC_GEN_COUNT;
+
+    for (size_t t = 0; t < TC_GEN_THREADS; ++t) {
+        ASSERT_EQUALS(0, qthread_create(&threads[t], gen_worker, (void *)t));
+    }
+    for (size_t t = 0; t < TC_GEN_THREADS; ++t) {
+        qthread_join(threads[t]);
+    }
+
+    /* Separate contexts never hand out the same timestamp */
+    ASSERT_EQUALS(QUID_OK, quid_sort128(keys, total));
+    for (size_t i = 1; i < total; ++i) {
+        ASSERT("duplicate timestamp", (keys[i - 1].hi >> 4) != (keys[i].hi >> 4));
+    }
+}
+
+/* Contexts and quid_create draw from the same timestamp sequence */
+static void check_generator_mixed() {
+    quid128_t *keys = &tc_gen_keys[0][0];
+    size_t total = 0;
+    quid_gen_t gen;
+    cuuid_t uid;
+
+    ASSERT_EQUALS(QUID_OK, quid_gen_init(&gen, QUID_REV7, IDF_NULL, CLS_CMON, NULL));
+    while (total + 34 <= TC_GEN_THREADS * TC_GEN_COUNT) {
+        memset(&uid, 0, sizeof(cuuid_t));
+        uid.version = QUID_REV7;
+        ASSERT_EQUALS(QUID_OK, quid_create_simple(&uid));
+        quid_pack(&uid, &keys[total++]);
+
+        ASSERT_EQUALS(QUID_OK, quid_gen_next(&gen, &uid));
+        quid_pack(&uid, &keys[total++]);
+
+        ASSERT_EQUALS(QUID_OK, quid_gen_fill(&gen, &keys[total], 32));
+        total += 32;
+    }
+
+    ASSERT_EQUALS(QUID_OK, quid_sort128(keys, total));
+    for (size_t i = 1; i < total; ++i) {
+        ASSERT("duplicate timestamp", (keys[i - 1].hi >> 4) != (keys[i].hi >> 4));
+    }
+}
+
+static void check_pack_and_order() {
+    cuuid_t tc_u, tc_b, tc_p;
+    quid128_t tc_k;
+
+    memset(&tc_p, 0, sizeof(cuuid_t));
+    tc_p.version = QUID_REV7;
+    ASSERT_EQUALS(QUID_OK, quid_create_simple(&tc_p));
+
+    for (int i = 0; i < 1000; ++i) {
+        memset(&tc_u, 0, sizeof(cuuid_t));
+        tc_u.version = (i % 2) ? QUID_REV4 : QUID_REV7;
+        ASSERT_EQUALS(QUID_OK, quid_create_simple(&tc_u));
+        quid_pack(&tc_u, &tc_k);
+        quid_unpack(&tc_k, &tc_b);
+        ASSERT("quid does not match", quid_cmp(&tc_u, &tc_b));
+        ASSERT_EQUALS(tc_u.version, tc_b.version);
+        ASSERT_EQUALS(0, quid_order(&tc_u, &tc_b));
+        ASSERT("quid out of order", quid_epoch_ns(&tc_p) >= quid_epoch_ns(&tc_u) || quid_order(&tc_p, &tc_u) < 0);
+        ASSERT("quid out of order", quid_epoch_ns(&tc_p) <= quid_epoch_ns(&tc_u) || quid_order(&tc_p, &tc_u) > 0);
+        ASSERT_EQUALS(-quid_order(&tc_p, &tc_u), quid_order(&tc_u, &tc_p));
+        tc_p = tc_u;
+    }
+}
+
+static void check_filter_time() {
+    cuuid_t tc_u[300];
+    quid128_t tc_k[300];
+    int64_t tc_ns[300];
+    uint32_t tc_sel[300], tc_sel128[300];
+
+    for (int i = 0; i < 300; ++i) {
+        memset(&tc_u[i], 0, sizeof(cuuid_t));
+        tc_u[i].version = QUID_REV7;
+        ASSERT_EQUALS(QUID_OK, quid_create_simple(&tc_u[i]));
+        quid_pack(&tc_u[i], &tc_k[i]);
+    }
+    ASSERT_EQUALS(QUID_OK, quid_epoch_ns_bulk(tc_u, 300, tc_ns));
+
+    int64_t t0 = tc_ns[40], t1 = tc_ns[270];
+    size_t count = quid_filter_time(tc_u, 300, t0, t1, tc_sel);
+    ASSERT_EQUALS(count, quid_filter_time128(tc_k, 300, t0, t1, tc_sel128));
+
+    size_t expect = 0;
+    for (uint32_t i = 0; i < 300; ++i) {
+        if (tc_ns[i] >= t0 && tc_ns[i] < t1) {
+            ASSERT_EQUALS(i, tc_sel[expect]);
+            ASSERT_EQUALS(i, tc_sel128[expect]);
+            expect++;
+        }
+    }
+    ASSERT_EQUALS(expect, count);
+    ASSERT_EQUALS(0, quid_filter_time(tc_u, 300, t1, t0, tc_sel));
+    ASSERT_EQUALS(300, quid_filter_time(tc_u, 300, 0, INT64_MAX, tc_sel));
+}
+
 static void check_quid_version() {
     cuuid_t tc_u;
 
@@ -260,10 +480,17 @@ int main() {
     RUN(convert_string);
     RUN(convert_string_and_back);
     RUN(legacy_string_and_back);
+    RUN(parse_bounded_string);
     RUN(check_category_and_flags);
     RUN(check_legacy_category_and_flags);
     RUN(check_tag);
     RUN(check_timestamp);
+    RUN(check_epoch_ns);
+    RUN(check_generator);
+    RUN(check_generator_threaded);
+    RUN(check_generator_mixed);
+    RUN(check_pack_and_order);
+    RUN(check_filter_time);
     RUN(check_quid_version);
     return TEST_REPORT();
 }
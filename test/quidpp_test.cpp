@@ -0,0 +1,779 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <future>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <ranges>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <quidpp.h>
+#include <flat.h>
+#include <arena.h>
+#include <async.h>
+#include <format.h>
+
+#include "tinytest.h"
+
+using quidpp::Quid;
+using namespace quidpp::literals;
+
+static void quidpp_default() {
+    Quid q;
+
+    ASSERT("Default is nil", q.IsNil());
+    ASSERT_EQUALS(0, q.High());
+    ASSERT_EQUALS(0, q.Low());
+
+    std::vector<Quid> v(64);
+    for (const Quid& e : v) {
+        ASSERT("Resize does not generate", e.IsNil());
+    }
+}
+
+static void quidpp_generate() {
+    Quid q1 = Quid::Generate();
+    Quid q2 = Quid::Generate();
+
+    ASSERT("Generated is not nil", !q1.IsNil());
+    ASSERT("Identifiers differ", q1 != q2);
+    ASSERT_EQUALS(QUID_REV7, q1.Version());
+    ASSERT("Time moves forward", q1.Ticks() <= q2.Ticks());
+
+    Quid q3 = q1;
+    ASSERT("Copy is equal", q3 == q1);
+
+    cuuid_t cuuid = q1.ToCuuid();
+    ASSERT("Unpack roundtrip", Quid{ cuuid } == q1);
+    ASSERT_EQUALS(QUID_OK, quid_validate(&cuuid));
+
+    quid_attr_t attr = Quid::Generate(IDF_PUBLIC, CLS_INFO).Attributes();
+    ASSERT_EQUALS(IDF_PUBLIC, attr.flag);
+    ASSERT_EQUALS(CLS_INFO, attr.category);
+}
+
+static void quidpp_format() {
+    Quid q = Quid::Generate();
+    char str[QUID_FULLLEN + 1];
+    cuuid_t cuuid = q.ToCuuid();
+
+    ASSERT_EQUALS(QUID_OK, quid_tostring(&cuuid, str));
+
+    Quid::String arr = q.ToArray();
+    ASSERT_STRING_EQUALS(str, arr.data());
+
+    char buf[QUID_FULLLEN + 1];
+    q.ToChars(buf);
+    ASSERT_STRING_EQUALS(str, buf);
+
+    ASSERT("Full string", q.ToString() == str);
+    ASSERT("Compact string", q.ToString(true) == std::string(str + 1, 36));
+
+    std::ostringstream os;
+    os << q;
+    ASSERT("Stream output", os.str() == str);
+}
+
+static void quidpp_parse() {
+    Quid q = Quid::Generate();
+    Quid out;
+
+    ASSERT("Parse braced", Quid{ q.ToString() } == q);
+    ASSERT("Parse compact", Quid{ q.ToString(true) } == q);
+
+    ASSERT("Reject garbage", !Quid::Parse("not a quid", out));
+    ASSERT("Reject empty", !Quid::Parse("", out));
+    ASSERT("Reject oversize", !Quid::Parse(std::string(64, '0'), out));
+    ASSERT("Untouched on failure", out.IsNil());
+
+    bool thrown = false;
+    try {
+        Quid{ "{00000000-0000-0000-0000-00000000000g}" };
+    } catch (const quidpp::InvalidQuidException&) {
+        thrown = true;
+    }
+    ASSERT("Throws on invalid input", thrown);
+
+    std::string str = "xx" + q.ToString() + "xx";
+    std::string_view sv{ str };
+    ASSERT("Parse from view", Quid::Parse(sv.substr(2, QUID_FULLLEN), out) && out == q);
+    ASSERT("Reject prefix", !Quid::Parse(sv.substr(2, 10), out));
+}
+
+static void quidpp_try_parse() {
+    Quid q = Quid::Generate();
+
+    auto r1 = Quid::TryParse(q.ToString());
+    ASSERT("Parse braced", r1.has_value() && *r1 == q);
+
+    auto r2 = Quid::TryParse("");
+    ASSERT("Reject empty", !r2 && r2.error() == quidpp::ParseError::Empty);
+
+    auto r3 = Quid::TryParse("{00000000-0000-0000-0000-000000000000}");
+    ASSERT("Reject nil", !r3 && r3.error() == quidpp::ParseError::Malformed);
+
+    auto r4 = Quid::TryParse(q.ToString() + "0");
+    ASSERT("Reject trailing digit", !r4 && r4.error() == quidpp::ParseError::Malformed);
+}
+
+static void quidpp_parse_all() {
+    std::vector<Quid> ids;
+    std::vector<quidpp::ParseFailure> errors;
+    std::string buffer;
+
+    for (int i = 0; i < 16; ++i) {
+        ids.push_back(Quid::Generate());
+        buffer += ids.back().ToString(i % 2 == 0);
+        buffer += i % 3 == 0 ? ",\n" : " ";
+        if (i == 5) {
+            buffer += "bogus;";
+        }
+    }
+
+    std::vector<Quid> out;
+    quidpp::ParseStats stats = quidpp::ParseAll(buffer, std::back_inserter(out), std::back_inserter(errors));
+    ASSERT_EQUALS(16, stats.parsed);
+    ASSERT_EQUALS(1, stats.failed);
+    ASSERT("All identifiers parsed", out == ids);
+    ASSERT_EQUALS(1, errors.size());
+    ASSERT("Error points at token", buffer.compare(errors[0].offset, errors[0].length, "bogus") == 0);
+    ASSERT("Error reason", errors[0].error == quidpp::ParseError::Malformed);
+
+    out.clear();
+    stats = quidpp::ParseAll("", std::back_inserter(out));
+    ASSERT_EQUALS(0, stats.parsed + stats.failed);
+    stats = quidpp::ParseAll(" ,x, ", std::back_inserter(out));
+    ASSERT_EQUALS(1, stats.failed);
+    ASSERT("Nothing written", out.empty());
+}
+
+static constexpr Quid tc_root = "{00000001-0000-b000-0000-000000000000}"_quid;
+
+static_assert(tc_root.High() == 0x080000000000001bULL, "literal is packed at compile time");
+static_assert(tc_root.Low() == 0, "literal is packed at compile time");
+static_assert(tc_root.Version() == QUID_REV7, "literal version");
+static_assert(tc_root.ToArray()[8] == '1', "formatter is constexpr");
+static_assert(Quid::FromString("a3c5d3f40f18a0b880000000015dfc00")->Version() == QUID_REV4, "constexpr parse");
+static_assert(!Quid::FromString("{00000000-0000-0000-0000-000000000000}"), "constexpr validation");
+
+static void quidpp_constexpr() {
+    char str[QUID_FULLLEN + 1];
+
+    ASSERT("Literal formats back", tc_root.ToString() == "{00000001-0000-b000-0000-000000000000}");
+
+    for (int i = 0; i < 100; ++i) {
+        Quid q = i % 2 ? Quid::Generate() : Quid{ [] {
+            cuuid_t cuuid;
+            memset(&cuuid, 0, sizeof(cuuid_t));
+            cuuid.version = QUID_REV4;
+            quid_create_simple(&cuuid);
+            return cuuid;
+        }() };
+        cuuid_t cuuid = q.ToCuuid();
+
+        ASSERT_EQUALS(QUID_OK, quid_tostring(&cuuid, str));
+        ASSERT_STRING_EQUALS(str, q.ToArray().data());
+
+        auto r = Quid::FromString(str);
+        ASSERT("Constexpr parser matches", r && *r == q && *r == *Quid::TryParse(str));
+    }
+
+    ASSERT("Reject garbage", !Quid::FromString("{00000001-0000-b000-0000-00000000000g}"));
+    ASSERT("Reject empty", Quid::FromString("").error() == quidpp::ParseError::Empty);
+}
+
+static void quidpp_generator() {
+    quidpp::Generator gen{ IDF_PUBLIC, CLS_INFO, "XYZ" };
+    std::vector<Quid> ids(1000);
+
+    Quid q = gen.Generate();
+    ASSERT("Generated is valid", Quid::TryParse(q.ToString()).has_value());
+
+    gen.GenerateInto(std::span<Quid>{ ids });
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ASSERT("Ticks increase", (i ? ids[i - 1] : q).Ticks() < ids[i].Ticks());
+        quid_attr_t attr = ids[i].Attributes();
+        ASSERT_EQUALS(IDF_PUBLIC, attr.flag);
+        ASSERT_EQUALS(CLS_INFO, attr.category);
+        ASSERT("Tag is kept", !memcmp(attr.tag, "XYZ", 3));
+    }
+
+    quidpp::Generator legacy{ IDF_NULL, CLS_CMON, nullptr, QUID_REV4 };
+    ASSERT_EQUALS(QUID_REV4, legacy.Generate().Version());
+    ASSERT("Thread generator is reused", &quidpp::Generator::ThisThread() == &quidpp::Generator::ThisThread());
+    ASSERT_EQUALS(QUID_REV7, quidpp::Generator::ThisThread().Generate().Version());
+}
+
+static void quidpp_generator_range() {
+    std::set<Quid, bool (*)(const Quid&, const Quid&)> seen{ [](const Quid& a, const Quid& b) {
+        return quid_order128(&a.Key(), &b.Key()) < 0;
+    } };
+    size_t count = 0;
+    Quid last;
+
+    static_assert(std::ranges::input_range<quidpp::GeneratorRange>);
+
+    for (const Quid& q : quidpp::Generator::ThisThread().Range(1000)) {
+        ASSERT("Ordered", last.Ticks() < q.Ticks());
+        seen.insert(q);
+        last = q;
+        count++;
+    }
+    ASSERT_EQUALS(1000, count);
+    ASSERT_EQUALS(1000, seen.size());
+
+    auto range = quidpp::Generator::ThisThread().Range(0);
+    ASSERT("Empty range", range.begin() == range.end());
+
+    std::vector<Quid> other;
+    std::thread t{ [&other] {
+        for (const Quid& q : quidpp::Generator::ThisThread().Range(1000)) {
+            other.push_back(q);
+        }
+    } };
+    t.join();
+    for (const Quid& q : other) {
+        ASSERT("Threads do not collide", seen.insert(q).second);
+    }
+}
+
+/* Every instantiation has its own timestamp sequence */
+template <int Sequence>
+struct StepClock {
+    uint64_t *now;
+
+    uint64_t operator()() const noexcept {
+        return *now += 1000;
+    }
+};
+
+static void quidpp_basic_generator() {
+    uint64_t tc_now = 16000000000000000ULL;
+    quidpp::BasicGenerator<QUID_REV7, StepClock<0>> gen{ IDF_TAGGED, CLS_ERROR, "TAG", StepClock<0>{ &tc_now } };
+    std::vector<Quid> ids(3000);
+
+    gen.GenerateInto(ids.data(), ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        cuuid_t cuuid = ids[i].ToCuuid();
+        ASSERT_EQUALS(QUID_OK, quid_validate(&cuuid));
+        ASSERT("Ticks increase", i == 0 || ids[i - 1].Ticks() < ids[i].Ticks());
+        ASSERT("Clock is not overrun", ids[i].Ticks() <= tc_now + 1024);
+
+        quid_attr_t attr = ids[i].Attributes();
+        ASSERT_EQUALS(QUID_REV7, attr.version);
+        ASSERT_EQUALS(IDF_TAGGED, attr.flag);
+        ASSERT_EQUALS(CLS_ERROR, attr.category);
+        ASSERT("Tag is kept", !memcmp(attr.tag, "TAG", 3));
+    }
+    ASSERT_EQUALS(16000000000002000ULL, ids[0].Ticks());
+
+    quidpp::BasicGenerator<QUID_REV4, quidpp::SystemClock> legacy{ IDF_MASTER | IDF_STRICT, CLS_WARN };
+    for (int i = 0; i < 100; ++i) {
+        cuuid_t cuuid = legacy.Generate().ToCuuid();
+        ASSERT_EQUALS(QUID_OK, quid_validate(&cuuid));
+        ASSERT_EQUALS(QUID_REV4, cuuid.version);
+        ASSERT("no flag found", quid_flag(&cuuid) & FLAG_MASTER);
+        ASSERT_EQUALS(CLS_WARN, quid_category(&cuuid));
+    }
+
+    /* Same seed, clock and sequence yield the same identifiers */
+    uint64_t tc_a = 16000000000000000ULL, tc_b = tc_a;
+    quidpp::BasicGenerator<QUID_REV7, StepClock<1>> a{ IDF_NULL, CLS_CMON, nullptr, StepClock<1>{ &tc_a }, quidpp::SplitMix64{ 42 } };
+    quidpp::BasicGenerator<QUID_REV7, StepClock<2>> b{ IDF_NULL, CLS_CMON, nullptr, StepClock<2>{ &tc_b }, quidpp::SplitMix64{ 42 } };
+    for (int i = 0; i < 100; ++i) {
+        ASSERT("Deterministic", a.Generate() == b.Generate());
+    }
+}
+
+static void quidpp_basic_generator_threaded() {
+    constexpr size_t count = 20000;
+    std::vector<Quid> ids(3 * count);
+
+    auto worker = [&](size_t slice) {
+        quidpp::BasicGenerator<QUID_REV7> gen;
+        Quid *out = ids.data() + slice * count;
+
+        for (size_t i = 0; i < count;) {
+            if (i % 2) {
+                out[i++] = gen.Generate();
+            } else {
+                size_t n = std::min<size_t>(count - i, 1500);
+                gen.GenerateInto(out + i, n);
+                i += n;
+            }
+        }
+    };
+
+    std::thread ta{ worker, 0 };
+    std::thread tb{ worker, 1 };
+
+    /* Library contexts and quid_create share the sequence of the system clock */
+    Quid *out = ids.data() + 2 * count;
+    for (size_t i = 0; i < count;) {
+        if (i % 2) {
+            out[i++] = Quid::Generate();
+        } else {
+            size_t n = std::min<size_t>(count - i, 1500);
+            quidpp::Generator::ThisThread().GenerateInto(out + i, n);
+            i += n;
+        }
+    }
+
+    ta.join();
+    tb.join();
+
+    std::sort(ids.begin(), ids.end());
+    for (size_t i = 1; i < ids.size(); ++i) {
+        ASSERT("Generators do not collide", ids[i - 1].Ticks() != ids[i].Ticks());
+    }
+}
+
+static void quidpp_hash_and_order() {
+    std::vector<Quid> ids(2000);
+
+    quidpp::Generator::ThisThread().GenerateInto(ids.data(), ids.size());
+    std::reverse(ids.begin(), ids.end());
+    std::sort(ids.begin(), ids.end());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ASSERT_EQUALS(quid_hash128(&ids[i].Key()), ids[i].Hash());
+        ASSERT_EQUALS(static_cast<size_t>(ids[i].Hash()), std::hash<Quid>{}(ids[i]));
+        if (i) {
+            ASSERT("Sorted by time", ids[i - 1] < ids[i]);
+            ASSERT("Same as library order", quid_order128(&ids[i - 1].Key(), &ids[i].Key()) < 0);
+            ASSERT("Three way", (ids[i] <=> ids[i - 1]) > 0);
+        }
+    }
+
+    std::unordered_set<Quid, quidpp::QuidHash, quidpp::QuidEqual> hashed(ids.begin(), ids.end());
+    std::map<Quid, size_t, quidpp::QuidLess> ordered;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ordered.emplace(ids[i], i);
+    }
+
+    for (size_t i = 0; i < ids.size(); i += 7) {
+        Quid::String str = ids[i].ToArray();
+        std::string_view sv{ str.data(), QUID_FULLLEN };
+        ASSERT("Hashed lookup by string", hashed.find(sv) != hashed.end());
+        auto it = ordered.find(sv);
+        ASSERT("Ordered lookup by string", it != ordered.end() && it->second == i);
+    }
+    ASSERT("Malformed string not found", hashed.find(std::string_view{ "bogus" }) == hashed.end());
+    ASSERT("Malformed string not found", ordered.find(std::string_view{ "bogus" }) == ordered.end());
+
+    /* Malformed strings do not match the nil identifier */
+    hashed.insert(Quid{});
+    ASSERT("Nil key not matched", hashed.find(std::string_view{ "bogus" }) == hashed.end());
+    ASSERT("Nil key not matched", !quidpp::QuidEqual{}(Quid{}, std::string_view{ "bogus" }));
+    ordered.emplace(Quid{}, ids.size());
+    ASSERT("Nil key not matched", ordered.find(std::string_view{ "bogus" }) == ordered.end());
+    ASSERT("Nil key not matched", ordered.lower_bound(std::string_view{ "bogus" }) == ordered.end());
+    ASSERT("Nil key by value", ordered.find(Quid{}) != ordered.end());
+}
+
+static void quidpp_flat_containers() {
+    std::vector<Quid> ids(5000);
+    quidpp::FlatHashSet set;
+    quidpp::FlatMap<size_t> map;
+
+    quidpp::Generator::ThisThread().GenerateInto(ids.data(), ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ASSERT("Insert new", set.Insert(ids[i]));
+        ASSERT("Insert new", map.Insert(ids[ids.size() - 1 - i], ids.size() - 1 - i));
+    }
+    ASSERT("Insert existing", !set.Insert(ids[42]));
+    ASSERT("Insert existing", !map.Insert(ids[42], 0));
+    ASSERT_EQUALS(ids.size(), set.Size());
+    ASSERT_EQUALS(ids.size(), map.Size());
+    ASSERT("Keys ordered", std::is_sorted(map.Keys().begin(), map.Keys().end()));
+
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ASSERT("Contains", set.Contains(ids[i]));
+        ASSERT("Map lookup", map.Find(ids[i]) && *map.Find(ids[i]) == i);
+    }
+    ASSERT("Set lookup by string", set.Contains(ids[7].ToString()));
+    ASSERT("Map lookup by string", *map.Find(std::string_view{ ids[7].ToString() }) == 7);
+    ASSERT("Nil not present", !set.Contains(Quid{}));
+    ASSERT("Insert nil", set.Insert(Quid{}) && set.Contains(Quid{}));
+    ASSERT("Malformed string not found", !set.Contains("garbage"));
+
+    /* A malformed string does not match the nil key */
+    quidpp::FlatMap<int> nil;
+    nil.Insert(Quid{}, 7);
+    ASSERT("Malformed string not found", !nil.Find("garbage") && !nil.Contains("garbage"));
+
+    for (size_t i = 0; i < ids.size(); i += 2) {
+        ASSERT("Erase", set.Erase(ids[i]));
+        ASSERT("Erase", map.Erase(ids[i]));
+    }
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ASSERT("Erased entries gone", set.Contains(ids[i]) == (i % 2 == 1));
+        ASSERT("Erased entries gone", map.Contains(ids[i]) == (i % 2 == 1));
+    }
+    ASSERT("Erase missing", !set.Erase(ids[0]) && !map.Erase(ids[0]));
+    ASSERT_EQUALS(ids.size() / 2 + 1, set.Size());
+
+    set.Clear();
+    ASSERT("Cleared", set.Empty() && !set.Contains(ids[1]) && !set.Contains(Quid{}));
+}
+
+/* Upstream resource counting the bytes handed out */
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocated = 0;
+
+private:
+    void *do_allocate(size_t bytes, size_t align) override {
+        allocated += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+
+    void do_deallocate(void *p, size_t bytes, size_t align) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+static void quidpp_arena() {
+    CountingResource upstream;
+    quidpp::Generator gen{ IDF_PUBLIC, CLS_INFO };
+
+    {
+        quidpp::pmr::BasicArena<16384> arena{ &upstream };
+
+        quidpp::pmr::QuidVector ids = arena.Generate(gen, 64);
+        quidpp::pmr::StringViewVector views = arena.Format(ids.data(), ids.size());
+        quidpp::pmr::AttrVector attr = arena.Decode(ids.data(), ids.size());
+
+        for (size_t i = 0; i < ids.size(); ++i) {
+            ASSERT("Formatted", views[i] == ids[i].ToString());
+            ASSERT_EQUALS(IDF_PUBLIC, attr[i].flag);
+            ASSERT_EQUALS(CLS_INFO, attr[i].category);
+        }
+        ASSERT("Single id", arena.Format(ids[0]) == views[0]);
+        ASSERT("Arena string", std::string_view{ arena.ToString(ids[1], true) } == ids[1].ToString(true));
+        ASSERT("Arena string uses arena", arena.ToString(ids[1]).get_allocator().resource() == arena.Resource());
+        ASSERT_EQUALS(0, upstream.allocated);
+
+        quidpp::pmr::QuidVector more = arena.MakeVector(4096);
+        ASSERT("Spills to upstream", upstream.allocated > 0);
+
+        arena.Release();
+        more = arena.Generate(gen, 16);
+        ASSERT_EQUALS(16, more.size());
+    }
+}
+
+/* Coroutine which runs to completion on its own */
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+static Detached consume(quidpp::AsyncStream& stream, size_t batches, std::vector<Quid>& out, std::promise<void>& done) {
+    for (size_t i = 0; i < batches; ++i) {
+        quidpp::AsyncStream::Batch batch = co_await stream.Next();
+        if (batch.empty()) {
+            break;
+        }
+        out.insert(out.end(), batch.begin(), batch.end());
+    }
+    done.set_value();
+}
+
+/* Consumer owning the stream, destroys it wherever it is resumed */
+static Detached consume_owned(std::unique_ptr<quidpp::AsyncStream> stream, std::promise<std::string>& done) {
+    std::string error;
+    try {
+        while (!(co_await stream->Next()).empty()) {
+        }
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    stream.reset();
+    done.set_value(error);
+}
+
+static void quidpp_parse_batches() {
+    std::vector<Quid> ids(1000);
+    std::string text;
+
+    quidpp::Generator::ThisThread().GenerateInto(ids.data(), ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        text += ids[i].ToString(i % 2 == 0);
+        text += i % 100 == 0 ? " garbage\n" : (i % 3 ? "," : "\n");
+    }
+
+    std::istringstream in{ text };
+    quidpp::ParseStats stats{ 0, 0 };
+    std::vector<Quid> out;
+    for (std::span<const Quid> batch : quidpp::ParseBatches(in, 64, &stats)) {
+        ASSERT("Batch bounded", batch.size() <= 64 && !batch.empty());
+        out.insert(out.end(), batch.begin(), batch.end());
+    }
+    ASSERT("Parsed across reads", out == ids);
+    ASSERT_EQUALS(1000, stats.parsed);
+    ASSERT_EQUALS(10, stats.failed);
+
+    size_t count = 0;
+    for (std::span<const Quid> batch : quidpp::MintBatches(quidpp::Generator::ThisThread(), 32)) {
+        ASSERT_EQUALS(32, batch.size());
+        if (++count == 4) {
+            break;
+        }
+    }
+}
+
+static void quidpp_async_stream() {
+    std::vector<Quid> out;
+    std::promise<void> done;
+
+    auto stream = quidpp::AsyncStream::Mint(256, 2);
+    consume(*stream, 20, out, done);
+    done.get_future().wait();
+    ASSERT_EQUALS(20 * 256, out.size());
+    for (size_t i = 1; i < out.size(); ++i) {
+        ASSERT("Ordered and unique", out[i - 1] < out[i]);
+    }
+
+    /* Parsed input resumed on a loop owned by this thread */
+    std::vector<Quid> ids(500);
+    std::string text;
+    quidpp::Generator::ThisThread().GenerateInto(ids.data(), ids.size());
+    for (const Quid& q : ids) {
+        text += q.ToString() + "\n";
+    }
+
+    std::mutex lock;
+    std::condition_variable cv;
+    std::queue<std::coroutine_handle<>> loop;
+    auto post = [&](std::coroutine_handle<> h) {
+        std::lock_guard<std::mutex> guard{ lock };
+        loop.push(h);
+        cv.notify_one();
+    };
+
+    std::istringstream in{ text };
+    std::vector<Quid> parsed;
+    std::promise<void> finished;
+    std::future<void> future = finished.get_future();
+    auto source = quidpp::AsyncStream::Parse(in, 64, 1, post);
+    std::thread::id self = std::this_thread::get_id();
+    bool remote = false;
+
+    consume(*source, 1000, parsed, finished);
+    while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        std::unique_lock<std::mutex> guard{ lock };
+        cv.wait(guard, [&] { return !loop.empty(); });
+        std::coroutine_handle<> h = loop.front();
+        loop.pop();
+        guard.unlock();
+        remote |= std::this_thread::get_id() != self;
+        h.resume();
+    }
+    ASSERT("Resumed on the loop", !remote);
+    ASSERT("Parsed stream", parsed == ids);
+}
+
+static void quidpp_async_stream_lifetime() {
+    /* Stream ends on the producer thread and is released there */
+    for (int i = 0; i < 10; ++i) {
+        std::istringstream empty;
+        std::promise<std::string> done;
+        std::future<std::string> future = done.get_future();
+
+        consume_owned(quidpp::AsyncStream::Parse(empty, 4), done);
+        ASSERT("Ends cleanly", future.get().empty());
+    }
+
+    std::promise<std::string> done;
+    std::future<std::string> future = done.get_future();
+    auto slow = [](quidpp::AsyncStream::Batch&) -> size_t {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return 0;
+    };
+    consume_owned(std::make_unique<quidpp::AsyncStream>(slow, 4), done);
+    ASSERT("Ends cleanly", future.get().empty());
+
+    /* Source failure reaches the consumer after the pending batches */
+    std::promise<std::string> failed;
+    std::future<std::string> reason = failed.get_future();
+    int calls = 0;
+    auto faulty = [&calls](quidpp::AsyncStream::Batch& batch) -> size_t {
+        if (++calls > 2) {
+            throw std::runtime_error{ "source failed" };
+        }
+        batch.resize(4);
+        return batch.size();
+    };
+    consume_owned(std::make_unique<quidpp::AsyncStream>(faulty, 4), failed);
+    ASSERT("Exception is rethrown", reason.get() == "source failed");
+}
+
+static void quidpp_format_spec() {
+    std::vector<Quid> ids(200);
+    std::string out;
+
+    quidpp::Generator::ThisThread().GenerateInto(ids.data(), ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        std::string braced = ids[i].ToString();
+        std::string upper = braced;
+        std::transform(upper.begin(), upper.end(), upper.begin(), [](char c) { return static_cast<char>(toupper(c)); });
+
+        out.clear();
+        quidpp::FormatTo(std::back_inserter(out), ids[i]);
+        ASSERT("Braced", out == braced);
+
+        out.clear();
+        quidpp::FormatTo(std::back_inserter(out), ids[i], 'C');
+        ASSERT("Compact uppercase", out == upper.substr(1, 36));
+
+        out.clear();
+        quidpp::FormatTo(std::back_inserter(out), ids[i], 's');
+        ASSERT_EQUALS(26, out.size());
+
+        if (i) {
+            std::string prev;
+            quidpp::FormatTo(std::back_inserter(prev), ids[i - 1], 's');
+            ASSERT("Base32 sorts like the key", prev < out);
+        }
+    }
+
+    std::string b32;
+    quidpp::FormatTo(std::back_inserter(b32), Quid{ quid128_t{ 0, 31 } }, 's');
+    ASSERT("Base32 low digit", b32 == "0000000000000000000000000z");
+    b32.clear();
+    quidpp::FormatTo(std::back_inserter(b32), Quid{ quid128_t{ ~0ULL, ~0ULL } }, 'S');
+    ASSERT("Base32 high digit", b32 == "7ZZZZZZZZZZZZZZZZZZZZZZZZZ");
+
+#if defined(QUIDPP_TEST_FMT) && defined(QUIDPP_HAS_FMT)
+    ASSERT("fmt braced", fmt::format("{}", ids[0]) == ids[0].ToString());
+    ASSERT("fmt compact", fmt::format("id={:c}", ids[0]) == "id=" + ids[0].ToString(true));
+    ASSERT("fmt base32", fmt::format("{:s}", ids[0]).size() == 26);
+    bool thrown = false;
+    try {
+        (void)fmt::format(fmt::runtime("{:q}"), ids[0]);
+    } catch (const fmt::format_error&) {
+        thrown = true;
+    }
+    ASSERT("fmt rejects spec", thrown);
+#endif
+#if defined(__cpp_lib_format)
+    ASSERT("std braced", std::format("{}", ids[0]) == ids[0].ToString());
+    ASSERT("std compact", std::format("{:c}", ids[0]) == ids[0].ToString(true));
+#endif
+}
+
+static void quidpp_parse_view() {
+    std::vector<Quid> ids(100);
+    std::string text = "\n  ";
+
+    quidpp::Generator::ThisThread().GenerateInto(ids.data(), ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        text += ids[i].ToString(i % 2 == 1);
+        text += i == 10 ? " {bogus} " : (i % 4 ? ";" : ",\r\n");
+    }
+
+    size_t valid = 0, invalid = 0;
+    for (auto result : quidpp::ParseView(text)) {
+        if (result) {
+            ASSERT("In order", *result == ids[valid]);
+            valid++;
+        } else {
+            ASSERT("Malformed", result.error() == quidpp::ParseError::Malformed);
+            invalid++;
+        }
+    }
+    ASSERT_EQUALS(100, valid);
+    ASSERT_EQUALS(1, invalid);
+
+    quidpp::QuidView view = quidpp::ParseView(text);
+    auto it = view.begin();
+    ASSERT("Token offset", text.compare(it.Offset(), it.Token().size(), ids[0].ToString()) == 0);
+    auto copy = it++;
+    ASSERT("Multipass", *(*copy) == ids[0] && *(*it) == ids[1]);
+
+    static_assert(std::ranges::forward_range<quidpp::QuidView>);
+    static_assert(std::ranges::view<quidpp::QuidView>);
+    static_assert(std::ranges::borrowed_range<quidpp::QuidView>);
+
+    auto first = std::ranges::find_if(quidpp::ParseView(text), [](const auto& r) { return !r; });
+    ASSERT("Find malformed token", first.Token() == "{bogus}");
+
+    size_t taken = 0;
+    for (auto result : quidpp::ParseView(text) | std::views::filter([](const auto& r) { return r.has_value(); }) | std::views::take(3)) {
+        ASSERT("Filtered", *result == ids[taken]);
+        taken++;
+    }
+    ASSERT_EQUALS(3, taken);
+
+    ASSERT("Empty buffer", quidpp::ParseView("").empty());
+    ASSERT("Only separators", quidpp::ParseView(" ,;\n").empty());
+}
+
+int main() {
+    printf("Test vectors for C++ interface\n");
+    printf("==============================\n\n");
+
+    RUN(quidpp_default);
+    RUN(quidpp_generate);
+    RUN(quidpp_format);
+    RUN(quidpp_parse);
+    RUN(quidpp_try_parse);
+    RUN(quidpp_parse_all);
+    RUN(quidpp_constexpr);
+    RUN(quidpp_generator);
+    RUN(quidpp_generator_range);
+    RUN(quidpp_basic_generator);
+    RUN(quidpp_basic_generator_threaded);
+    RUN(quidpp_hash_and_order);
+    RUN(quidpp_flat_containers);
+    RUN(quidpp_arena);
+    RUN(quidpp_parse_batches);
+    RUN(quidpp_async_stream);
+    RUN(quidpp_async_stream_lifetime);
+    RUN(quidpp_format_spec);
+    RUN(quidpp_parse_view);
+    return TEST_REPORT();
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <quid.h>
+
+#include "tinytest.h"
+#include "testutil.h"
+
+#define TC_COUNT 1000
+
+static cuuid_t tc_ids[TC_COUNT];
+static quid128_t tc_keys[TC_COUNT];
+static uint64_t tc_mask[(TC_COUNT + 63) / 64];
+
+static void generate_keys() {
+    ASSERT_EQUALS(QUID_OK, tc_create_ids(tc_ids, TC_COUNT));
+    for (int i = 0; i < TC_COUNT; ++i) {
+        quid_pack(&tc_ids[i], &tc_keys[i]);
+    }
+}
+
+static void scan_find() {
+    quid128_t key;
+
+    for (size_t i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(i, quid_find(tc_keys, TC_COUNT, &tc_keys[i]));
+    }
+
+    /* Keys differing in a single word must not match */
+    key = tc_keys[10];
+    key.lo ^= 1;
+    ASSERT_EQUALS(TC_COUNT, quid_find(tc_keys, TC_COUNT, &key));
+    key = tc_keys[10];
+    key.hi ^= 1ULL << 63;
+    ASSERT_EQUALS(TC_COUNT, quid_find(tc_keys, TC_COUNT, &key));
+
+    /* Search confined to a prefix of the array */
+    ASSERT_EQUALS(7, quid_find(tc_keys, 7, &tc_keys[7]));
+    ASSERT_EQUALS(6, quid_find(tc_keys, 7, &tc_keys[6]));
+    ASSERT_EQUALS(0, quid_find(tc_keys, 0, &tc_keys[0]));
+}
+
+static void scan_eq_mask() {
+    quid128_t key = tc_keys[500];
+
+    /* Plant duplicates across batch and lane boundaries */
+    tc_keys[0] = key;
+    tc_keys[63] = key;
+    tc_keys[64] = key;
+    tc_keys[TC_COUNT - 1] = key;
+
+    ASSERT_EQUALS(5, quid_eq_mask(tc_keys, TC_COUNT, &key, tc_mask));
+    for (size_t i = 0; i < TC_COUNT; ++i) {
+        int expect = (i == 0 || i == 63 || i == 64 || i == 500 || i == TC_COUNT - 1);
+        ASSERT_EQUALS(expect, (int)((tc_mask[i / 64] >> (i % 64)) & 1));
+    }
+
+    ASSERT_EQUALS(0, quid_find(tc_keys, TC_COUNT, &key));
+    ASSERT_EQUALS(2, quid_eq_mask(tc_keys, 64, &key, tc_mask));
+}
+
+static void scan_cmp() {
+    cuuid_t a, b;
+
+    quid_unpack(&tc_keys[1], &a);
+    b = a;
+    ASSERT_EQUALS(QUID_OK, quid_cmp(&a, &b));
+    b.node[5] ^= 1;
+    ASSERT_EQUALS(QUID_ERROR, quid_cmp(&a, &b));
+    b = a;
+    b.time_low |= 1ULL << 40;
+    ASSERT_EQUALS(QUID_ERROR, quid_cmp(&a, &b));
+}
+
+int main() {
+    printf("Test vectors for QUID equality scan\n");
+    printf("====================================\n\n");
+
+    RUN(generate_keys);
+    RUN(scan_find);
+    RUN(scan_eq_mask);
+    RUN(scan_cmp);
+    return TEST_REPORT();
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <quid.h>
+
+#include "tinytest.h"
+#include "testutil.h"
+
+#define TC_COUNT 50000
+
+static cuuid_t tc_ids[TC_COUNT];
+
+static void generate_ids() {
+    ASSERT_EQUALS(QUID_OK, tc_create_ids(tc_ids, TC_COUNT));
+}
+
+static void hash_quid() {
+    cuuid_t tc_b;
+    quid128_t tc_k;
+    int collisions = 0;
+
+    for (int i = 0; i < 1000; ++i) {
+        quid_pack(&tc_ids[i], &tc_k);
+        quid_unpack(&tc_k, &tc_b);
+        ASSERT_EQUALS(quid_hash(&tc_ids[i]), quid_hash(&tc_b));
+        ASSERT_EQUALS(quid_hash(&tc_ids[i]), quid_hash128(&tc_k));
+
+        /* Identifiers differ in the lower bits only, check the upper bits */
+        if ((quid_hash(&tc_ids[i]) >> 52) == (quid_hash(&tc_ids[i + 1]) >> 52)) {
+            collisions++;
+        }
+    }
+
+    ASSERT("poor mixing of hash", collisions < 10);
+}
+
+static void set_insert_and_find() {
+    quid_set_t *set = quid_set_new(0);
+
+    ASSERT("no set", set);
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_set_insert(set, &tc_ids[i]));
+    }
+    ASSERT_EQUALS(TC_COUNT, quid_set_size(set));
+
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_EXISTS, quid_set_insert(set, &tc_ids[i]));
+        ASSERT_EQUALS(QUID_OK, quid_set_contains(set, &tc_ids[i]));
+    }
+    ASSERT_EQUALS(TC_COUNT, quid_set_size(set));
+
+    for (int i = 0; i < TC_COUNT; i += 2) {
+        ASSERT_EQUALS(QUID_OK, quid_set_erase(set, &tc_ids[i]));
+        ASSERT_EQUALS(QUID_ERROR, quid_set_erase(set, &tc_ids[i]));
+    }
+    ASSERT_EQUALS(TC_COUNT / 2, quid_set_size(set));
+
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS((i % 2) ? QUID_OK : QUID_ERROR, quid_set_contains(set, &tc_ids[i]));
+    }
+
+    /* Reinsert into tombstones */
+    for (int i = 0; i < TC_COUNT; i += 2) {
+        ASSERT_EQUALS(QUID_OK, quid_set_insert(set, &tc_ids[i]));
+    }
+    ASSERT_EQUALS(TC_COUNT, quid_set_size(set));
+
+    quid_set_clear(set);
+    ASSERT_EQUALS(0, quid_set_size(set));
+    ASSERT_EQUALS(QUID_ERROR, quid_set_contains(set, &tc_ids[1]));
+
+    quid_set_free(set);
+}
+
+static void set_churn() {
+    quid_set_t *set = quid_set_new(64);
+
+    /* Sliding window keeps the set small while creating tombstones */
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_set_insert(set, &tc_ids[i]));
+        if (i >= 50) {
+            ASSERT_EQUALS(QUID_OK, quid_set_erase(set, &tc_ids[i - 50]));
+        }
+    }
+
+    ASSERT_EQUALS(50, quid_set_size(set));
+    for (int i = TC_COUNT - 50; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_set_contains(set, &tc_ids[i]));
+    }
+
+    quid_set_free(set);
+}
+
+static void map_put_and_get() {
+    quid_map_t *map = quid_map_new(TC_COUNT);
+    void *value;
+
+    ASSERT("no map", map);
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_map_put(map, &tc_ids[i], &tc_ids[i]));
+    }
+
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_map_get(map, &tc_ids[i], &value));
+        ASSERT("value does not match", value == &tc_ids[i]);
+    }
+
+    ASSERT_EQUALS(QUID_EXISTS, quid_map_put(map, &tc_ids[0], NULL));
+    ASSERT_EQUALS(QUID_OK, quid_map_get(map, &tc_ids[0], &value));
+    ASSERT("value not replaced", value == NULL);
+
+    ASSERT_EQUALS(QUID_OK, quid_map_erase(map, &tc_ids[1]));
+    ASSERT_EQUALS(QUID_ERROR, quid_map_get(map, &tc_ids[1], &value));
+    ASSERT_EQUALS(TC_COUNT - 1, quid_map_size(map));
+
+    quid_map_free(map);
+}
+
+int main() {
+    printf("Test vectors for QUID set and map\n");
+    printf("=========================================\n\n");
+
+    RUN(generate_ids);
+    RUN(hash_quid);
+    RUN(set_insert_and_find);
+    RUN(set_churn);
+    RUN(map_put_and_get);
+    return TEST_REPORT();
+}
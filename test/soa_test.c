@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <quid.h>
+
+#include "tinytest.h"
+#include "testutil.h"
+
+#define TC_COUNT 20000
+
+static cuuid_t tc_ids[TC_COUNT];
+static cuuid_t tc_out[TC_COUNT];
+static int64_t tc_ns[TC_COUNT];
+static int64_t tc_soa_ns[TC_COUNT];
+static uint32_t tc_sel[TC_COUNT];
+static uint32_t tc_soa_sel[TC_COUNT];
+static uint64_t tc_hash[TC_COUNT];
+static int tc_order[TC_COUNT];
+static quid_attr_t tc_attr[TC_COUNT];
+static quid_attr_t tc_soa_attr[TC_COUNT];
+
+static void generate_ids() {
+    char tag[3] = {'S', 'O', 'A'};
+
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, tc_create_id(&tc_ids[i], (i % 3) ? QUID_REV7 : QUID_REV4, IDF_PUBLIC, CLS_INFO, (i % 2) ? tag : NULL));
+    }
+}
+
+static void soa_round_trip() {
+    quid_soa_t soa;
+
+    ASSERT_EQUALS(QUID_OK, quid_soa_init(&soa, 16));
+    ASSERT_EQUALS(QUID_OK, quid_soa_load(&soa, tc_ids, TC_COUNT));
+    ASSERT_EQUALS(TC_COUNT, soa.count);
+    ASSERT("column not aligned", ((uintptr_t)soa.time_low % 64) == 0 && ((uintptr_t)soa.node % 64) == 0);
+
+    ASSERT_EQUALS(QUID_OK, quid_soa_store(&soa, tc_out));
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_cmp(&tc_ids[i], &tc_out[i]));
+        ASSERT_EQUALS(tc_ids[i].version, tc_out[i].version);
+    }
+
+    quid_soa_free(&soa);
+}
+
+static void soa_kernels() {
+    int64_t t0, t1;
+    quid_soa_t soa;
+
+    ASSERT_EQUALS(QUID_OK, quid_soa_init(&soa, TC_COUNT));
+    ASSERT_EQUALS(QUID_OK, quid_soa_load(&soa, tc_ids, TC_COUNT));
+
+    ASSERT_EQUALS(QUID_OK, quid_epoch_ns_bulk(tc_ids, TC_COUNT, tc_ns));
+    ASSERT_EQUALS(QUID_OK, quid_soa_epoch_ns(&soa, tc_soa_ns));
+    ASSERT_EQUALS(0, memcmp(tc_ns, tc_soa_ns, sizeof(tc_ns)));
+
+    t0 = tc_ns[TC_COUNT / 4];
+    t1 = tc_ns[TC_COUNT / 2];
+    ASSERT_EQUALS(quid_filter_time(tc_ids, TC_COUNT, t0, t1, tc_sel), quid_soa_filter_time(&soa, t0, t1, tc_soa_sel));
+    ASSERT_EQUALS(0, memcmp(tc_sel, tc_soa_sel, (TC_COUNT / 4) * sizeof(uint32_t)));
+
+    ASSERT_EQUALS(QUID_OK, quid_soa_hash(&soa, tc_hash));
+    ASSERT_EQUALS(QUID_OK, quid_soa_order(&soa, &tc_ids[TC_COUNT / 2], tc_order));
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(quid_hash(&tc_ids[i]), tc_hash[i]);
+        ASSERT_EQUALS(quid_order(&tc_ids[i], &tc_ids[TC_COUNT / 2]), tc_order[i]);
+    }
+
+    ASSERT_EQUALS(QUID_OK, quid_decode_bulk(tc_ids, TC_COUNT, tc_attr));
+    ASSERT_EQUALS(QUID_OK, quid_soa_decode(&soa, tc_soa_attr));
+    ASSERT_EQUALS(0, memcmp(tc_attr, tc_soa_attr, sizeof(tc_attr)));
+
+    quid_soa_free(&soa);
+}
+
+int main() {
+    printf("Test vectors for QUID column container\n");
+    printf("=======================================\n\n");
+
+    RUN(generate_ids);
+    RUN(soa_round_trip);
+    RUN(soa_kernels);
+    return TEST_REPORT();
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <quid.h>
+
+#include "tinytest.h"
+#include "testutil.h"
+
+#define TC_COUNT 300000
+
+/* Random keys with a narrow time range, as seen in practice */
+static void fill_random(quid128_t *keys, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        keys[i].hi = (0x0f17b0b8ULL << 32) | ((tc_rand64() & 0xffffff) << 4) | 0xb;
+        keys[i].lo = tc_rand64();
+    }
+}
+
+static int cmp_key(const void *a, const void *b) {
+    return quid_order128((const quid128_t *)a, (const quid128_t *)b);
+}
+
+static void sort_packed() {
+    quid128_t *keys = malloc(TC_COUNT * sizeof(quid128_t));
+    quid128_t *ref = malloc(TC_COUNT * sizeof(quid128_t));
+
+    fill_random(keys, TC_COUNT);
+    memcpy(ref, keys, TC_COUNT * sizeof(quid128_t));
+    qsort(ref, TC_COUNT, sizeof(quid128_t), cmp_key);
+
+    ASSERT_EQUALS(QUID_OK, quid_sort128(keys, TC_COUNT));
+    ASSERT("keys out of order", !memcmp(keys, ref, TC_COUNT * sizeof(quid128_t)));
+
+    free(keys);
+    free(ref);
+}
+
+static void sort_packed_threaded() {
+    quid128_t *keys = malloc(TC_COUNT * sizeof(quid128_t));
+    quid128_t *ref = malloc(TC_COUNT * sizeof(quid128_t));
+
+    fill_random(keys, TC_COUNT);
+    memcpy(ref, keys, TC_COUNT * sizeof(quid128_t));
+    qsort(ref, TC_COUNT, sizeof(quid128_t), cmp_key);
+
+    ASSERT_EQUALS(QUID_OK, quid_sort128_mt(keys, TC_COUNT, 4));
+    ASSERT("keys out of order", !memcmp(keys, ref, TC_COUNT * sizeof(quid128_t)));
+
+    free(keys);
+    free(ref);
+}
+
+static void sort_small() {
+    quid128_t keys[16];
+
+    fill_random(keys, 16);
+    ASSERT_EQUALS(QUID_OK, quid_sort128(keys, 16));
+    for (int i = 1; i < 16; ++i) {
+        ASSERT("keys out of order", quid_order128(&keys[i - 1], &keys[i]) <= 0);
+    }
+
+    ASSERT_EQUALS(QUID_OK, quid_sort128(keys, 0));
+    ASSERT_EQUALS(QUID_INVALID_PARAM, quid_sort128(NULL, 16));
+}
+
+static void sort_structures() {
+    cuuid_t tc_u[1000];
+
+    for (int i = 0; i < 1000; ++i) {
+        memset(&tc_u[i], 0, sizeof(cuuid_t));
+        tc_u[i].version = QUID_REV7;
+        ASSERT_EQUALS(QUID_OK, quid_create_simple(&tc_u[i]));
+    }
+
+    /* Reverse, generation order is mostly ascending */
+    for (int i = 0; i < 500; ++i) {
+        cuuid_t tmp = tc_u[i];
+        tc_u[i] = tc_u[999 - i];
+        tc_u[999 - i] = tmp;
+    }
+
+    ASSERT_EQUALS(QUID_OK, quid_sort(tc_u, 1000));
+    for (int i = 1; i < 1000; ++i) {
+        ASSERT("quid out of order", quid_order(&tc_u[i - 1], &tc_u[i]) < 0);
+        ASSERT("timestamp out of order", quid_epoch_ns(&tc_u[i - 1]) <= quid_epoch_ns(&tc_u[i]));
+        ASSERT_EQUALS(QUID_REV7, tc_u[i].version);
+        ASSERT_EQUALS(QUID_OK, quid_validate(&tc_u[i]));
+    }
+}
+
+int main() {
+    printf("Test vectors for QUID sorting\n");
+    printf("=========================================\n\n");
+
+    srand(42);
+
+    RUN(sort_packed);
+    RUN(sort_packed_threaded);
+    RUN(sort_small);
+    RUN(sort_structures);
+    return TEST_REPORT();
+}
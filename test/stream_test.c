@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <quid.h>
+
+#include "tinytest.h"
+#include "testutil.h"
+
+#define TC_COUNT 20000
+
+static cuuid_t tc_ids[TC_COUNT];
+static cuuid_t tc_out[TC_COUNT];
+static int64_t tc_ns[TC_COUNT];
+
+/* Identifiers as generated, mostly in time order */
+static void generate_ids() {
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, tc_create_id(&tc_ids[i], (i % 7) ? QUID_REV7 : QUID_REV4, IDF_NULL, CLS_CMON, NULL));
+    }
+
+    /* Out of order identifiers must round trip */
+    tc_ids[100] = tc_ids[TC_COUNT - 1];
+    tc_ids[TC_COUNT - 1] = tc_ids[0];
+
+    ASSERT_EQUALS(QUID_OK, quid_epoch_ns_bulk(tc_ids, TC_COUNT, tc_ns));
+}
+
+static FILE *tc_fp;
+static long tc_length;
+
+static void stream_write() {
+    quid_writer_t *writer;
+
+    tc_fp = tmpfile();
+    ASSERT("no file", tc_fp);
+    writer = quid_writer_open(tc_fp);
+    ASSERT("no writer", writer);
+    ASSERT_EQUALS(QUID_OK, quid_writer_put(writer, tc_ids, TC_COUNT / 2));
+    for (int i = TC_COUNT / 2; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(QUID_OK, quid_writer_put(writer, &tc_ids[i], 1));
+    }
+    ASSERT_EQUALS(QUID_OK, quid_writer_close(writer));
+
+    /* Text output takes 39 bytes per identifier */
+    tc_length = ftell(tc_fp);
+    ASSERT("stream not compact", tc_length * 3 < TC_COUNT * 39);
+}
+
+static void stream_round_trip() {
+    quid_reader_t *reader;
+    size_t count = 0, n;
+
+    rewind(tc_fp);
+    reader = quid_reader_open(tc_fp);
+    ASSERT("no reader", reader);
+    while ((n = quid_reader_read(reader, tc_out + count, 1000)) > 0) {
+        count += n;
+    }
+    ASSERT_EQUALS(TC_COUNT, count);
+    ASSERT_EQUALS(0, quid_reader_read(reader, tc_out, 1));
+    ASSERT_EQUALS(QUID_OK, quid_reader_status(reader));
+
+    for (int i = 0; i < TC_COUNT; ++i) {
+        ASSERT_EQUALS(0, quid_order(&tc_ids[i], &tc_out[i]));
+        ASSERT_EQUALS(tc_ids[i].version, tc_out[i].version);
+        ASSERT_EQUALS(0, memcmp(tc_ids[i].node, tc_out[i].node, 6));
+    }
+
+    quid_reader_close(reader);
+}
+
+static void stream_time_range() {
+    quid_reader_t *reader;
+    size_t count = 0, expect = 0, n;
+    int64_t t0 = tc_ns[TC_COUNT / 3];
+    int64_t t1 = tc_ns[TC_COUNT / 2];
+
+    for (int i = 0; i < TC_COUNT; ++i) {
+        expect += tc_ns[i] >= t0 && tc_ns[i] < t1;
+    }
+
+    rewind(tc_fp);
+    reader = quid_reader_open(tc_fp);
+    ASSERT("no reader", reader);
+    quid_reader_range(reader, t0, t1);
+    while ((n = quid_reader_read(reader, tc_out + count, 1000)) > 0) {
+        count += n;
+    }
+    ASSERT_EQUALS(expect, count);
+
+    for (size_t i = 0; i < count; ++i) {
+        int64_t ns = quid_epoch_ns(&tc_out[i]);
+        ASSERT("identifier out of range", ns >= t0 && ns < t1);
+    }
+
+    quid_reader_close(reader);
+}
+
+/* Count identifiers in stream, returns the reader status */
+static cresult read_all(FILE *fp, size_t *count) {
+    quid_reader_t *reader;
+    cresult rs;
+    size_t n;
+
+    rewind(fp);
+    reader = quid_reader_open(fp);
+    if (!reader) {
+        return QUID_INVALID_PARAM;
+    }
+
+    *count = 0;
+    while ((n = quid_reader_read(reader, tc_out, 1000)) > 0) {
+        *count += n;
+    }
+
+    rs = quid_reader_status(reader);
+    quid_reader_close(reader);
+    return rs;
+}
+
+static void put_le(uint8_t *p, uint64_t v, int n) {
+    for (int i = 0; i < n; ++i) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static void stream_corrupt() {
+    uint8_t *data = malloc((size_t)tc_length);
+    uint8_t raw[16 + 24 + 18] = {0};
+    size_t count;
+    FILE *fp;
+
+    ASSERT("no memory", data);
+    rewind(tc_fp);
+    ASSERT_EQUALS((size_t)tc_length, fread(data, 1, (size_t)tc_length, tc_fp));
+
+    /* Truncated in the last block */
+    fp = tmpfile();
+    ASSERT("no file", fp);
+    fwrite(data, 1, (size_t)tc_length - 5, fp);
+    ASSERT_EQUALS(QUID_CORRUPT, read_all(fp, &count));
+    ASSERT("blocks before truncation are read", count > 0 && count < TC_COUNT);
+    fclose(fp);
+
+    /* Truncated in a block header */
+    fp = tmpfile();
+    ASSERT("no file", fp);
+    fwrite(data, 1, (size_t)tc_length, fp);
+    fwrite(data + 16, 1, 10, fp);
+    ASSERT_EQUALS(QUID_CORRUPT, read_all(fp, &count));
+    ASSERT_EQUALS(TC_COUNT, count);
+    fclose(fp);
+    free(data);
+
+    /* Single row with a timestamp beyond 60 bits */
+    put_le(raw, 0x52545351, 4);
+    put_le(raw + 4, 1, 4);
+    put_le(raw + 8, 4096, 4);
+    put_le(raw + 16, 1, 4);
+    put_le(raw + 20, 18, 4);
+    put_le(raw + 24, 1, 8);
+    put_le(raw + 32, 1, 8);
+    memset(raw + 40, 0x80, 8);
+    raw[48] = 0x10;
+    raw[49] = 0xb;
+
+    fp = tmpfile();
+    ASSERT("no file", fp);
+    fwrite(raw, 1, sizeof(raw), fp);
+    ASSERT_EQUALS(QUID_CORRUPT, read_all(fp, &count));
+    ASSERT_EQUALS(0, count);
+    fclose(fp);
+
+    /* Header bounds beyond 60 bits */
+    put_le(raw + 32, 1ULL << 60, 8);
+    fp = tmpfile();
+    ASSERT("no file", fp);
+    fwrite(raw, 1, sizeof(raw), fp);
+    ASSERT_EQUALS(QUID_CORRUPT, read_all(fp, &count));
+    fclose(fp);
+
+    ASSERT_EQUALS(QUID_INVALID_PARAM, quid_reader_status(NULL));
+}
+
+/* A failed write is sticky */
+static void stream_write_failure() {
+    quid_writer_t *writer;
+    FILE *fp = fopen("/dev/full", "wb");
+
+    /* No full device on this platform */
+    if (!fp) {
+        return;
+    }
+
+    writer = quid_writer_open(fp);
+    ASSERT("no writer", writer);
+    ASSERT_EQUALS(QUID_ERROR, quid_writer_put(writer, tc_ids, TC_COUNT));
+    ASSERT_EQUALS(QUID_ERROR, quid_writer_put(writer, tc_ids, 1));
+    ASSERT_EQUALS(QUID_ERROR, quid_writer_close(writer));
+    fclose(fp);
+}
+
+static void stream_invalid() {
+    FILE *fp = tmpfile();
+
+    ASSERT("no file", fp);
+    fputs("{00000000-0000-0000-0000-000000000000}\n", fp);
+    rewind(fp);
+    ASSERT("text accepted as stream", quid_reader_open(fp) == NULL);
+    fclose(fp);
+
+    ASSERT("no file accepted", quid_writer_open(NULL) == NULL);
+    fclose(tc_fp);
+}
+
+int main() {
+    printf("Test vectors for QUID stream format\n");
+    printf("====================================\n\n");
+
+    RUN(generate_ids);
+    RUN(stream_write);
+    RUN(stream_round_trip);
+    RUN(stream_time_range);
+    RUN(stream_corrupt);
+    RUN(stream_write_failure);
+    RUN(stream_invalid);
+    return TEST_REPORT();
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2012-2020, Yorick de Wid <yorick17 at outlook dot com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Fixtures shared by the test vectors. Identifiers are either created
+ * through the library, or synthesized around a fixed point in time so
+ * that tests can control their timestamps. Random values come from
+ * rand() and are reproducible with srand().
+ */
+
+#ifndef _TESTUTIL_INCLUDED
+#define _TESTUTIL_INCLUDED
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <quid.h>
+
+#define TC_BASE_TICKS   (0x0f17b0b8ULL << 28)   /* Fixed point in time of synthetic identifiers */
+
+/* 64 random bits, rand() yields at least 15 */
+static inline uint64_t tc_rand64(void) {
+    uint64_t r = 0;
+    for (int i = 0; i < 4; ++i) {
+        r = (r << 16) ^ (uint64_t)(rand() & 0xffff);
+    }
+    return r;
+}
+
+/* Revision 7 identifier at tick offset from TC_BASE_TICKS with random node */
+static inline void tc_synthetic_id(uint64_t offset, cuuid_t *cuuid) {
+    quid128_t key;
+
+    key.hi = (TC_BASE_TICKS + offset) << 4 | 0xb;
+    key.lo = tc_rand64();
+    quid_unpack(&key, cuuid);
+}
+
+/* New identifier of the requested version */
+static inline cresult tc_create_id(cuuid_t *cuuid, uint8_t version, uint8_t flag, uint8_t category, char *tag) {
+    memset(cuuid, 0, sizeof(cuuid_t));
+    cuuid->version = version;
+    return quid_create(cuuid, flag, category, tag);
+}
+
+/* Fill array with new identifiers of the latest revision */
+static inline cresult tc_create_ids(cuuid_t *ids, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        cresult rs = tc_create_id(&ids[i], QUID_REV7, IDF_NULL, CLS_CMON, NULL);
+        if (rs != QUID_OK) {
+            return rs;
+        }
+    }
+
+    return QUID_OK;
+}
+
+#endif
@@ -67,6 +67,7 @@ enum {
     PRINT_FORMAT_HEX = 1,
     PRINT_FORMAT_DEC = 2,
     PRINT_FORMAT_HEX_BACKET = 0,
+    PRINT_FORMAT_STREAM = 3,
 };
 
 static void quid_print_file_hex(FILE *fp, cuuid_t u) {
@@ -242,6 +243,52 @@ static void print_verbose(void) {
     printf("-----------------------------\n");
 }
 
+/* Print identifiers from stream file */
+static int read_stream(const char *pathname, int format) {
+    cuuid_t buffer[256];
+    quid_reader_t *reader;
+    size_t count;
+    FILE *fp;
+    int rtn;
+
+    fp = fopen(pathname, "rb");
+    if (fp == NULL) {
+        printf("%s is not readable\n", pathname);
+        return 1;
+    }
+
+    reader = quid_reader_open(fp);
+    if (reader == NULL) {
+        printf("%s is not a stream\n", pathname);
+        fclose(fp);
+        return 1;
+    }
+
+    while ((count = quid_reader_read(reader, buffer, 256)) > 0) {
+        for (size_t j = 0; j < count; ++j) {
+            quid_print(buffer[j], format);
+        }
+    }
+
+    switch (quid_reader_status(reader)) {
+        case QUID_OK:
+            rtn = 0;
+            break;
+        case QUID_CORRUPT:
+            fprintf(stderr, "%s is corrupt or truncated\n", pathname);
+            rtn = 1;
+            break;
+        default:
+            fprintf(stderr, "%s read failed\n", pathname);
+            rtn = 1;
+            break;
+    }
+
+    quid_reader_close(reader);
+    fclose(fp);
+    return rtn;
+}
+
 /* Program usage */
 static void usage(void) {
     printf("Usage: " PROJECT_NAME " [OPTIONS] identifier...\n");
@@ -269,6 +316,9 @@ static void usage(void) {
     printf("  -o <file>                Output to <file>\n");
     printf("  -x, --output-hex         Output identifier as hexadecimal\n");
     printf("  -i, --output-number      Output identifier as number\n");
+    printf("  -b, --output-stream      Output identifiers as columnar stream\n");
+    printf("  --read-stream=<file>     Print identifiers from stream <file>\n");
+    printf("  --output-log=<dir>       Append identifiers to log in <dir>\n");
     printf("  -q                       Silent, no output shown on screen\n");
 
     printf("\n");
@@ -351,9 +401,13 @@ static void set_signint(int s) {
 /* Program main */
 int main(int argc, char *argv[]) {
     cuuid_t cuuid;
-    int c, rtn;
+    int c, rtn, status = 0;
     unsigned long long n = 1;
     char *fname = NULL;
+    char *sname = NULL;
+    char *lname = NULL;
+    quid_log_t *log = NULL;
+    quid_writer_t *writer = NULL;
     FILE *fp = NULL;
     int fout = 0, nout = 0, fmat = PRINT_FORMAT_HEX_BACKET, vbose = 0, gen = 1;
     int option_index;
@@ -374,6 +428,9 @@ int main(int argc, char *argv[]) {
         {"memory-seed",    required_argument, 0, 0},
         {"output-hex",     no_argument,       0, 'x'},
         {"output-number",  no_argument,       0, 'i'},
+        {"output-stream",  no_argument,       0, 'b'},
+        {"read-stream",    required_argument, 0, 0},
+        {"output-log",     required_argument, 0, 0},
         {"verbose",        no_argument,       0, 'V'},
         {"version",        no_argument,       0, 'v'},
         {"help",           no_argument,       0, 'h'},
@@ -389,7 +446,7 @@ int main(int argc, char *argv[]) {
     while (1) {
         option_index = 0;
 
-        c = getopt_long(argc, argv, "c:d:o:qxivVh", long_options, &option_index);
+        c = getopt_long(argc, argv, "c:d:o:qxibvVh", long_options, &option_index);
         if (c == -1) {
             break;
         }
@@ -421,6 +478,10 @@ int main(int argc, char *argv[]) {
                     tag[0] = optarg[0];
                     tag[1] = optarg[1];
                     tag[2] = optarg[2];
+                } else if (!strcmp("read-stream", long_options[option_index].name)) {
+                    sname = optarg;
+                } else if (!strcmp("output-log", long_options[option_index].name)) {
+                    lname = optarg;
                 } else if (!strcmp("list-categories", long_options[option_index].name)) {
                     printf("%d) %s\n", CLS_CMON, category_name(CLS_CMON));
                     printf("%d) %s\n", CLS_INFO, category_name(CLS_INFO));
@@ -470,6 +531,9 @@ int main(int argc, char *argv[]) {
             case 'i':
                 fmat = PRINT_FORMAT_DEC;
                 break;
+            case 'b':
+                fmat = PRINT_FORMAT_STREAM;
+                break;
             case 'q':
                 nout = 1;
                 break;
@@ -506,6 +570,17 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
+    /* Identifiers from stream */
+    if (sname) {
+        return read_stream(sname, fmat);
+    }
+
+    /* Log output replaces any other output */
+    if (lname && fout) {
+        printf("-o cannot be combined with --output-log\n");
+        return 1;
+    }
+
     /* Output new identifiers */
     if (gen) {
         gettimeofday(&t1, NULL);
@@ -514,7 +589,7 @@ int main(int argc, char *argv[]) {
         if (fout) {
             rtn = check_fname(fname);
             if (!rtn) {
-                fp = fopen(fname, "a");
+                fp = fopen(fname, fmat == PRINT_FORMAT_STREAM ? "ab" : "a");
                 if (fp == NULL) {
                     printf("%s is not writable\n", fname);
                     return 1;
@@ -528,6 +603,22 @@ int main(int argc, char *argv[]) {
             }
         }
 
+        if (lname) {
+            log = quid_log_open(lname, 0, 0);
+            if (log == NULL) {
+                printf("%s is not a log directory\n", lname);
+                return 1;
+            }
+        }
+
+        if (fmat == PRINT_FORMAT_STREAM && !log) {
+            writer = quid_writer_open(fout ? fp : stdout);
+            if (writer == NULL) {
+                printf("cannot write stream\n");
+                return 1;
+            }
+        }
+
         for (i=0; i<n; ++i) {
             assert(cat != 0);
             quid_create(&cuuid, flg, cat, tag);
@@ -536,7 +627,19 @@ int main(int argc, char *argv[]) {
                 break;
             }
 
-            if (!fout){
+            if (log) {
+                if (quid_log_append(log, &cuuid, 1) != QUID_OK) {
+                    fprintf(stderr, "log append failed\n");
+                    status = 1;
+                    break;
+                }
+            } else if (writer) {
+                if (quid_writer_put(writer, &cuuid, 1) != QUID_OK) {
+                    fprintf(stderr, "stream write failed\n");
+                    status = 1;
+                    break;
+                }
+            } else if (!fout){
                 if (!nout) {
                     quid_print(cuuid, fmat);
                 }
@@ -551,6 +654,19 @@ int main(int argc, char *argv[]) {
             ticks = clock();
         }
 
+        if (log) {
+            if (quid_log_sync(log) != QUID_OK) {
+                fprintf(stderr, "log sync failed\n");
+                status = 1;
+            }
+            quid_log_close(log);
+        }
+
+        if (writer && quid_writer_close(writer) != QUID_OK) {
+            fprintf(stderr, "stream write failed\n");
+            status = 1;
+        }
+
         if (fp) {
             fclose(fp);
         }
@@ -563,5 +679,5 @@ int main(int argc, char *argv[]) {
         print_verbose();
     }
 
-    return 0;
+    return status;
 }